@@ -0,0 +1,43 @@
+#include "AsyncIo.h"
+
+#include "PwriteIo.h"
+#include "UringIo.h"
+#include <deque>
+#include <stdexcept>
+
+std::shared_ptr<AsyncIo> AsyncIo::create() {
+    try {
+        return std::make_shared<UringIo>();
+    } catch (const std::runtime_error &) {
+        // Old kernel, or io_uring disabled by the system or a container
+        return std::make_shared<PwriteIo>();
+    }
+}
+
+void AsyncIo::write(int fd, std::string_view data, uint64_t offset) {
+    std::deque<std::future<void>> pending;
+    try {
+        for (size_t position = 0; position < data.size(); position += CHUNK_SIZE) {
+            if (pending.size() >= MAX_IN_FLIGHT) {
+                pending.front().get();
+                pending.pop_front();
+            }
+            pending.push_back(submitWrite(fd, data.substr(position, CHUNK_SIZE), offset + position));
+        }
+        for (auto &chunk: pending) {
+            chunk.get();
+        }
+    } catch (...) {
+        // The chunks still in flight point into the data, they have to finish before it goes away
+        for (auto &chunk: pending) {
+            if (chunk.valid()) {
+                chunk.wait();
+            }
+        }
+        throw;
+    }
+}
+
+void AsyncIo::sync(int fd) {
+    submitSync(fd).get();
+}
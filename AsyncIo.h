@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string_view>
+
+// Asynchronous file writes used by the write-ahead log and checkpoints.
+// Several writes can be in flight at once, so the disk keeps working while the caller prepares the next data.
+class AsyncIo {
+public:
+    static constexpr size_t CHUNK_SIZE = 256 << 10; // Large writes are split into chunks of this size
+    static constexpr size_t MAX_IN_FLIGHT = 8; // Chunks of one write submitted at once
+
+    // io_uring when the kernel allows it, a thread pool calling pwrite otherwise
+    static std::shared_ptr<AsyncIo> create();
+
+    virtual ~AsyncIo() = default;
+
+    // Queues a write, the data has to stay alive until the future is ready
+    virtual std::future<void> submitWrite(int fd, std::string_view data, uint64_t offset) = 0;
+    // Queues fdatasync, it covers only writes that completed before it was submitted
+    virtual std::future<void> submitSync(int fd) = 0;
+
+    // Writes the data in chunks kept in flight together and waits for all of them
+    virtual void write(int fd, std::string_view data, uint64_t offset);
+    virtual void sync(int fd); // Waits for a submitted fdatasync
+};
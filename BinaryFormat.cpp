@@ -0,0 +1,214 @@
+#include "BinaryFormat.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Values are stored in host order, all supported targets are little-endian
+template<typename T>
+static void append(std::string &buffer, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    buffer.append(bytes, sizeof(T));
+}
+
+template<typename T>
+static T extract(std::string_view input, size_t position) {
+    T value;
+    std::memcpy(&value, input.data() + position, sizeof(T));
+    return value;
+}
+
+// WRITER
+void ByteWriter::writeU8(uint8_t value) {
+    buffer.push_back(static_cast<char>(value));
+}
+
+void ByteWriter::writeU32(uint32_t value) {
+    append(buffer, value);
+}
+
+void ByteWriter::writeU64(uint64_t value) {
+    append(buffer, value);
+}
+
+void ByteWriter::writeI32(int32_t value) {
+    append(buffer, value);
+}
+
+void ByteWriter::writeFloat(float value) {
+    append(buffer, value);
+}
+
+void ByteWriter::writeDouble(double value) {
+    append(buffer, value);
+}
+
+void ByteWriter::writeString(std::string_view value) {
+    writeU32(static_cast<uint32_t>(value.size()));
+    buffer.append(value);
+}
+
+void ByteWriter::writeBytes(std::string_view bytes) {
+    buffer.append(bytes);
+}
+
+size_t ByteWriter::size() const {
+    return buffer.size();
+}
+
+const std::string &ByteWriter::data() const {
+    return buffer;
+}
+
+std::string ByteWriter::release() {
+    std::string result = std::move(buffer);
+    buffer.clear();
+    return result;
+}
+
+// READER
+ByteReader::ByteReader(std::string_view input) : input(input) {}
+
+void ByteReader::require(size_t bytes) const {
+    if (input.size() - position < bytes) {
+        throw std::runtime_error("Unexpected end of binary data at offset " + std::to_string(position));
+    }
+}
+
+uint8_t ByteReader::readU8() {
+    require(1);
+    return static_cast<uint8_t>(input[position++]);
+}
+
+uint32_t ByteReader::readU32() {
+    require(sizeof(uint32_t));
+    auto value = extract<uint32_t>(input, position);
+    position += sizeof(uint32_t);
+    return value;
+}
+
+uint64_t ByteReader::readU64() {
+    require(sizeof(uint64_t));
+    auto value = extract<uint64_t>(input, position);
+    position += sizeof(uint64_t);
+    return value;
+}
+
+int32_t ByteReader::readI32() {
+    require(sizeof(int32_t));
+    auto value = extract<int32_t>(input, position);
+    position += sizeof(int32_t);
+    return value;
+}
+
+float ByteReader::readFloat() {
+    require(sizeof(float));
+    auto value = extract<float>(input, position);
+    position += sizeof(float);
+    return value;
+}
+
+double ByteReader::readDouble() {
+    require(sizeof(double));
+    auto value = extract<double>(input, position);
+    position += sizeof(double);
+    return value;
+}
+
+std::string_view ByteReader::readString() {
+    uint32_t length = readU32();
+    return readBytes(length);
+}
+
+std::string_view ByteReader::readBytes(size_t count) {
+    require(count);
+    auto bytes = input.substr(position, count);
+    position += count;
+    return bytes;
+}
+
+bool ByteReader::isEnd() const {
+    return position >= input.size();
+}
+
+size_t ByteReader::getPosition() const {
+    return position;
+}
+
+// FILE
+void BinaryFile::writeAtomically(const std::string &filename, std::string_view data) {
+    std::string temporaryName = filename + ".tmp";
+    int fd = ::open(temporaryName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file " + temporaryName + " for writing");
+    }
+
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            throw std::runtime_error("Cannot write file " + temporaryName);
+        }
+        written += static_cast<size_t>(result);
+    }
+
+    if (::fsync(fd) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot sync file " + temporaryName);
+    }
+    ::close(fd);
+
+    if (std::rename(temporaryName.c_str(), filename.c_str()) != 0) {
+        throw std::runtime_error("Cannot rename " + temporaryName + " to " + filename);
+    }
+
+    // The rename itself is durable only once the directory is synced
+    auto directory = std::filesystem::absolute(filename).parent_path();
+    int directoryFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (directoryFd >= 0) {
+        ::fsync(directoryFd);
+        ::close(directoryFd);
+    }
+}
+
+void BinaryFile::writeAt(int fd, std::string_view data, uint64_t offset) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t result = ::pwrite(fd, data.data() + written, data.size() - written,
+                                  static_cast<off_t>(offset + written));
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("Cannot write file: ") + std::strerror(errno));
+        }
+        written += static_cast<size_t>(result);
+    }
+}
+
+// CHECKSUM
+uint32_t Crc32::compute(std::string_view data) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+            }
+            result[i] = value;
+        }
+        return result;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (char c: data) {
+        crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Appends little-endian binary values to a byte buffer
+class ByteWriter {
+    std::string buffer;
+public:
+    virtual void writeU8(uint8_t value);
+    virtual void writeU32(uint32_t value);
+    virtual void writeU64(uint64_t value);
+    virtual void writeI32(int32_t value);
+    virtual void writeFloat(float value);
+    virtual void writeDouble(double value);
+    virtual void writeString(std::string_view value); // Length prefixed
+    virtual void writeBytes(std::string_view bytes); // Raw, no length prefix
+
+    [[nodiscard]] virtual size_t size() const;
+    [[nodiscard]] virtual const std::string &data() const;
+    virtual std::string release(); // Moves the buffer out and leaves the writer empty
+};
+
+// Reads values written by ByteWriter, throws if the input ends too early
+class ByteReader {
+    std::string_view input;
+    size_t position = 0;
+
+    virtual void require(size_t bytes) const;
+public:
+    explicit ByteReader(std::string_view input);
+
+    virtual uint8_t readU8();
+    virtual uint32_t readU32();
+    virtual uint64_t readU64();
+    virtual int32_t readI32();
+    virtual float readFloat();
+    virtual double readDouble();
+    virtual std::string_view readString(); // Points into the input, no copy
+    virtual std::string_view readBytes(size_t count); // Points into the input, no copy
+
+    [[nodiscard]] virtual bool isEnd() const;
+    [[nodiscard]] virtual size_t getPosition() const;
+};
+
+class BinaryFile {
+public:
+    // Writes the data to a temporary file, syncs it and renames it over the target
+    static void writeAtomically(const std::string &filename, std::string_view data);
+    // Writes all of the data at the offset, retrying short writes
+    static void writeAt(int fd, std::string_view data, uint64_t offset);
+};
+
+class Crc32 {
+public:
+    static uint32_t compute(std::string_view data); // CRC-32 (IEEE) used to detect torn or corrupted records
+};
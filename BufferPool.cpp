@@ -0,0 +1,281 @@
+#include "BufferPool.h"
+
+#include "Logger.h"
+#include <algorithm>
+#include <fmt/format.h>
+#include <stdexcept>
+
+static constexpr size_t MAP_NODE_BYTES = 48; // Red-black tree node overhead of Row::data
+
+// PINNED ROWS
+PinnedRows::PinnedRows(std::shared_ptr<const std::vector<Row>> rows) : rows(std::move(rows)) {
+    count = this->rows->size();
+}
+
+PinnedRows::PinnedRows(std::shared_ptr<const std::vector<Row>> rows, size_t count)
+        : rows(std::move(rows)), count(count) {}
+
+PinnedRows::PinnedRows(BufferPool *pool, size_t frame, std::shared_ptr<const std::vector<Row>> rows)
+        : pool(pool), frame(frame), rows(std::move(rows)) {
+    count = this->rows->size();
+}
+
+PinnedRows::PinnedRows(PinnedRows &&other) noexcept
+        : pool(std::exchange(other.pool, nullptr)), frame(other.frame), rows(std::move(other.rows)),
+          count(other.count) {}
+
+PinnedRows &PinnedRows::operator=(PinnedRows &&other) noexcept {
+    if (this != &other) {
+        if (pool) {
+            pool->unpin(frame);
+        }
+        pool = std::exchange(other.pool, nullptr);
+        frame = other.frame;
+        rows = std::move(other.rows);
+        count = other.count;
+    }
+    return *this;
+}
+
+PinnedRows::~PinnedRows() {
+    if (pool) {
+        pool->unpin(frame);
+    }
+}
+
+std::span<const Row> PinnedRows::operator*() const {
+    return {rows->data(), count};
+}
+
+void PinnedRows::truncate(size_t newCount) {
+    count = std::min(count, newCount);
+}
+
+// SCAN RING
+ScanRing::ScanRing(size_t capacity) : capacity(capacity) {}
+
+// BUFFER POOL
+BufferPool::BufferPool(size_t budgetBytes) : budget(budgetBytes) {}
+
+PinnedRows BufferPool::pin(uint64_t pageId, const std::vector<std::shared_ptr<Column>> &columns,
+                           const Loader &load, size_t expectedBytes, ScanRing *ring) {
+    std::unique_lock lock(mutex);
+    if (auto pinned = pinCached(pageId, columns)) {
+        return std::move(*pinned);
+    }
+    if (expectedBytes > budget) {
+        throw std::runtime_error(fmt::format("Page of {} bytes does not fit in the buffer pool budget of {} bytes",
+                                             expectedBytes, budget));
+    }
+
+    // Decode without holding the lock, other readers keep going. The rows take memory from the start,
+    // so their room is reserved first.
+    waitForRoom(lock, expectedBytes, ring);
+    reservedBytes += expectedBytes;
+    lock.unlock();
+    std::shared_ptr<const std::vector<Row>> rows;
+    try {
+        rows = load();
+    } catch (...) {
+        lock.lock();
+        reservedBytes -= expectedBytes;
+        ++releases;
+        roomFreed.notify_all();
+        throw;
+    }
+    size_t bytes = estimateBytes(*rows);
+
+    lock.lock();
+    if (bytes > budget) {
+        reservedBytes -= expectedBytes;
+        ++releases;
+        roomFreed.notify_all();
+        throw std::runtime_error(fmt::format("Page of {} bytes does not fit in the buffer pool budget of {} bytes",
+                                             bytes, budget));
+    }
+    if (bytes > expectedBytes) {
+        waitForRoom(lock, bytes - expectedBytes, ring); // The schema changed and added columns since put()
+    }
+    // The reservation turns into the frame below, or is given back when someone else loaded the page meanwhile
+    reservedBytes -= expectedBytes;
+    ++releases;
+    roomFreed.notify_all();
+
+    bool privateCopy = false;
+    if (auto pinned = pinCached(pageId, columns)) {
+        return std::move(*pinned); // Someone else loaded it in the meantime
+    }
+    if (auto it = pageTable.find(pageId); it != pageTable.end()) {
+        if (frames[it->second].pinCount > 0) {
+            // Still used with the old schema, this reader gets a copy of its own
+            privateCopy = true;
+        } else {
+            evict(it->second);
+        }
+    }
+
+    size_t frameIndex = install(pageId, rows, columns, bytes);
+    auto &frame = frames[frameIndex];
+    frame.pinCount = 1;
+    if (privateCopy) {
+        frame.privateCopy = true;
+    } else {
+        pageTable[pageId] = frameIndex;
+        if (ring) {
+            // Pages brought in by a scan get no second chance until someone reads them again
+            frame.referenced = false;
+            ring->frames.emplace_back(frameIndex, pageId);
+        }
+    }
+    return {this, frameIndex, frame.rows};
+}
+
+std::optional<PinnedRows> BufferPool::pinCached(uint64_t pageId, const std::vector<std::shared_ptr<Column>> &columns) {
+    auto it = pageTable.find(pageId);
+    if (it == pageTable.end() || frames[it->second].columns != columns) {
+        return std::nullopt;
+    }
+    auto &frame = frames[it->second];
+    ++frame.pinCount;
+    frame.referenced = true;
+    return PinnedRows(this, it->second, frame.rows);
+}
+
+void BufferPool::waitForRoom(std::unique_lock<std::mutex> &lock, size_t bytes, ScanRing *ring) {
+    while (usedBytes + reservedBytes + bytes > budget) {
+        if (ring && ring->frames.size() >= ring->capacity && evictFromRing(*ring)) {
+            continue;
+        }
+        if (makeRoom(bytes)) {
+            return;
+        }
+        uint64_t seen = releases;
+        if (!roomFreed.wait_for(lock, DEADLOCK_TIMEOUT, [&] { return releases != seen; })) {
+            // Every pinned page may belong to a reader that waits here too, one of them has to go on
+            ++overdrafts;
+            Logger::warning(fmt::format("Buffer pool budget of {} bytes exceeded by a page of {} bytes, no pinned "
+                                        "page was released for {} ms", budget, bytes, DEADLOCK_TIMEOUT.count()));
+            return;
+        }
+    }
+}
+
+void BufferPool::put(uint64_t pageId, std::shared_ptr<std::vector<Row>> rows,
+                     const std::vector<std::shared_ptr<Column>> &columns) {
+    size_t bytes = estimateBytes(*rows);
+    std::lock_guard lock(mutex);
+    if (pageTable.contains(pageId) || !makeRoom(bytes)) {
+        return;
+    }
+    pageTable[pageId] = install(pageId, std::move(rows), columns, bytes);
+}
+
+void BufferPool::unpin(size_t frame) {
+    std::lock_guard lock(mutex);
+    if (--frames[frame].pinCount > 0) {
+        return;
+    }
+    if (frames[frame].privateCopy) {
+        evict(frame);
+    }
+    ++releases;
+    roomFreed.notify_all();
+}
+
+size_t BufferPool::getBudget() const {
+    return budget;
+}
+
+size_t BufferPool::getUsedBytes() {
+    std::lock_guard lock(mutex);
+    return usedBytes + reservedBytes;
+}
+
+size_t BufferPool::getLargestPageBytes() {
+    std::lock_guard lock(mutex);
+    return largestPageBytes;
+}
+
+size_t BufferPool::getOverdraftCount() {
+    std::lock_guard lock(mutex);
+    return overdrafts;
+}
+
+size_t BufferPool::estimateBytes(const std::vector<Row> &rows) {
+    size_t bytes = sizeof(std::vector<Row>) + rows.capacity() * sizeof(Row);
+    for (const auto &row: rows) {
+        bytes += row.data.size() * (MAP_NODE_BYTES + sizeof(std::pair<const std::shared_ptr<Column>, BoxedValue>));
+        for (const auto &[column, value]: row.data) {
+            if (value.has_value() && std::holds_alternative<std::string>(value.data.value())) {
+                bytes += std::get<std::string>(value.data.value()).capacity();
+            }
+        }
+    }
+    return bytes;
+}
+
+bool BufferPool::makeRoom(size_t bytes) {
+    if (bytes > budget) {
+        return false;
+    }
+    // Two full turns of the clock: the first one may only clear reference bits
+    size_t steps = 0;
+    while (usedBytes + reservedBytes + bytes > budget && steps < 2 * frames.size()) {
+        auto &frame = frames[clockHand];
+        if (frame.rows && frame.pinCount == 0) {
+            if (frame.referenced) {
+                frame.referenced = false;
+            } else {
+                evict(clockHand);
+            }
+        }
+        clockHand = (clockHand + 1) % frames.size();
+        ++steps;
+    }
+    return usedBytes + reservedBytes + bytes <= budget;
+}
+
+bool BufferPool::evictFromRing(ScanRing &ring) {
+    while (ring.frames.size() >= ring.capacity) {
+        auto [frameIndex, pageId] = ring.frames.front();
+        ring.frames.pop_front();
+        auto &frame = frames[frameIndex];
+        // Skip frames reused for another page or read again by someone else since the scan loaded them
+        if (frame.rows && frame.pageId == pageId && frame.pinCount == 0 && !frame.referenced) {
+            evict(frameIndex);
+            return true;
+        }
+    }
+    return false;
+}
+
+void BufferPool::evict(size_t frame) {
+    auto &victim = frames[frame];
+    if (!victim.privateCopy) {
+        pageTable.erase(victim.pageId);
+    }
+    usedBytes -= victim.bytes;
+    victim = Frame{};
+    freeFrames.push_back(frame);
+}
+
+size_t BufferPool::install(uint64_t pageId, std::shared_ptr<const std::vector<Row>> rows,
+                           const std::vector<std::shared_ptr<Column>> &columns, size_t bytes) {
+    size_t frameIndex;
+    if (!freeFrames.empty()) {
+        frameIndex = freeFrames.back();
+        freeFrames.pop_back();
+    } else {
+        frameIndex = frames.size();
+        frames.emplace_back();
+    }
+    auto &frame = frames[frameIndex];
+    frame.pageId = pageId;
+    frame.rows = std::move(rows);
+    frame.columns = columns;
+    frame.bytes = bytes;
+    frame.referenced = true;
+    usedBytes += bytes;
+    largestPageBytes = std::max(largestPageBytes, bytes);
+    return frameIndex;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Table.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class BufferPool; // Forward declaration
+
+// Rows of one segment, kept in memory and out of the pool's eviction while the guard lives
+class PinnedRows {
+    BufferPool *pool = nullptr; // Null for rows not managed by a pool
+    size_t frame = 0;
+    std::shared_ptr<const std::vector<Row>> rows;
+    size_t count = 0; // Rows visible through the guard, the vector may grow past them
+public:
+    explicit PinnedRows(std::shared_ptr<const std::vector<Row>> rows);
+    PinnedRows(std::shared_ptr<const std::vector<Row>> rows, size_t count);
+    PinnedRows(BufferPool *pool, size_t frame, std::shared_ptr<const std::vector<Row>> rows);
+    PinnedRows(PinnedRows &&other) noexcept;
+    PinnedRows &operator=(PinnedRows &&other) noexcept;
+    PinnedRows(const PinnedRows &) = delete;
+    PinnedRows &operator=(const PinnedRows &) = delete;
+    virtual ~PinnedRows(); // Unpins the frame
+
+    [[nodiscard]] virtual std::span<const Row> operator*() const;
+    virtual void truncate(size_t newCount); // Hides the rows past newCount, e.g. ones a reader must not see
+};
+
+// Frames a single sequential scan may fill. Once the ring is full the scan recycles its own oldest frame
+// instead of pushing the working set of everyone else out of the pool.
+class ScanRing {
+    friend class BufferPool;
+    size_t capacity;
+    std::deque<std::pair<size_t, uint64_t>> frames; // Frame and the page loaded into it, oldest first
+public:
+    explicit ScanRing(size_t capacity = 4);
+};
+
+// Decoded table pages cached in memory under a budget, shared by every table of a database.
+// Readers pin the pages they use; unpinned pages are evicted with the clock algorithm when the budget is reached.
+// Everything a reader decodes counts: room for a page is reserved before it is decoded, and a copy decoded for
+// a reader while the cached one is pinned with an older schema takes a frame of its own until it is unpinned.
+// A reader that finds only pinned pages waits for an unpin. Only when no page was unpinned for DEADLOCK_TIMEOUT,
+// as when every pinned page belongs to a reader waiting here, is the page let in over the budget, with a warning.
+class BufferPool {
+public:
+    using Loader = std::function<std::shared_ptr<std::vector<Row>>()>; // Decodes a page that is not cached
+
+    static constexpr std::chrono::milliseconds DEADLOCK_TIMEOUT{100};
+
+    explicit BufferPool(size_t budgetBytes);
+
+    // Returns the cached page or loads it, columns tell apart pages decoded before a schema change.
+    // expectedBytes is the size of the decoded page as put() saw it, reserved while the page is decoded.
+    // Throws when the page alone is larger than the budget.
+    virtual PinnedRows pin(uint64_t pageId, const std::vector<std::shared_ptr<Column>> &columns,
+                           const Loader &load, size_t expectedBytes, ScanRing *ring = nullptr);
+    // Caches a page that was just written, dropped at once if the budget is taken by pinned pages
+    virtual void put(uint64_t pageId, std::shared_ptr<std::vector<Row>> rows,
+                     const std::vector<std::shared_ptr<Column>> &columns);
+    virtual void unpin(size_t frame);
+
+    [[nodiscard]] virtual size_t getBudget() const;
+    [[nodiscard]] virtual size_t getUsedBytes(); // Cached pages, private copies and reservations of decodes
+    [[nodiscard]] virtual size_t getLargestPageBytes(); // Largest page cached so far, 0 before the first one
+    [[nodiscard]] virtual size_t getOverdraftCount(); // Pages let in over the budget to break a wait
+
+    static size_t estimateBytes(const std::vector<Row> &rows); // Memory taken by decoded rows
+
+private:
+    struct Frame {
+        uint64_t pageId = 0;
+        std::shared_ptr<const std::vector<Row>> rows; // Null for a free frame
+        std::vector<std::shared_ptr<Column>> columns;
+        size_t bytes = 0;
+        size_t pinCount = 0;
+        bool referenced = false; // Second chance for the clock hand
+        bool privateCopy = false; // Not in the page table, freed with its last pin
+    };
+
+    size_t budget;
+    size_t usedBytes = 0; // Frames in use, private copies included
+    size_t reservedBytes = 0; // Pages being decoded
+    size_t largestPageBytes = 0;
+    size_t overdrafts = 0;
+    uint64_t releases = 0; // Bumped whenever pinned memory or a reservation is given back
+    std::mutex mutex;
+    std::condition_variable roomFreed; // Notified with every release
+    std::vector<Frame> frames;
+    std::vector<size_t> freeFrames;
+    std::unordered_map<uint64_t, size_t> pageTable; // Page to frame
+    size_t clockHand = 0;
+
+    virtual std::optional<PinnedRows> pinCached(uint64_t pageId, const std::vector<std::shared_ptr<Column>> &columns);
+    // Makes room for the bytes next to the frames and the reservations, evicting unpinned pages and waiting for
+    // readers to unpin when only pinned ones are left
+    virtual void waitForRoom(std::unique_lock<std::mutex> &lock, size_t bytes, ScanRing *ring);
+    virtual bool makeRoom(size_t bytes); // Evicts until the bytes fit, false if only pinned pages are left
+    virtual bool evictFromRing(ScanRing &ring);
+    virtual void evict(size_t frame);
+    virtual size_t install(uint64_t pageId, std::shared_ptr<const std::vector<Row>> rows,
+                           const std::vector<std::shared_ptr<Column>> &columns, size_t bytes);
+};
@@ -12,6 +12,21 @@ Column::Column(std::string name, DataType type) : name(std::move(name)), type(ty
 Column::Column(std::string name, DataType type, std::vector<ColumnConstraint> constraints):
 name(std::move(name)), type(type), constraints(std::move(constraints)) {}
 
+Column::Column(const Column &other) : name(other.name), type(other.type), constraints(other.getConstraints()),
+                                      table(other.table) {}
+
+Column &Column::operator=(const Column &other) {
+    if (this != &other) {
+        auto otherConstraints = other.getConstraints();
+        std::lock_guard lock(constraintsMutex);
+        name = other.name;
+        type = other.type;
+        constraints = std::move(otherConstraints);
+        table = other.table;
+    }
+    return *this;
+}
+
 
 std::string Column::getName() const {
     return name;
@@ -22,9 +37,15 @@ DataType Column::getDataType() const {
 }
 
 std::vector<ColumnConstraint> Column::getConstraints() const {
+    std::lock_guard lock(constraintsMutex);
     return constraints;
 }
 
+void Column::addConstraint(ColumnConstraint constraint) {
+    std::lock_guard lock(constraintsMutex);
+    constraints.push_back(constraint);
+}
+
 std::shared_ptr<Table> Column::getTable() const {
     return table;
 }
@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <optional>
 
 class Table; // Forward declaration
@@ -20,14 +21,18 @@ class Column {
     std::string name; // Private variable to store the name of the column
     DataType type; // Private variable to store the type of the column
     std::vector<ColumnConstraint> constraints; // Private variable to store the constraint of the column
+    mutable std::mutex constraintsMutex; // An index built online adds a constraint while frozen copies read them
     std::shared_ptr<Table> table; // Private variable to store the table of the column
 public:
     Column(std::string name, DataType type, std::vector<ColumnConstraint> constraints);
     Column(std::string name, DataType type);
     Column(std::string name, DataType type, ColumnConstraint constraint);
+    Column(const Column &other);
+    Column &operator=(const Column &other);
     [[nodiscard]] virtual std::string getName() const; //  virtual function to get the name of the column
     [[nodiscard]] virtual DataType getDataType() const; //  virtual function to get the data type of the column
     [[nodiscard]] virtual std::vector<ColumnConstraint> getConstraints() const; //  virtual function to get the constraints of the column
+    virtual void addConstraint(ColumnConstraint constraint);
     [[nodiscard]] virtual std::shared_ptr<Table> getTable() const; //  virtual function to get the table of the column
     virtual void setTable(const std::shared_ptr<Table> &table); //  virtual function to set the table of the column
 };
\ No newline at end of file
@@ -1,14 +1,19 @@
 #include "CommandLineInterface.h"
-#include "Lexer.h"
+#include "MappedFile.h"
+#include "QueryServer.h"
+#include "Snapshot.h"
+#include "Recovery.h"
 #include <string>
 #include <iostream>
 
 #include <fmt/color.h>
 #include <chrono>
-#include <fstream>
 #include <algorithm>
 #include <filesystem>
+#include <thread>
 #include <utility>
+#include <csignal>
+#include <unistd.h>
 
 
 void CommandLineInterface::printHistory() {
@@ -19,18 +24,30 @@ void CommandLineInterface::printHistory() {
     }
 }
 
+void CommandLineInterface::printSchedulerStats() {
+    auto stats = database->getScheduler()->getStats();
+    fmt::print(fg(fmt::color::yellow), "Scheduler: {} workers, {} tasks run, {} stolen, {:.1f}% busy\n",
+               stats.workerCount, stats.tasksRun, stats.tasksStolen, stats.utilisation * 100);
+}
+
 
-void CommandLineInterface::run() {
+bool CommandLineInterface::run() {
     std::string input;
     std::string query;
     fmt::print(fg(fmt::color::green), "Welcome to FranekQL!\n");
-    fmt::print(fg(fmt::color::green), "Type \\q to quit, \\s to save current state of database, \\d <filename> to "
-                                      "load queries from file, \\h to print command history\n");
+    if (!recover()) {
+        return false;
+    }
+    fmt::print(fg(fmt::color::green), "Type \\q to quit, \\s to save current state of database, \\c to write a "
+                                      "checkpoint, \\k to compact the log, \\d <filename> to load queries from file, \\h to "
+                                      "print command history, \\w to print scheduler statistics\n");
     fmt::print(fg(fmt::color::green), "db > ");
     while (true) {
-        std::getline(std::cin, input);
-
-        if (input == "\\q") {
+        if (!std::getline(std::cin, input) || input == "\\q") {
+            // End of input behaves like \q
+            if (queryExecutor->rollbackOpenTransaction()) {
+                fmt::print(fg(fmt::color::yellow), "The open transaction was rolled back\n");
+            }
             saveQueries();
             break;
         }
@@ -40,8 +57,19 @@ void CommandLineInterface::run() {
             continue;
         }
 
+        if (input == "\\c") {
+            checkpoint();
+            continue;
+        }
+
+        if (input == "\\k") {
+            compactLog();
+            continue;
+        }
+
         if (input.substr(0, 2) == "\\d") {
             loadQueries(input.substr(3));
+            compactLogIfLarge();
             continue;
         }
 
@@ -50,14 +78,22 @@ void CommandLineInterface::run() {
             continue;
         }
 
+        if (input == "\\w") {
+            printSchedulerStats();
+            continue;
+        }
+
+        if (!query.empty()) {
+            query += '\n'; // Keep the lines of a multi-line query apart
+        }
         query += input;
 
         if (!query.empty() && query.back() == ';') {
             commandHistory.push_back(input);
             try {
+                // Queries that change the database are written to the log by the executor
                 queryExecutor->execute(query);
-                addQueryToSuccessfulQueries(query);
-                // Check if the query is not a SELECT query before adding it to successfulQueries
+                compactLogIfLarge();
                 fmt::print(fg(fmt::color::green), "db > ");
             } catch (const std::exception &e) {
                 fmt::print(fg(fmt::color::red), "Error executing query: {}\n", e.what());
@@ -65,57 +101,173 @@ void CommandLineInterface::run() {
             query.clear();
         }
     }
+    return true;
 }
 
-CommandLineInterface::CommandLineInterface(std::shared_ptr<QueryExecutor> queryExecutor)
-        : queryExecutor(std::move(queryExecutor)) {}
+static sigset_t stopSignals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    return signals;
+}
 
-void CommandLineInterface::saveQueries() {
-    std::string filename = "event_source_backup.franekql";
+void CommandLineInterface::blockStopSignals() {
+    sigset_t signals = stopSignals();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
 
-    std::ofstream file(filename, std::ios::app);
-    if (!file) {
-        fmt::print(fg(fmt::color::red), "Error opening file for writing: {}\n", filename);
-        return;
+bool CommandLineInterface::serve(const std::string &address, size_t workerCount) {
+    fmt::print(fg(fmt::color::green), "Welcome to FranekQL!\n");
+    if (!recover()) {
+        return false;
     }
 
-    for (const auto &query: successfulQueries) {
-        file << query << std::endl;
+    QueryServer server(queryExecutor, workerCount, [this] { compactLogIfLarge(); });
+    try {
+        server.listen(address);
+    } catch (const std::exception &e) {
+        fmt::print(fg(fmt::color::red), "Error starting the server: {}\n", e.what());
+        return false;
     }
+    fmt::print(fg(fmt::color::green), "Listening on {} with {} workers, stop with Ctrl+C\n", address, workerCount);
 
-    file.close();
+    std::thread serving([&] {
+        try {
+            server.run();
+        } catch (const std::exception &e) {
+            fmt::print(fg(fmt::color::red), "Server error: {}\n", e.what());
+            // Sent to the process, not to this thread which blocks it too, so the wait below receives it
+            ::kill(::getpid(), SIGTERM);
+        }
+    });
+    sigset_t signals = stopSignals();
+    int received = 0;
+    sigwait(&signals, &received);
+    server.stop();
+    serving.join();
+    saveQueries();
+    return true;
+}
 
-    successfulQueries.clear();
+CommandLineInterface::CommandLineInterface(std::shared_ptr<QueryExecutor> queryExecutor,
+                                           std::shared_ptr<Database> database, WriteAheadLog::Options logOptions)
+        : queryExecutor(std::move(queryExecutor)), database(std::move(database)), logOptions(logOptions) {}
 
-    fmt::print(fg(fmt::color::green), "Queries saved to {}\n", filename);
+void CommandLineInterface::saveQueries() {
+    if (!log) {
+        return;
+    }
+
+    try {
+        log->sync();
+    } catch (const std::exception &e) {
+        fmt::print(fg(fmt::color::red), "Error saving queries to {}: {}\n", BACKUP_FILENAME, e.what());
+        return;
+    }
+
+    fmt::print(fg(fmt::color::green), "Queries saved to {}\n", BACKUP_FILENAME);
 }
 
 void CommandLineInterface::loadQueries(const std::string &filename) {
-    std::ifstream file(filename);
-    if (!file) {
+    std::unique_ptr<MappedFile> file;
+    try {
+        file = std::make_unique<MappedFile>(filename);
+    } catch (const std::exception &) {
         fmt::print(fg(fmt::color::red), "Error opening file for reading: {}\n", filename);
         return;
     }
 
-    std::string query;
-    while (std::getline(file, query)) {
+    ScriptResult result = queryExecutor->executeScript(file->view());
+
+    fmt::print(fg(fmt::color::green), "Queries loaded from {} ({} executed, {} failed)\n", filename,
+               result.executed, result.failed);
+}
+
+void CommandLineInterface::checkpoint() {
+    // Without a log the database was not recovered, a snapshot of it would replace the files that hold the data
+    if (!compactor) {
+        return;
+    }
+    if (startCheckpoint()) {
+        fmt::print(fg(fmt::color::green), "Checkpoint started in the background\n");
+    } else {
+        fmt::print(fg(fmt::color::yellow), "A checkpoint or log compaction is already running\n");
+    }
+}
+
+bool CommandLineInterface::startCheckpoint() {
+    if (compactor->isRunning()) {
+        return false; // Do not freeze for nothing
+    }
+    // Statements are logged under the locks the freeze waits for, so the view reflects exactly
+    // the records appended so far
+    uint64_t logSequence = 0;
+    auto view = database->freeze([&] { logSequence = log->getAppendedSequence(); });
+    return compactor->startCheckpoint(std::move(view), logSequence);
+}
+
+bool CommandLineInterface::recover() {
+    bool hasBackup = std::filesystem::exists(BACKUP_FILENAME) && std::filesystem::file_size(BACKUP_FILENAME) > 0;
+    bool isLegacyBackup = hasBackup && !WriteAheadLog::isLog(BACKUP_FILENAME);
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        // A plain-text backup from an older version is not a log, it is replayed separately below
+        RecoveryResult result = Recovery::restore(database, SNAPSHOT_FILENAME,
+                                                  isLegacyBackup ? "" : BACKUP_FILENAME);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+        if (result.snapshotLoaded || result.replayed || result.failed) {
+            fmt::print(fg(fmt::color::green), "Database recovered in {} ms (snapshot: {}, log records replayed: {}, "
+                                              "failed: {})\n", elapsed.count(), result.snapshotLoaded ? "yes" : "no",
+                       result.replayed, result.failed);
+        }
+    } catch (const std::exception &e) {
+        // Statements run now would never be logged, and a checkpoint would replace the files that failed to load
+        fmt::print(fg(fmt::color::red), "Error recovering database: {}\nRefusing to start, repair or move away "
+                                        "{} and {}\n", e.what(), SNAPSHOT_FILENAME, BACKUP_FILENAME);
+        return false;
+    }
+
+    if (isLegacyBackup) {
+        // Fold the old backup into a snapshot so the log can take its place
+        loadQueries(BACKUP_FILENAME);
         try {
-            queryExecutor->execute(query);
+            Snapshot::write(*database, SNAPSHOT_FILENAME, 0);
+            std::filesystem::remove(BACKUP_FILENAME);
         } catch (const std::exception &e) {
-            std::cerr << "Error executing query: " << e.what() << std::endl;
+            fmt::print(fg(fmt::color::red), "Error converting {}: {}\n", BACKUP_FILENAME, e.what());
+            return false;
         }
     }
 
-    file.close();
-    fmt::print(fg(fmt::color::green), "Queries loaded from {}\n", filename);
+    try {
+        const auto &storage = database->getStorage();
+        log = std::make_shared<WriteAheadLog>(BACKUP_FILENAME, logOptions, storage ? storage->getIo() : nullptr);
+    } catch (const std::exception &e) {
+        fmt::print(fg(fmt::color::red), "Error opening log {}: {}\n", BACKUP_FILENAME, e.what());
+        return false;
+    }
+    compactor = std::make_unique<LogCompactor>(SNAPSHOT_FILENAME, log);
+    queryExecutor->setWriteAheadLog(log);
+    return true;
 }
 
-void CommandLineInterface::addQueryToSuccessfulQueries(std::string const& query) {
-    Lexer lexer(query);
-    Token token = lexer.nextToken();
-
-    if (token.type != TokenType::SELECT) {
-        successfulQueries.push_back(query);
+void CommandLineInterface::compactLog() {
+    if (!compactor) {
+        return;
+    }
+    // The frozen view already is what a replay of the snapshot and the log would rebuild
+    if (startCheckpoint()) {
+        fmt::print(fg(fmt::color::green), "Log compaction started in the background\n");
+    } else {
+        fmt::print(fg(fmt::color::yellow), "A checkpoint or log compaction is already running\n");
     }
 }
 
+void CommandLineInterface::compactLogIfLarge() {
+    if (compactor && log->size() > COMPACTION_THRESHOLD) {
+        (void) startCheckpoint();
+    }
+}
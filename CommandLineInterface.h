@@ -1,16 +1,40 @@
 #pragma once
 #include "QueryExecutor.h"
+#include "LogCompactor.h"
 
 
 class CommandLineInterface {
+    static constexpr auto BACKUP_FILENAME = "event_source_backup.franekql"; // Write-ahead log since the last checkpoint
+    static constexpr auto SNAPSHOT_FILENAME = "snapshot.franekql"; // Binary image written by the last checkpoint
+    static constexpr uint64_t COMPACTION_THRESHOLD = 64 << 20; // Log size that starts a background checkpoint
+
     std::shared_ptr<QueryExecutor> queryExecutor;
+    std::shared_ptr<Database> database;
+    WriteAheadLog::Options logOptions;
+    std::shared_ptr<WriteAheadLog> log; // Opened by recover()
+    std::unique_ptr<LogCompactor> compactor; // Created together with the log
     std::vector<std::string> commandHistory;
-    std::vector<std::string> successfulQueries;
+
+    // Freezes the database and writes it as the snapshot in the background. False when a job is already running.
+    virtual bool startCheckpoint();
 public:
-    explicit CommandLineInterface(std::shared_ptr<QueryExecutor> queryExecutor);
-    virtual void run();
+    CommandLineInterface(std::shared_ptr<QueryExecutor> queryExecutor, std::shared_ptr<Database> database,
+                         WriteAheadLog::Options logOptions);
+    virtual bool run(); // False when the database could not be recovered
+    // Recovers the database and serves it to clients until SIGINT or SIGTERM, see QueryServer.
+    // False when the database could not be recovered or the server could not start listening.
+    virtual bool serve(const std::string &address, size_t workerCount);
+    // Blocks SIGINT and SIGTERM for the calling thread and the threads it starts later, so serve() receives them.
+    // Has to run before the first thread is started.
+    static void blockStopSignals();
     virtual void printHistory();
+    virtual void printSchedulerStats(); // Workers, tasks run and stolen, share of time spent busy
     virtual void saveQueries();
     virtual void loadQueries(const std::string &filename);
-    virtual void addQueryToSuccessfulQueries(std::string const& basicString);
+    virtual void checkpoint(); // Writes a snapshot in the background and drops the log records it covers
+    // Loads the snapshot, replays the log written after it and starts logging. False when any of it failed,
+    // the database must not take statements then.
+    [[nodiscard]] virtual bool recover();
+    virtual void compactLog(); // Folds the log into the snapshot in the background, by a checkpoint
+    virtual void compactLogIfLarge(); // Starts a checkpoint when the log has grown over COMPACTION_THRESHOLD
 };
\ No newline at end of file
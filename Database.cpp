@@ -1,12 +1,29 @@
 #include "Database.h"
 #include "fmt/core.h"
 #include <algorithm>
+#include <array>
+#include <iterator>
+#include <map>
+#include <set>
+#include <unordered_map>
 #include "TableValidator.h"
+#include "HashIndex.h"
+#include "EquiJoin.h"
+#include "TableSegment.h"
+
+// Drops the rows before the OFFSET of a select and the ones past its LIMIT
+template<typename Rows>
+static void keepPage(Rows &rows, const SelectQuery &query) {
+    rows.erase(rows.begin(), rows.begin() + static_cast<std::ptrdiff_t>(std::min(query.offset, rows.size())));
+    if (query.limit && rows.size() > *query.limit) {
+        rows.resize(*query.limit);
+    }
+}
 
 
-void Database::createTable(const CreateTableQuery &query) {
+void Database::createTable(const CreateTableQuery &query, const std::function<void()> &atCommit) {
     // Create a new table with the name and columns from the query
-    auto table = std::make_shared<Table>(query.tableName);
+    auto table = std::make_shared<Table>(query.tableName, storage);
 
     // Add the columns to the table
     for (const auto &column: query.columns) {
@@ -41,10 +58,12 @@ void Database::createTable(const CreateTableQuery &query) {
                     "Foreign key column " + relation.getForeignKeyColumnName() + " not found in table " +
                     query.tableName);
         }
-        auto referencedTable = tables[relation.getReferencedTableName()];
-        if (!referencedTable) {
+        // find, as operator[] would leave a null table under the missing name for every later scan to trip over
+        auto referenced = tables.find(relation.getReferencedTableName());
+        if (referenced == tables.end()) {
             throw std::runtime_error("Referenced table " + relation.getReferencedTableName() + " not found");
         }
+        auto referencedTable = referenced->second;
         auto referencedColumnName = referencedTable->getColumn(relation.getReferencedColumnName());
         if (!referencedColumnName.has_value()) {
             throw std::runtime_error(
@@ -59,11 +78,77 @@ void Database::createTable(const CreateTableQuery &query) {
 
     TableValidator::validateTableCreation(*table, *this);
 
+    // Logged once the table is known to be valid and before anyone can see it
+    if (atCommit) {
+        atCommit();
+    }
     // Add the table to the database
     tables[query.tableName] = table;
 }
 
-void Database::insertInto(const InsertQuery &query) {
+void Database::insertInto(const InsertQuery &query, const std::function<void()> &atCommit) {
+    auto [table, builder] = prepareInsert(query);
+
+    // Insert the data into the table
+    table->addRow(builder, clock, atCommit);
+}
+
+void Database::insertBatch(const InsertBatchQuery &query, const std::function<void()> &atCommit) {
+    PendingKeys pending;
+    std::vector<std::pair<std::shared_ptr<Table>, Row>> rows;
+    rows.reserve(query.inserts.size());
+    for (const auto &insert: query.inserts) {
+        rows.push_back(prepareRow(*insert, pending));
+    }
+
+    // Other inserts run meanwhile, the keys are only safe once claimed
+    for (size_t i = 0; i < rows.size(); ++i) {
+        try {
+            rows[i].first->claimKeys(rows[i].second);
+        } catch (...) {
+            for (size_t j = 0; j < i; ++j) {
+                rows[j].first->releaseKeys(rows[j].second);
+            }
+            throw;
+        }
+    }
+
+    std::vector<std::shared_ptr<Table>> targets;
+    clock.commit([&](uint64_t version) {
+        // The log record goes first, rows are never visible without it
+        size_t next = 0; // Rows before it were appended, or gave back their claims when their append failed
+        try {
+            if (atCommit) {
+                atCommit();
+            }
+            while (next < rows.size()) {
+                auto &[table, row] = rows[next++];
+                table->addValidatedRow(std::move(row), version);
+                targets.push_back(table);
+            }
+        } catch (...) {
+            for (size_t i = next; i < rows.size(); ++i) {
+                rows[i].first->releaseKeys(rows[i].second);
+            }
+            throw;
+        }
+    });
+    std::ranges::sort(targets);
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    for (const auto &table: targets) {
+        table->sealFullSegments();
+    }
+}
+
+std::pair<std::shared_ptr<Table>, Row> Database::prepareRow(const InsertQuery &query, PendingKeys &pending) const {
+    auto [table, builder] = prepareInsert(query);
+    Row row = table->buildRow(builder);
+    RowValidator::validateDataInsertion(*table, row, &pending);
+    RowValidator::addPendingKeys(*table, row, pending);
+    return {table, std::move(row)};
+}
+
+std::pair<std::shared_ptr<Table>, RowBuilder> Database::prepareInsert(const InsertQuery &query) const {
     // Find the table
     std::vector<std::string> queryColumns = query.columns;
 
@@ -114,16 +199,39 @@ void Database::insertInto(const InsertQuery &query) {
         builder.set(*found, value);
     }
 
-    // Insert the data into the table
-    table->addRow(builder);
+    return {table, builder};
 }
 
-void Database::selectFrom(const SelectQuery &query) {
+QueryResult Database::selectFrom(const SelectQuery &query) {
+    if (query.join) {
+        return selectJoin(query);
+    }
+    if (std::ranges::any_of(query.whereClause.getColumnNames(), [](const std::string &columnName) {
+        return columnName.find('.') != std::string::npos;
+    })) {
+        auto local = query;
+        local.whereClause = unqualified(query.whereClause, query.fromTable);
+        return selectFrom(local);
+    }
+
     // Find the table
     auto it = tables.find(query.fromTable);
     if (it == tables.end()) {
         throw std::runtime_error("Table not found");
     }
+    if (query.distinct && query.columns.size() == 1 && query.columns.back() == "*") {
+        // DISTINCT * groups by every column of the table
+        auto distinct = query;
+        distinct.columns.clear();
+        for (const auto &column: it->second->getColumns()) {
+            distinct.columns.push_back(column->getName());
+        }
+        distinct.aggregates.assign(distinct.columns.size(), std::nullopt);
+        return selectGroups(distinct, it->second);
+    }
+    if (query.isAggregated()) {
+        return selectGroups(query, it->second);
+    }
 
     // Columns to select
     auto columnsToProcess = query.columns;
@@ -131,9 +239,6 @@ void Database::selectFrom(const SelectQuery &query) {
     // Get the table
     auto table = it->second;
 
-    // Get all rows from the table
-    auto allRows = table->getRows();
-
     // If * is specified, replace it with all column names
     if (columnsToProcess.size() == 1 && columnsToProcess.back() == "*") {
         columnsToProcess.clear();
@@ -143,33 +248,626 @@ void Database::selectFrom(const SelectQuery &query) {
         });
     }
 
+    QueryResult result;
+    result.hasRows = true;
+    result.columns = columnsToProcess;
+    std::vector<std::optional<std::shared_ptr<Column>>> selectedColumns;
+    for (const auto &columnName: columnsToProcess) {
+        selectedColumns.push_back(table->getColumn(columnName));
+    }
+
+    // ORDER BY needs typed values, its columns that are not selected are carried after the selected ones
+    std::optional<RowSorter> sorter;
+    std::vector<std::optional<std::shared_ptr<Column>>> carriedColumns = selectedColumns;
+    if (!query.orderBy.empty()) {
+        std::vector<RowSorter::Key> keys;
+        for (const auto &item: query.orderBy) {
+            auto column = table->getColumn(item.column);
+            if (!column) {
+                throw std::runtime_error("Column " + item.column + " not found");
+            }
+            auto found = std::ranges::find(carriedColumns, column);
+            keys.push_back({static_cast<size_t>(found - carriedColumns.begin()), item.descending});
+            if (found == carriedColumns.end()) {
+                carriedColumns.push_back(column);
+            }
+        }
+        sorter.emplace(std::move(keys), (*table->getColumn(query.orderBy.front().column))->getDataType(),
+                       wantedRows(query));
+    }
+
+    // Read the rows committed before the query started, inserts running meanwhile are left out
+    auto snapshot = clock.beginRead();
+    auto view = table->freeze(snapshot.getVersion());
+
+    // Segments are filtered in parallel, each into its own slot, and the slots are joined in segment order
+    size_t segmentCount = view->getSegments().size();
+    std::vector<std::vector<std::vector<std::string>>> segmentRows(sorter ? 0 : segmentCount);
+    std::vector<std::vector<RowSorter::ValueRow>> segmentValues(sorter ? segmentCount : 0);
+    // Without ORDER BY the result is the first rows in segment order, so no segment needs more than the LIMIT
+    // and the scan stops at the first wave of segments that fills it
+    auto wanted = sorter ? std::nullopt : wantedRows(query);
+    std::atomic<size_t> found = 0;
+    auto scanSegments = [&](size_t begin, size_t end) {
+        ScanRing ring;
+        for (size_t s = begin; s < end; ++s) {
+            auto pinned = view->readSegment(s, &ring);
+            for (const auto &row: *pinned) {
+                // Check if the row satisfies the conditions
+                if (!satisfiesConditions(row, query.whereClause)) {
+                    continue;
+                }
+                if (sorter) {
+                    RowSorter::ValueRow values;
+                    for (const auto &column: carriedColumns) {
+                        values.push_back(column ? row.data.at(*column) : BoxedValue());
+                    }
+                    sorter->add(segmentValues[s], std::move(values));
+                    continue;
+                }
+                // If it does, keep the values of the selected columns
+                auto &values = segmentRows[s].emplace_back();
+                for (const auto &column: selectedColumns) {
+                    values.push_back(column ? row.data.at(*column).toString() : "[Data not found]");
+                }
+                if (wanted && segmentRows[s].size() >= *wanted) {
+                    break;
+                }
+            }
+            found += sorter ? 0 : segmentRows[s].size();
+        }
+    };
+    size_t lanes = scanLanes();
+    if (wanted) {
+        scheduler->parallelForUntil(0, segmentCount, lanes, scanSegments, [&] { return found >= *wanted; });
+    } else {
+        scheduler->parallelFor(0, segmentCount, std::max<size_t>(1, (segmentCount + lanes - 1) / lanes),
+                               scanSegments);
+    }
+    if (sorter) {
+        result.rows = finishRows(std::move(segmentValues), &*sorter, query, selectedColumns.size(),
+                                 [&](const RowSorter::ValueRow &row, size_t column) {
+                                     return selectedColumns[column] ? row[column].toString() : "[Data not found]";
+                                 });
+    } else {
+        for (auto &rows: segmentRows) {
+            std::ranges::move(rows, std::back_inserter(result.rows));
+        }
+        keepPage(result.rows, query);
+    }
+    table->collectVersions(clock.getOldestReader());
+    return result;
+}
+
+std::vector<std::vector<std::string>>
+Database::finishRows(std::vector<std::vector<RowSorter::ValueRow>> chunks, const RowSorter *sorter,
+                     const SelectQuery &query, size_t width,
+                     const std::function<std::string(const RowSorter::ValueRow &row, size_t column)> &render) {
+    std::vector<RowSorter::ValueRow> rows;
+    if (sorter) {
+        rows = sorter->sort(std::move(chunks), *scheduler);
+    } else {
+        for (auto &chunk: chunks) {
+            std::ranges::move(chunk, std::back_inserter(rows));
+        }
+    }
+    keepPage(rows, query);
+
+    std::vector<std::vector<std::string>> rendered(rows.size());
+    scheduler->parallelFor(0, rows.size(), 1024, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            rendered[i].reserve(width);
+            for (size_t column = 0; column < width; ++column) {
+                rendered[i].push_back(render(rows[i], column));
+            }
+        }
+    });
+    return rendered;
+}
+
+HashAggregate Database::GroupingPlan::newAggregate() const {
+    std::vector<DataType> inputTypes;
+    for (const auto &input: inputs) {
+        inputTypes.push_back(input ? input->getDataType() : DataType::INTEGER);
+    }
+    return {aggregates, inputTypes};
+}
+
+Database::GroupingPlan Database::planGrouping(const SelectQuery &query,
+                                              const std::function<std::shared_ptr<Column>(
+                                                      const std::string &columnName)> &resolve) {
+    GroupingPlan plan;
+    for (const auto &columnName: query.groupBy) {
+        plan.keys.push_back(resolve(columnName));
+    }
+    if (query.distinct) {
+        // DISTINCT groups by the selected columns and aggregates nothing
+        bool aggregated = std::ranges::any_of(query.aggregates, [](const auto &aggregate) {
+            return aggregate.has_value();
+        });
+        if (aggregated || !query.groupBy.empty()) {
+            throw std::runtime_error("DISTINCT cannot be used with aggregates or GROUP BY");
+        }
+        for (const auto &columnName: query.columns) {
+            if (columnName == "*") {
+                throw std::runtime_error("SELECT DISTINCT * cannot be used with JOIN, name the columns");
+            }
+            auto column = resolve(columnName);
+            if (std::ranges::find(plan.keys, column) == plan.keys.end()) {
+                plan.keys.push_back(column);
+            }
+        }
+    }
+    for (size_t i = 0; i < query.columns.size(); ++i) {
+        if (i < query.aggregates.size() && query.aggregates[i]) {
+            const auto &aggregate = *query.aggregates[i];
+            plan.outputs.push_back(plan.keys.size() + plan.aggregates.size());
+            plan.aggregates.push_back(aggregate);
+            plan.inputs.push_back(aggregate.countsRows() ? nullptr : resolve(aggregate.column));
+            continue;
+        }
+        if (query.columns[i] == "*") {
+            throw std::runtime_error("SELECT * cannot be used with aggregates or GROUP BY");
+        }
+        auto key = std::ranges::find(plan.keys, resolve(query.columns[i]));
+        if (key == plan.keys.end()) {
+            throw std::runtime_error("Column " + query.columns[i] + " has to be in GROUP BY or in an aggregate");
+        }
+        plan.outputs.push_back(key - plan.keys.begin());
+    }
+
+    // Results are sorted by their names as selected, GROUP BY columns that are not selected are carried
+    for (const auto &item: query.orderBy) {
+        auto selected = std::ranges::find(query.columns, item.column);
+        if (selected != query.columns.end()) {
+            plan.order.push_back({static_cast<size_t>(selected - query.columns.begin()), item.descending});
+            continue;
+        }
+        auto key = std::ranges::find(plan.keys, resolve(item.column));
+        if (key == plan.keys.end()) {
+            throw std::runtime_error("ORDER BY " + item.column + " has to name a selected or a GROUP BY column");
+        }
+        plan.order.push_back({plan.outputs.size(), item.descending});
+        plan.outputs.push_back(key - plan.keys.begin());
+    }
+    return plan;
+}
+
+QueryResult Database::selectGroups(const SelectQuery &query, const std::shared_ptr<Table> &table) {
+    auto plan = planGrouping(query, [&](const std::string &columnName) {
+        auto column = table->getColumn(columnName);
+        if (!column) {
+            throw std::runtime_error("Column " + columnName + " not found");
+        }
+        return *column;
+    });
+    auto aggregate = plan.newAggregate();
+
+    // Without WHERE and GROUP BY, COUNT(*), MIN, MAX and APPROX_COUNT_DISTINCT come from the row count and
+    // the column summaries of every full segment, only the segments still filling up are read
+    bool summarised = query.whereClause.conditions.empty() && plan.keys.empty()
+                      && std::ranges::all_of(plan.aggregates, [](const Aggregate &aggregate) {
+                          return aggregate.countsRows() || aggregate.function == Aggregate::Function::MIN
+                                 || aggregate.function == Aggregate::Function::MAX
+                                 || aggregate.function == Aggregate::Function::APPROX_COUNT_DISTINCT;
+                      });
+
+    auto snapshot = clock.beginRead();
+    auto view = table->freeze(snapshot.getVersion());
+
+    // Every task folds its segments into its own partial aggregate, looking the values up in place
+    size_t segmentCount = view->getSegments().size();
+    size_t lanes = scanLanes();
+    size_t grainSize = std::max<size_t>(1, (segmentCount + lanes - 1) / lanes);
+    std::vector<HashAggregate::Partial> partials((segmentCount + grainSize - 1) / grainSize);
+    scheduler->parallelFor(0, segmentCount, grainSize, [&](size_t begin, size_t end) {
+        auto &partial = partials[begin / grainSize];
+        HashAggregate::ValueRefs keys(plan.keys.size());
+        HashAggregate::ValueRefs inputs(plan.inputs.size());
+        ScanRing ring;
+        for (size_t s = begin; s < end; ++s) {
+            if (summarised && addSummary(plan, aggregate, *view->getSegments()[s], partial)) {
+                continue;
+            }
+            auto pinned = view->readSegment(s, &ring);
+            for (const auto &row: *pinned) {
+                if (!satisfiesConditions(row, query.whereClause)) {
+                    continue;
+                }
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    keys[i] = &row.data.at(plan.keys[i]);
+                }
+                for (size_t i = 0; i < inputs.size(); ++i) {
+                    inputs[i] = plan.inputs[i] ? &row.data.at(plan.inputs[i]) : nullptr;
+                }
+                aggregate.add(partial, keys, inputs);
+            }
+        }
+    });
+
+    QueryResult result;
+    result.hasRows = true;
+    result.columns = query.columns;
+    result.rows = finishGroups(query, plan, aggregate, std::move(partials));
+    table->collectVersions(clock.getOldestReader());
+    return result;
+}
+
+bool Database::addSummary(const GroupingPlan &plan, const HashAggregate &aggregate, const TableSegment &segment,
+                          HashAggregate::Partial &partial) {
+    std::vector<const TableSegment::ColumnSummary *> summaries(plan.inputs.size());
+    for (size_t i = 0; i < summaries.size(); ++i) {
+        if (!plan.inputs[i]) {
+            continue; // COUNT(*)
+        }
+        summaries[i] = segment.getSummary(plan.inputs[i]);
+        if (!summaries[i]) {
+            return false;
+        }
+    }
+    aggregate.addSummary(partial, summaries, segment.size());
+    return true;
+}
+
+std::vector<HashAggregate::Partial>
+Database::aggregateRows(const GroupingPlan &plan, const HashAggregate &aggregate,
+                        std::vector<std::vector<RowSorter::ValueRow>> chunks) {
+    size_t lanes = scanLanes();
+    size_t grainSize = std::max<size_t>(1, (chunks.size() + lanes - 1) / lanes);
+    std::vector<HashAggregate::Partial> partials((chunks.size() + grainSize - 1) / grainSize);
+    scheduler->parallelFor(0, chunks.size(), grainSize, [&](size_t begin, size_t end) {
+        auto &partial = partials[begin / grainSize];
+        HashAggregate::ValueRefs keys(plan.keys.size());
+        HashAggregate::ValueRefs inputs(plan.inputs.size());
+        for (size_t c = begin; c < end; ++c) {
+            for (const auto &row: chunks[c]) {
+                size_t next = 0;
+                for (auto &key: keys) {
+                    key = &row[next++];
+                }
+                for (size_t i = 0; i < inputs.size(); ++i) {
+                    inputs[i] = plan.inputs[i] ? &row[next++] : nullptr;
+                }
+                aggregate.add(partial, keys, inputs);
+            }
+        }
+    });
+    return partials;
+}
+
+std::vector<std::vector<std::string>>
+Database::finishGroups(const SelectQuery &query, const GroupingPlan &plan, const HashAggregate &aggregate,
+                       std::vector<HashAggregate::Partial> partials) {
+    auto groups = aggregate.merge(std::move(partials), !plan.keys.empty(), *scheduler);
+    std::optional<RowSorter> sorter;
+    if (!plan.order.empty()) {
+        size_t position = plan.outputs[plan.order.front().value];
+        sorter.emplace(plan.order, position < plan.keys.size() ? plan.keys[position]->getDataType()
+                                                               : aggregate.resultType(position - plan.keys.size()),
+                       wantedRows(query));
+    }
+
+    // Exact sums of the SUMs of INTEGER follow the outputs, their DOUBLE results only order the rows
+    size_t exactSums = plan.keys.size() + plan.aggregates.size();
+    std::vector<std::optional<size_t>> exactColumns(plan.outputs.size());
+    std::vector<size_t> exactPositions;
+    for (size_t column = 0; column < plan.outputs.size(); ++column) {
+        size_t position = plan.outputs[column];
+        if (position < plan.keys.size()) {
+            continue;
+        }
+        if (auto exact = aggregate.exactSum(position - plan.keys.size())) {
+            exactColumns[column] = plan.outputs.size() + exactPositions.size();
+            exactPositions.push_back(exactSums + *exact);
+        }
+    }
+
+    std::vector<std::vector<RowSorter::ValueRow>> chunks(1);
+    for (auto &group: groups) {
+        RowSorter::ValueRow row;
+        row.reserve(plan.outputs.size() + exactPositions.size());
+        for (size_t position: plan.outputs) {
+            row.push_back(group[position]);
+        }
+        for (size_t position: exactPositions) {
+            row.push_back(std::move(group[position]));
+        }
+        if (sorter) {
+            sorter->add(chunks.front(), std::move(row));
+        } else {
+            chunks.front().push_back(std::move(row));
+        }
+    }
+    return finishRows(std::move(chunks), sorter ? &*sorter : nullptr, query, query.columns.size(),
+                      [&](const RowSorter::ValueRow &row, size_t column) {
+                          size_t position = plan.outputs[column];
+                          if (exactColumns[column]) {
+                              return row[*exactColumns[column]].toString();
+                          }
+                          return position < plan.keys.size() ? row[column].toString()
+                                                             : aggregate.toString(position - plan.keys.size(),
+                                                                                  row[column]);
+                      });
+}
+
+std::optional<size_t> Database::wantedRows(const SelectQuery &query) {
+    if (!query.limit || *query.limit > SIZE_MAX - query.offset) {
+        return std::nullopt; // More rows than a table can hold, the same as no limit
+    }
+    return query.offset + *query.limit;
+}
+
+size_t Database::scanLanes() const {
+    // Every lane pins one page at a time, so lanes are capped to leave most of the buffer pool to other readers
+    size_t lanes = scheduler->size() + 1;
+    if (storage) {
+        auto &pool = storage->getBufferPool();
+        size_t pageBytes = pool.getLargestPageBytes();
+        if (pageBytes > 0) {
+            lanes = std::clamp<size_t>(pool.getBudget() / (4 * pageBytes), 1, lanes);
+        }
+    }
+    return lanes;
+}
+
+QueryResult Database::selectJoin(const SelectQuery &query) {
+    auto leftIt = tables.find(query.fromTable);
+    auto rightIt = tables.find(query.join->tableName);
+    if (leftIt == tables.end() || rightIt == tables.end()) {
+        throw std::runtime_error("Table not found");
+    }
+    if (leftIt == rightIt) {
+        throw std::runtime_error("Table " + query.fromTable + " cannot be joined with itself");
+    }
+    std::array<std::shared_ptr<Table>, 2> joined{leftIt->second, rightIt->second};
+
+    // Every column goes by table.column, and by its own name unless both tables have a column of that name
+    std::unordered_map<std::string, std::optional<JoinedColumn>> names;
+    for (size_t side = 0; side < joined.size(); ++side) {
+        for (const auto &column: joined[side]->getColumns()) {
+            names[joined[side]->getName() + "." + column->getName()] = JoinedColumn{side, column};
+            auto [it, inserted] = names.try_emplace(column->getName(), JoinedColumn{side, column});
+            if (!inserted) {
+                it->second.reset();
+            }
+        }
+    }
+    auto resolve = [&](const std::string &name) {
+        auto it = names.find(name);
+        if (it == names.end()) {
+            throw std::runtime_error("Column " + name + " not found in the joined tables");
+        }
+        if (!it->second) {
+            throw std::runtime_error("Column " + name + " is ambiguous, qualify it with its table name");
+        }
+        return *it->second;
+    };
+
+    // The key of each table, side 0 first
+    std::array<JoinedColumn, 2> keys{resolve(query.join->leftColumn), resolve(query.join->rightColumn)};
+    if (keys[0].side == keys[1].side) {
+        throw std::runtime_error("JOIN has to compare a column of each table");
+    }
+    if (keys[0].side == 1) {
+        std::swap(keys[0], keys[1]);
+    }
+    if (keys[0].column->getDataType() != keys[1].column->getDataType()) {
+        throw std::runtime_error("Columns " + query.join->leftColumn + " and " + query.join->rightColumn
+                                 + " have different types");
+    }
+
+    QueryResult result;
+    result.hasRows = true;
+    std::vector<JoinedColumn> selectedColumns;
+    std::optional<GroupingPlan> grouping;
+    std::optional<HashAggregate> aggregate;
+    if (query.isAggregated()) {
+        // Pairs carry the GROUP BY columns, then the column of every aggregate but COUNT(*)
+        std::map<std::shared_ptr<Column>, size_t> columnSides;
+        grouping = planGrouping(query, [&](const std::string &columnName) {
+            auto column = resolve(columnName);
+            columnSides[column.column] = column.side;
+            return column.column;
+        });
+        aggregate.emplace(grouping->newAggregate());
+        result.columns = query.columns;
+        for (const auto &column: grouping->keys) {
+            selectedColumns.push_back({columnSides.at(column), column});
+        }
+        for (const auto &column: grouping->inputs) {
+            if (column) {
+                selectedColumns.push_back({columnSides.at(column), column});
+            }
+        }
+    } else if (query.columns.size() == 1 && query.columns.back() == "*") {
+        for (size_t side = 0; side < joined.size(); ++side) {
+            for (const auto &column: joined[side]->getColumns()) {
+                result.columns.push_back(joined[side]->getName() + "." + column->getName());
+                selectedColumns.push_back({side, column});
+            }
+        }
+    } else {
+        result.columns = query.columns;
+        for (const auto &columnName: query.columns) {
+            selectedColumns.push_back(resolve(columnName));
+        }
+    }
+
+    // Conditions on one table filter its rows before they are paired, the others are checked on the pairs
+    std::array<ConditionGroup, 2> sideConditions{ConditionGroup(TokenType::AND), ConditionGroup(TokenType::AND)};
+    ConditionGroup pairConditions(TokenType::AND);
+    for (const auto &conjunct: query.whereClause.getConjuncts()) {
+        ConditionGroup part(TokenType::AND);
+        part.conditions.push_back(conjunct);
+        std::array<bool, 2> uses{};
+        for (const auto &columnName: part.getColumnNames()) {
+            uses[resolve(columnName).side] = true;
+        }
+        if (uses[0] && uses[1]) {
+            pairConditions.conditions.push_back(conjunct);
+        } else {
+            sideConditions[uses[1] ? 1 : 0].conditions.push_back(conjunct);
+        }
+    }
+    std::array<JoinFilter, 2> sideFilters{joinFilter(sideConditions[0], resolve),
+                                          joinFilter(sideConditions[1], resolve)};
+    auto pairFilter = joinFilter(pairConditions, resolve);
+    auto isUnique = [&](const std::string &columnName) {
+        auto constraints = resolve(columnName).column->getConstraints();
+        return std::ranges::find(constraints, ColumnConstraint::PRIMARY_KEY) != constraints.end()
+               || std::ranges::find(constraints, ColumnConstraint::UNIQUE) != constraints.end();
+    };
 
-    // Container for rows that satisfy the conditions
-    std::vector<Row> selectedRows;
+    // Both tables are read as of the same version, rows committed later are left out of either
+    auto snapshot = clock.beginRead();
+    std::array<EquiJoin::Side, 2> sides;
+    for (size_t side = 0; side < sides.size(); ++side) {
+        auto &input = sides[side];
+        input.rows = joined[side]->freeze(snapshot.getVersion());
+        input.key = keys[side].column;
+        {
+            std::shared_lock tableLock(joined[side]->getMutex()); // An index may be switched on meanwhile
+            input.index = joined[side]->getIndex(keys[side].column);
+        }
+        input.filter = [&, side](const Row &row) {
+            if (sideConditions[side].conditions.empty()) {
+                return true;
+            }
+            JoinedRows rows{};
+            rows[side] = &row;
+            return sideFilters[side](rows);
+        };
+        size_t rowCount = input.rows->getRowCount();
+        input.estimatedRows = static_cast<double>(rowCount)
+                              * EquiJoin::estimateSelectivity(sideConditions[side], isUnique, rowCount);
+    }
+
+    // ORDER BY columns that are not selected are carried after the selected ones
+    auto carriedColumns = selectedColumns;
+    std::optional<RowSorter> sorter;
+    if (!query.orderBy.empty() && !grouping) {
+        std::vector<RowSorter::Key> sortKeys;
+        for (const auto &item: query.orderBy) {
+            auto column = resolve(item.column);
+            auto found = std::ranges::find_if(carriedColumns, [&](const JoinedColumn &carried) {
+                return carried.column == column.column;
+            });
+            sortKeys.push_back({static_cast<size_t>(found - carriedColumns.begin()), item.descending});
+            if (found == carriedColumns.end()) {
+                carriedColumns.push_back(column);
+            }
+        }
+        sorter.emplace(std::move(sortKeys), resolve(query.orderBy.front().column).column->getDataType(),
+                       wantedRows(query));
+    }
 
-    // Iterate over each row
-    for (const auto &row: allRows) {
-        // Check if the row satisfies the conditions
-        if (satisfiesConditions(row, query.whereClause)) {
-            // If it does, add it to selectedRows
-            selectedRows.push_back(row);
+    EquiJoin join(std::move(sides), *scheduler, scanLanes());
+    auto chunks = join.run(join.plan(), [&](EquiJoin::OutputRows &output, const Row &left, const Row &right) {
+        if (!pairConditions.conditions.empty() && !pairFilter({&left, &right})) {
+            return;
+        }
+        RowSorter::ValueRow values;
+        std::array<const Row *, 2> pair{&left, &right};
+        for (const auto &column: carriedColumns) {
+            values.push_back(pair[column.side]->data.at(column.column));
+        }
+        if (sorter) {
+            sorter->add(output, std::move(values));
+        } else {
+            output.push_back(std::move(values));
         }
+    }, sorter || grouping ? std::nullopt : wantedRows(query));
+    if (grouping) {
+        auto partials = aggregateRows(*grouping, *aggregate, std::move(chunks));
+        result.rows = finishGroups(query, *grouping, *aggregate, std::move(partials));
+    } else {
+        result.rows = finishRows(std::move(chunks), sorter ? &*sorter : nullptr, query, selectedColumns.size(),
+                                 [](const RowSorter::ValueRow &row, size_t column) {
+                                     return row[column].toString();
+                                 });
+    }
+    for (const auto &table: joined) {
+        table->collectVersions(clock.getOldestReader());
     }
+    return result;
+}
 
-    // Display the data in selectedRows
-    columnsToDisplay(selectedRows, columnsToProcess);
+Database::JoinFilter Database::joinFilter(const ConditionGroup &conditionGroup,
+                                          const std::function<JoinedColumn(const std::string &columnName)> &resolve) {
+    std::vector<JoinFilter> parts;
+    for (const auto &conditionVariant: conditionGroup.conditions) {
+        if (std::holds_alternative<ConditionGroup>(conditionVariant)) {
+            parts.push_back(joinFilter(std::get<ConditionGroup>(conditionVariant), resolve));
+            continue;
+        }
+        const auto &condition = std::get<Condition>(conditionVariant);
+        parts.push_back([this, column = resolve(condition.column), condition](const JoinedRows &rows) {
+            const Row *row = rows[column.side];
+            const BoxedValue *value = nullptr;
+            if (row) {
+                auto it = row->data.find(column.column);
+                value = it == row->data.end() ? nullptr : &it->second;
+            }
+            return satisfiesCondition(value, condition);
+        });
+    }
+    if (conditionGroup.logicalOperator == TokenType::AND) {
+        return [parts = std::move(parts)](const JoinedRows &rows) {
+            return std::ranges::all_of(parts, [&](const JoinFilter &part) { return part(rows); });
+        };
+    }
+    return [parts = std::move(parts)](const JoinedRows &rows) {
+        return std::ranges::any_of(parts, [&](const JoinFilter &part) { return part(rows); });
+    };
+}
+
+ConditionGroup Database::unqualified(const ConditionGroup &conditionGroup, const std::string &tableName) {
+    ConditionGroup result(conditionGroup.logicalOperator);
+    for (const auto &conditionVariant: conditionGroup.conditions) {
+        if (std::holds_alternative<ConditionGroup>(conditionVariant)) {
+            result.addConditionGroup(unqualified(std::get<ConditionGroup>(conditionVariant), tableName));
+            continue;
+        }
+        auto condition = std::get<Condition>(conditionVariant);
+        auto dot = condition.column.find('.');
+        if (dot != std::string::npos) {
+            if (condition.column.substr(0, dot) != tableName) {
+                throw std::runtime_error("Column " + condition.column + " is not a column of " + tableName);
+            }
+            condition.column.erase(0, dot + 1);
+        }
+        result.addCondition(condition);
+    }
+    return result;
 }
 
 bool Database::satisfiesConditions(const Row &row, const ConditionGroup &conditionGroup) {
+    return satisfiesConditions([&](const std::string &columnName) -> const BoxedValue * {
+        auto it = std::find_if(row.begin(), row.end(), [&](const auto &pair) {
+            return pair.first->getName() == columnName;
+        });
+        return it == row.end() ? nullptr : &it->second;
+    }, conditionGroup);
+}
+
+bool Database::satisfiesCondition(const Row &row, const Condition &condition) {
+    // Find the column in the row
+    auto it = std::find_if(row.begin(), row.end(), [&](const auto &pair) {
+        return pair.first->getName() == condition.column;
+    });
+    return satisfiesCondition(it == row.end() ? nullptr : &it->second, condition);
+}
+
+bool Database::satisfiesConditions(const ValueLookup &lookup, const ConditionGroup &conditionGroup) {
     if (conditionGroup.logicalOperator == TokenType::AND) {
         // For AND conditions, use all_of
         return std::ranges::all_of(conditionGroup.conditions, [&](const auto &conditionVariant) {
             if (std::holds_alternative<Condition>(conditionVariant)) {
                 const auto &condition = std::get<Condition>(conditionVariant);
-                return satisfiesCondition(row, condition);
+                return satisfiesCondition(lookup(condition.column), condition);
             } else {
                 const auto &nestedConditionGroup = std::get<ConditionGroup>(conditionVariant);
-                return satisfiesConditions(row, nestedConditionGroup);
+                return satisfiesConditions(lookup, nestedConditionGroup);
             }
         });
     } else {
@@ -177,44 +875,39 @@ bool Database::satisfiesConditions(const Row &row, const ConditionGroup &conditi
         return std::ranges::any_of(conditionGroup.conditions, [&](const auto &conditionVariant) {
             if (std::holds_alternative<Condition>(conditionVariant)) {
                 const auto &condition = std::get<Condition>(conditionVariant);
-                return satisfiesCondition(row, condition);
+                return satisfiesCondition(lookup(condition.column), condition);
             } else {
                 const auto &nestedConditionGroup = std::get<ConditionGroup>(conditionVariant);
-                return satisfiesConditions(row, nestedConditionGroup);
+                return satisfiesConditions(lookup, nestedConditionGroup);
             }
         });
     }
 }
 
-bool Database::satisfiesCondition(const Row &row, const Condition &condition) {
-    // Find the column in the row
-    auto it = std::find_if(row.begin(), row.end(), [&](const auto &pair) {
-        return pair.first->getName() == condition.column;
-    });
-
+bool Database::satisfiesCondition(const BoxedValue *value, const Condition &condition) {
     // If the column is not found, return false
-    if (it == row.end()) {
+    if (!value) {
         return false;
     }
     if (condition.op == "IS_NULL") {
-        return !(it->second.has_value());
+        return !(value->has_value());
     } else if (condition.op == "IS_NOT_NULL") {
-        return it->second.has_value();
+        return value->has_value();
     } else {
         // Check if the data in the row satisfies the condition
-        const auto condition_value = BoxedValue::fromString(condition.value, it->second.type);
+        const auto condition_value = BoxedValue::fromString(condition.value, value->type);
         if (condition.op == "<=") {
-            return it->second <= condition_value;
+            return *value <= condition_value;
         } else if (condition.op == ">=") {
-            return it->second >= condition_value;
+            return *value >= condition_value;
         } else if (condition.op == "<>") {
-            return it->second != condition_value;
+            return *value != condition_value;
         } else if (condition.op == "=") {
-            return it->second == condition_value;
+            return *value == condition_value;
         } else if (condition.op == "<") {
-            return it->second < condition_value;
+            return *value < condition_value;
         } else if (condition.op == ">") {
-            return it->second > condition_value;
+            return *value > condition_value;
         } else {
             // If the operator is not supported, throw an exception
             throw std::runtime_error("Unsupported operator: " + condition.op);
@@ -222,70 +915,93 @@ bool Database::satisfiesCondition(const Row &row, const Condition &condition) {
     }
 }
 
-void Database::columnsToDisplay(const std::vector<Row> &rows, const std::vector<std::string> &columnsToDisplay) {
-    if (rows.empty()) {
-        fmt::print("No data to display.\n");
-        return;
+std::optional<std::shared_ptr<Table>> Database::getTableDefinition(const std::string &basicString) const {
+    auto it = tables.find(basicString);
+    if (it == tables.end()) {
+        return std::nullopt;
     }
+    return it->second;
+}
 
-    // Structure to hold column name and its width
-    struct ColumnInfo {
-        std::string name;
-        size_t width;
-    };
+Database::Database(std::shared_ptr<TableStorage> storage, std::shared_ptr<TaskScheduler> scheduler)
+        : storage(std::move(storage)), scheduler(std::move(scheduler)) {
+    if (!this->scheduler) {
+        this->scheduler = std::make_shared<TaskScheduler>();
+    }
+}
 
-    std::vector<ColumnInfo> columns;
-    for (const auto &columnName: columnsToDisplay) {
-        columns.push_back({columnName, columnName.length()});
+const std::shared_ptr<TableStorage> &Database::getStorage() const {
+    return storage;
+}
+
+const std::shared_ptr<TaskScheduler> &Database::getScheduler() const {
+    return scheduler;
+}
+
+ThreadPool &Database::getBlockingPool() {
+    std::lock_guard lock(blockingPoolMutex);
+    if (!blockingPool) {
+        blockingPool = std::make_unique<ThreadPool>(scheduler->size());
     }
+    return *blockingPool;
+}
 
-    // Update widths based on data
-    for (const auto &row: rows) {
-        for (auto &column: columns) {
-            auto it = std::find_if(row.begin(), row.end(), [&](const auto &pair) {
-                return pair.first->getName() == column.name;
-            });
-            if (it != row.end()) {
-                column.width = std::max(column.width, it->second.toString().length());
-            }
-        }
+const std::map<std::string, std::shared_ptr<Table>> &Database::getTables() const {
+    return tables;
+}
+
+void Database::addTable(const std::shared_ptr<Table> &table) {
+    if (tables.contains(table->getName())) {
+        throw std::runtime_error("Table with name " + table->getName() + " already exists");
     }
+    tables[table->getName()] = table;
+}
 
-    // Create a horizontal separator
-    std::string separator;
-    for (const auto &column: columns) {
-        separator += "+" + std::string(column.width + 2, '-');  // +2 for spacing
+void Database::createIndex(const CreateIndexQuery &query, const std::function<void()> &atCommit) {
+    // The shared catalog keeps the table and its columns in place for the whole build
+    std::shared_lock catalogLock(catalogMutex);
+    auto it = tables.find(query.tableName);
+    if (it == tables.end()) {
+        throw std::runtime_error("Table with name " + query.tableName + " not found");
+    }
+    auto table = it->second;
+    auto column = table->getColumn(query.columnName);
+    if (!column.has_value()) {
+        throw std::runtime_error("Column " + query.columnName + " not found in table " + query.tableName);
     }
-    separator += "+\n";
 
-    // Print header
-    fmt::print("{}", separator);
-    for (const auto &column: columns) {
-        fmt::print("| {:^{}} ", column.name, column.width);
+    // Inserts committed from here on are recorded on the side, the copy holds everything before them
+    std::shared_ptr<Table> rows;
+    {
+        std::unique_lock tableLock(table->getMutex());
+        rows = table->startIndexBuild(column.value());
     }
-    fmt::print("|\n{}", separator);
 
-    // Print rows
-    for (const auto &row: rows) {
-        for (const auto &column: columns) {
-            auto it = std::find_if(row.begin(), row.end(), [&](const auto &pair) {
-                return pair.first->getName() == column.name;
-            });
-            fmt::print("| {:^{}} ", it != row.end() ? it->second.toString() : "[Data not found]", column.width);
-        }
-        fmt::print("|\n{}", separator);
+    auto index = std::make_shared<HashIndex>(column.value());
+    try {
+        index->build(*rows, *scheduler);
+    } catch (...) {
+        std::unique_lock tableLock(table->getMutex());
+        table->abortIndexBuild();
+        throw;
     }
-}
 
-std::optional<std::shared_ptr<Table>> Database::getTableDefinition(const std::string &basicString) const {
-    auto it = tables.find(basicString);
-    if (it == tables.end()) {
-        return std::nullopt;
+    // Inserts wait only while the recorded keys are merged and the statement is logged. The index is switched on
+    // only after both, so a duplicate or a failed log leaves the table as it was.
+    std::unique_lock tableLock(table->getMutex());
+    try {
+        table->mergeIndexBuild(index);
+        if (atCommit) {
+            atCommit();
+        }
+    } catch (...) {
+        table->abortIndexBuild();
+        throw;
     }
-    return it->second;
+    table->finishIndexBuild(index);
 }
 
-void Database::alterTable(const AlterTableQuery &query) {
+void Database::alterTable(const AlterTableQuery &query, const std::function<void()> &atCommit) {
     // Find the table
     auto it = tables.find(query.tableName);
     if (it == tables.end()) {
@@ -295,26 +1011,28 @@ void Database::alterTable(const AlterTableQuery &query) {
     // Get the table
     auto table = it->second;
 
-    // Iterate over each operation in the query
+    // Every operation is checked against the columns the table will have by then before anything changes,
+    // so the statement reaches the log only when it applies in full
+    std::map<std::string, const Column *> columns;
+    for (const auto &column: table->getColumns()) {
+        columns[column->getName()] = column.get();
+    }
+    std::set<std::string> foreignKeyColumns;
+    for (const auto &foreignKey: table->getForeignKeys()) {
+        foreignKeyColumns.insert(foreignKey.getKeyColumn()->getName());
+    }
     for (const auto &operation : query.operations) {
         if (std::holds_alternative<AddColumnOperation>(operation)) {
-            // If it's an AddColumnOperation, add the column to the table
             const auto &addColumnOperation = std::get<AddColumnOperation>(operation);
-            if (table->getColumn(addColumnOperation.column.getName()).has_value()) {
+            if (columns.contains(addColumnOperation.column.getName())) {
                 throw std::runtime_error("Column with name " + addColumnOperation.column.getName() + " already exists");
             }
 
-            // if there is primary key
-            bool hasPrimaryKey = false;
             for (const auto &constraint: addColumnOperation.column.getConstraints()) {
                 if (constraint == ColumnConstraint::PRIMARY_KEY) {
-                    hasPrimaryKey = true;
-                    break;
+                    throw std::runtime_error("Cannot add primary key column");
                 }
             }
-            if (hasPrimaryKey) {
-                throw std::runtime_error("Cannot add primary key column");
-            }
 
             for (const auto &constraint: addColumnOperation.column.getConstraints()) {
                 if (constraint == ColumnConstraint::NOT_NULL) {
@@ -322,13 +1040,10 @@ void Database::alterTable(const AlterTableQuery &query) {
                 }
             }
 
-            table->addColumn(std::make_shared<Column>(addColumnOperation.column));
-
-
+            columns[addColumnOperation.column.getName()] = &addColumnOperation.column;
         } else if (std::holds_alternative<DropColumnOperation>(operation)) {
-            // If it's a DropColumnOperation, drop the column from the table
             const auto &dropColumnOperation = std::get<DropColumnOperation>(operation);
-            if (!table->getColumn(dropColumnOperation.columnName).has_value()) {
+            if (!columns.contains(dropColumnOperation.columnName)) {
                 throw std::runtime_error("Column with name " + dropColumnOperation.columnName + " not found");
             }
 
@@ -336,40 +1051,45 @@ void Database::alterTable(const AlterTableQuery &query) {
                 throw std::runtime_error("Cannot drop primary key column");
             }
 
-            table->dropColumn(dropColumnOperation.columnName);
+            // Dropping a column drops its foreign key as well
+            columns.erase(dropColumnOperation.columnName);
+            foreignKeyColumns.erase(dropColumnOperation.columnName);
         } else if (std::holds_alternative<AddForeignKeyOperation>(operation)) {
-            // If it's an AddForeignKeyOperation, add the foreign key to the table
-            const auto &addForeignKeyOperation = std::get<AddForeignKeyOperation>(operation);
-            auto foreignKeyColumn = table->getColumn(addForeignKeyOperation.relation.getForeignKeyColumnName());
-            if (!foreignKeyColumn.has_value()) {
+            const auto &relation = std::get<AddForeignKeyOperation>(operation).relation;
+            if (!columns.contains(relation.getForeignKeyColumnName())) {
                 throw std::runtime_error(
-                        "Foreign key column " + addForeignKeyOperation.relation.getForeignKeyColumnName() +
+                        "Foreign key column " + relation.getForeignKeyColumnName() +
                         " not found in table " +query.tableName);
             }
 
             // Check if the column in the current table is not already a foreign key
-            for (const auto &foreignKey : table->getForeignKeys()) {
-                if (foreignKey.getKeyColumn()->getName() == foreignKeyColumn.value()->getName()) {
-                    throw std::runtime_error(
-                            "Column " + foreignKeyColumn.value()->getName() + " is already a foreign key in table " + query.tableName);
-                }
+            if (!foreignKeyColumns.insert(relation.getForeignKeyColumnName()).second) {
+                throw std::runtime_error(
+                        "Column " + relation.getForeignKeyColumnName() + " is already a foreign key in table " + query.tableName);
             }
 
-            auto referencedTable = tables[addForeignKeyOperation.relation.getReferencedTableName()];
-            if (!referencedTable) {
-                throw std::runtime_error("Referenced table " + addForeignKeyOperation.relation.getReferencedTableName() + " not found");
-
+            // A table referencing itself sees the columns added before in the same statement
+            const Column *referencedColumn = nullptr;
+            if (relation.getReferencedTableName() == query.tableName) {
+                auto referencedIt = columns.find(relation.getReferencedColumnName());
+                referencedColumn = referencedIt == columns.end() ? nullptr : referencedIt->second;
+            } else {
+                auto referenced = tables.find(relation.getReferencedTableName());
+                if (referenced == tables.end()) {
+                    throw std::runtime_error("Referenced table " + relation.getReferencedTableName() + " not found");
+                }
+                auto referencedColumnName = referenced->second->getColumn(relation.getReferencedColumnName());
+                referencedColumn = referencedColumnName.has_value() ? referencedColumnName.value().get() : nullptr;
             }
-            auto referencedColumnName = referencedTable->getColumn(addForeignKeyOperation.relation.getReferencedColumnName());
-            if (!referencedColumnName.has_value()) {
+            if (!referencedColumn) {
                 throw std::runtime_error(
-                        "Referenced column " + addForeignKeyOperation.relation.getReferencedColumnName() +
-                        " not found in table " +addForeignKeyOperation.relation.getReferencedTableName());
+                        "Referenced column " + relation.getReferencedColumnName() +
+                        " not found in table " +relation.getReferencedTableName());
             }
 
             // Check if the column in the referenced table is a primary key or a unique key
             bool isPrimaryKeyOrUnique = false;
-            for (const auto &constraint : referencedColumnName.value()->getConstraints()) {
+            for (const auto &constraint : referencedColumn->getConstraints()) {
                 if (constraint == ColumnConstraint::PRIMARY_KEY || constraint == ColumnConstraint::UNIQUE) {
                     isPrimaryKeyOrUnique = true;
                     break;
@@ -378,23 +1098,44 @@ void Database::alterTable(const AlterTableQuery &query) {
 
             if (!isPrimaryKeyOrUnique) {
                 throw std::runtime_error(
-                        "Referenced column " + referencedColumnName.value()->getName() + " in table " +
-                        addForeignKeyOperation.relation.getReferencedTableName() + " is not a primary key or a unique key");
+                        "Referenced column " + referencedColumn->getName() + " in table " +
+                        relation.getReferencedTableName() + " is not a primary key or a unique key");
             }
+        } else {
+            // If the operation is not supported, throw an exception
+            throw std::runtime_error("Unsupported operation");
+        }
+    }
 
+    // The whole catalog is held, nothing else commits between the log and the change
+    if (atCommit) {
+        atCommit();
+    }
+
+    // Iterate over each operation in the query
+    for (const auto &operation : query.operations) {
+        if (std::holds_alternative<AddColumnOperation>(operation)) {
+            // If it's an AddColumnOperation, add the column to the table
+            table->addColumn(std::make_shared<Column>(std::get<AddColumnOperation>(operation).column));
+        } else if (std::holds_alternative<DropColumnOperation>(operation)) {
+            // If it's a DropColumnOperation, drop the column from the table
+            table->dropColumn(std::get<DropColumnOperation>(operation).columnName);
+        } else {
+            // If it's an AddForeignKeyOperation, add the foreign key to the table
+            const auto &relation = std::get<AddForeignKeyOperation>(operation).relation;
+            auto foreignKeyColumn = table->getColumn(relation.getForeignKeyColumnName());
+            auto referencedTable = tables.at(relation.getReferencedTableName());
+            auto referencedColumnName = referencedTable->getColumn(relation.getReferencedColumnName());
             ForeignKey foreignKey(foreignKeyColumn.value(), std::make_shared<PrimaryKey>(referencedColumnName.value()));
             table->addForeignKey(foreignKey);
             Relation tableRelation(std::make_shared<ForeignKey>(foreignKey), referencedTable);
             table->addRelation(tableRelation);
-        } else {
-            // If the operation is not supported, throw an exception
-            throw std::runtime_error("Unsupported operation");
         }
     }
 }
 
 
-void Database::dropTable(const DropTableQuery &query) {
+void Database::dropTable(const DropTableQuery &query, const std::function<void()> &atCommit) {
     // Find the table
     auto it = tables.find(query.tableName);
     if (it == tables.end()) {
@@ -402,6 +1143,82 @@ void Database::dropTable(const DropTableQuery &query) {
         throw std::runtime_error("Table " + query.tableName + " not found");
     }
 
+    if (atCommit) {
+        atCommit();
+    }
     // Remove the table from the map
     tables.erase(it);
-}
\ No newline at end of file
+}
+Database::Lock Database::lock(const Query &query) const {
+    Lock lock;
+    auto *select = dynamic_cast<const SelectQuery *>(&query);
+    auto *insert = dynamic_cast<const InsertQuery *>(&query);
+    auto *batch = dynamic_cast<const InsertBatchQuery *>(&query);
+    if (dynamic_cast<const CreateIndexQuery *>(&query)) {
+        return lock; // Takes its locks in phases, see createIndex
+    }
+    if (!select && !insert && !batch) {
+        // Schema changes have the whole database to themselves
+        lock.exclusiveCatalog = std::unique_lock(catalogMutex);
+        return lock;
+    }
+
+    lock.sharedCatalog = std::shared_lock(catalogMutex);
+    if (select) {
+        return lock; // Reads a version of the table, see selectFrom
+    }
+
+    std::vector<Table *> targets;
+    auto addTarget = [&](const std::string &tableName) {
+        auto it = tables.find(tableName);
+        if (it != tables.end()) {
+            targets.push_back(it->second.get()); // A missing table makes the query fail on its own
+        }
+    };
+    if (insert) {
+        addTarget(insert->tableName);
+    } else {
+        for (const auto &batchInsert: batch->inserts) {
+            addTarget(batchInsert->tableName);
+        }
+    }
+
+    // Inserts share the tables they write and the ones their foreign keys check, so inserts into one table run
+    // side by side and only a frozen copy, which takes the tables exclusively, waits for them.
+    // Foreign keys cannot change while the catalog is shared, and address order matches the order of freeze.
+    std::vector<Table *> toLock = targets;
+    for (Table *target: targets) {
+        for (const auto &foreignKey: target->getForeignKeys()) {
+            toLock.push_back(foreignKey.getReferencedTable().get());
+        }
+    }
+    std::ranges::sort(toLock);
+    toLock.erase(std::unique(toLock.begin(), toLock.end()), toLock.end());
+    for (Table *table: toLock) {
+        lock.sharedTables.emplace_back(table->getMutex());
+    }
+    return lock;
+}
+
+std::shared_ptr<Database> Database::freeze(const std::function<void()> &atFreeze) const {
+    std::shared_lock catalogLock(catalogMutex);
+    std::vector<Table *> toLock;
+    for (const auto &[name, table]: tables) {
+        toLock.push_back(table.get());
+    }
+    std::ranges::sort(toLock);
+    // Inserts share their tables until they are logged, so the copy matches the log position read by atFreeze
+    std::vector<std::unique_lock<std::shared_mutex>> tableLocks;
+    for (Table *table: toLock) {
+        tableLocks.emplace_back(table->getMutex());
+    }
+
+    auto frozen = std::make_shared<Database>(storage, scheduler);
+    for (const auto &[name, table]: tables) {
+        frozen->tables[name] = table->freeze();
+    }
+    if (atFreeze) {
+        atFreeze();
+    }
+    return frozen;
+}
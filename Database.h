@@ -1,21 +1,150 @@
 #pragma once
 
+#include "HashAggregate.h"
+#include "RowSorter.h"
+#include "RowValidator.h"
 #include "Table.h"
+#include "TableStorage.h"
+#include "TaskScheduler.h"
+#include "ThreadPool.h"
+#include "VersionClock.h"
+#include <array>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include "Query.h"
+#include "QueryResult.h"
 
 
+// Thread-safe when queries run under lock(): createTable, alterTable and dropTable hold the catalog exclusively,
+// selectFrom and insertInto share the catalog and insertInto shares the tables it touches, so many threads may
+// insert into one table at once. Uniqueness holds through the keys every insert claims in the concurrent indexes
+// before it commits. Every insert commits with a version of the clock and selectFrom reads the rows committed
+// before it started, so readers take no table locks and neither block nor wait for writers.
+// The query methods themselves do not lock,
+// QueryExecutor takes the lock for them.
+// getTables, getTableDefinition and addTable are for the owner of a database nobody else uses yet, or for code
+// running under a query lock.
 class Database {
     std::map<std::string, std::shared_ptr<Table>> tables;
+    std::shared_ptr<TableStorage> storage; // Shared by every table, null keeps all rows in memory
+    mutable std::shared_mutex catalogMutex; // Guards tables and every schema
+    VersionClock clock; // Orders inserts for readers
+    std::shared_ptr<TaskScheduler> scheduler; // Runs the parallel parts of queries, loading and recovery
+    std::mutex blockingPoolMutex; // Guards blockingPool
+    std::unique_ptr<ThreadPool> blockingPool; // Started by the first getBlockingPool
+    // Finds the value of a named column in the row being filtered, null when there is no such column
+    using ValueLookup = std::function<const BoxedValue *(const std::string &columnName)>;
+    // A column of a join and the table it comes from, side 0 is the table in FROM
+    struct JoinedColumn {
+        size_t side;
+        std::shared_ptr<Column> column;
+    };
+    // A row of either table of a join, the other side null, or a pair of rows
+    using JoinedRows = std::array<const Row *, 2>;
+    // Checks conditions on joined rows by the columns they were resolved to, without looking up names
+    using JoinFilter = std::function<bool(const JoinedRows &rows)>;
     virtual bool satisfiesCondition(const Row &row, const Condition &condition);
     virtual bool satisfiesConditions(const Row &row, const ConditionGroup &conditionGroup);
-    virtual void columnsToDisplay(const std::vector<Row>& rows, const std::vector<std::string>& columnsToDisplay);
+    virtual bool satisfiesCondition(const BoxedValue *value, const Condition &condition);
+    virtual bool satisfiesConditions(const ValueLookup &lookup, const ConditionGroup &conditionGroup);
+    // Resolves the column of every condition of the group once, resolve throws for an unknown or ambiguous column
+    [[nodiscard]] virtual JoinFilter
+    joinFilter(const ConditionGroup &conditionGroup,
+               const std::function<JoinedColumn(const std::string &columnName)> &resolve);
+    // Conditions of a select from one table with the table.column names of that table unqualified, throws for
+    // a column qualified with another table
+    [[nodiscard]] static ConditionGroup unqualified(const ConditionGroup &conditionGroup, const std::string &tableName);
+    [[nodiscard]] virtual size_t scanLanes() const; // Tasks a parallel scan is split into
+    // selectFrom for a query with a JOIN. Conditions on one table filter its rows before the join, which picks
+    // the cheapest strategy of EquiJoin for the row counts it expects after the filters.
+    [[nodiscard]] virtual QueryResult selectJoin(const SelectQuery &query);
+    // How a select with aggregates or GROUP BY reads its rows and lays out its result
+    struct GroupingPlan {
+        std::vector<std::shared_ptr<Column>> keys; // GROUP BY columns
+        std::vector<Aggregate> aggregates; // In the order of the selected columns
+        std::vector<std::shared_ptr<Column>> inputs; // Column every aggregate reads, null for COUNT(*)
+        // Position in a group row (group values, then aggregate results) of every selected column,
+        // followed by GROUP BY columns that only ORDER BY names
+        std::vector<size_t> outputs;
+        std::vector<RowSorter::Key> order; // ORDER BY, positions in outputs
+        [[nodiscard]] virtual HashAggregate newAggregate() const;
+    };
+    // DISTINCT groups by the selected columns. Throws when a selected column is neither grouped by nor aggregated,
+    // or ORDER BY names neither a selected column nor a GROUP BY column. resolve throws for an unknown column.
+    [[nodiscard]] static GroupingPlan planGrouping(const SelectQuery &query,
+                                                   const std::function<std::shared_ptr<Column>(
+                                                           const std::string &columnName)> &resolve);
+    // selectFrom for a query with aggregates, GROUP BY or DISTINCT. Every scanning task aggregates its segments
+    // into a hash table of its own, the tables are merged at the end.
+    [[nodiscard]] virtual QueryResult selectGroups(const SelectQuery &query, const std::shared_ptr<Table> &table);
+    // Folds a whole segment into a partial aggregate of COUNT(*), MIN, MAX and APPROX_COUNT_DISTINCT without reading
+    // its rows. False when the segment keeps no summary of a column the aggregates read, its rows are read then.
+    [[nodiscard]] static bool addSummary(const GroupingPlan &plan, const HashAggregate &aggregate,
+                                         const TableSegment &segment, HashAggregate::Partial &partial);
+    // Folds rows of typed values into partial aggregates in parallel, a task per run of chunks. A row holds
+    // the values of the GROUP BY columns, then the value of every aggregate but COUNT(*).
+    [[nodiscard]] virtual std::vector<HashAggregate::Partial>
+    aggregateRows(const GroupingPlan &plan, const HashAggregate &aggregate,
+                  std::vector<std::vector<RowSorter::ValueRow>> chunks);
+    // Sorts, pages and renders the groups of an aggregated select
+    [[nodiscard]] virtual std::vector<std::vector<std::string>>
+    finishGroups(const SelectQuery &query, const GroupingPlan &plan, const HashAggregate &aggregate,
+                 std::vector<HashAggregate::Partial> partials);
+    // Rows a select has to produce to fill its LIMIT past its OFFSET, none when there is no LIMIT
+    [[nodiscard]] static std::optional<size_t> wantedRows(const SelectQuery &query);
+    // Final rows of a select from chunks of typed values: ordered by the sorter unless it is null, cut to the
+    // OFFSET and LIMIT and rendered as text up to width. Values past width belong to ORDER BY columns that are
+    // not selected, or to what render needs besides the value of a column.
+    [[nodiscard]] virtual std::vector<std::vector<std::string>>
+    finishRows(std::vector<std::vector<RowSorter::ValueRow>> chunks, const RowSorter *sorter,
+               const SelectQuery &query, size_t width,
+               const std::function<std::string(const RowSorter::ValueRow &row, size_t column)> &render);
+    // Target table and the values of an insert, throws when the table or a column does not exist
+    [[nodiscard]] virtual std::pair<std::shared_ptr<Table>, RowBuilder> prepareInsert(const InsertQuery &query) const;
 public:
-    Database() = default; // Default constructor
-    virtual void createTable(const CreateTableQuery &query);
-    virtual void insertInto(const InsertQuery &query);
-    virtual void selectFrom(const SelectQuery &query);
-    virtual void alterTable(const AlterTableQuery &query);
-    virtual void dropTable(const DropTableQuery &query);
+    // Locks held while one query runs, tables are released before the catalog
+    struct Lock {
+        std::shared_lock<std::shared_mutex> sharedCatalog;
+        std::unique_lock<std::shared_mutex> exclusiveCatalog;
+        std::vector<std::shared_lock<std::shared_mutex>> sharedTables;
+    };
+
+    // Without a scheduler the database starts its own with a worker per core
+    explicit Database(std::shared_ptr<TableStorage> storage = nullptr,
+                      std::shared_ptr<TaskScheduler> scheduler = nullptr);
+    // Takes the locks the query needs. Tables are always locked in the same order, an insert shares the tables
+    // its foreign keys reference as well. A batch shares every table it inserts into.
+    // A select only shares the catalog, createIndex locks on its own.
+    [[nodiscard]] virtual Lock lock(const Query &query) const;
+    // Schema changes check the whole statement first, atCommit runs after that and before anything changes
+    virtual void createTable(const CreateTableQuery &query, const std::function<void()> &atCommit = nullptr);
+    // atCommit runs inside the commit of the rows, so what it logs is in the order of the versions
+    virtual void insertInto(const InsertQuery &query, const std::function<void()> &atCommit = nullptr);
+    // Validates every row first and commits them all with one version, so readers see either all or none of them.
+    // Throws and adds nothing when any row is invalid.
+    virtual void insertBatch(const InsertBatchQuery &query, const std::function<void()> &atCommit = nullptr);
+    // Row an insert would add, validated against the table and the pending rows, whose keys it joins
+    [[nodiscard]] virtual std::pair<std::shared_ptr<Table>, Row> prepareRow(const InsertQuery &query,
+                                                                           PendingKeys &pending) const;
+    [[nodiscard]] virtual QueryResult selectFrom(const SelectQuery &query); // Rows committed before the query began
+    // Builds a unique index on a column of a table that may be written meanwhile and gives the column the UNIQUE
+    // constraint. Takes its own locks: the table is held exclusively only to start recording concurrent inserts
+    // and to merge them in at the end, the rows are indexed in parallel on the scheduler in between.
+    // atCommit runs once the index is switched on, before any insert checks against it.
+    virtual void createIndex(const CreateIndexQuery &query, const std::function<void()> &atCommit = nullptr);
+    virtual void alterTable(const AlterTableQuery &query, const std::function<void()> &atCommit = nullptr);
+    virtual void dropTable(const DropTableQuery &query, const std::function<void()> &atCommit = nullptr);
     [[nodiscard]] virtual std::optional<std::shared_ptr<Table>>  getTableDefinition(const std::string &basicString) const;
+    [[nodiscard]] virtual const std::map<std::string, std::shared_ptr<Table>> &getTables() const;
+    virtual void addTable(const std::shared_ptr<Table> &table); // Registers an already built table, e.g. from a snapshot
+    [[nodiscard]] virtual const std::shared_ptr<TableStorage> &getStorage() const;
+    [[nodiscard]] virtual const std::shared_ptr<TaskScheduler> &getScheduler() const;
+    // Pool for work that may wait on the locks of the database or on the log, e.g. submitted queries, so it holds
+    // no worker of the scheduler. It has as many threads as the scheduler and starts on first use.
+    [[nodiscard]] virtual ThreadPool &getBlockingPool();
+    // Read-only copy of every table as it is now, later changes do not show up in it. It shares the scheduler.
+    // atFreeze runs while every table is locked, e.g. to read the log position matching the copy.
+    [[nodiscard]] virtual std::shared_ptr<Database> freeze(const std::function<void()> &atFreeze = nullptr) const;
 };
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "EquiJoin.h"
+
+#include "BufferPool.h"
+#include "HashJoin.h"
+#include "TableSegment.h"
+#include <algorithm>
+#include <atomic>
+#include <optional>
+
+// Costs relative to reading one row
+static constexpr double HASH_ENTRY_COST = 4; // Copying a row into the hash table
+static constexpr double INDEX_LOOKUP_COST = 3; // Locking a shard of the index and pinning the segment of the row
+
+EquiJoin::EquiJoin(std::array<Side, 2> sides, TaskScheduler &scheduler, size_t lanes)
+        : sides(std::move(sides)), scheduler(scheduler), lanes(std::max<size_t>(lanes, 1)) {}
+
+EquiJoin::Plan EquiJoin::plan() const {
+    std::array<double, 2> rowCounts{static_cast<double>(sides[0].rows->getRowCount()),
+                                    static_cast<double>(sides[1].rows->getRowCount())};
+
+    // A hash join reads both tables and hashes the smaller filtered side
+    size_t probeSide = sides[0].estimatedRows <= sides[1].estimatedRows ? 1 : 0;
+    Plan best{Strategy::HASH, probeSide,
+              rowCounts[0] + rowCounts[1] + HASH_ENTRY_COST * sides[1 - probeSide].estimatedRows};
+
+    // A few outer rows looked up in a large indexed table do not pay for reading all of it
+    for (size_t outerSide = 0; outerSide < sides.size(); ++outerSide) {
+        if (sides[1 - outerSide].index) {
+            double cost = rowCounts[outerSide] + INDEX_LOOKUP_COST * sides[outerSide].estimatedRows;
+            if (cost < best.cost) {
+                best = {Strategy::INDEX_NESTED_LOOP, outerSide, cost};
+            }
+        }
+    }
+
+    // Tables already sorted by their keys are read once each, with nothing to hash or look up
+    if (sides[0].index && sides[1].index && sides[0].index->isAscending() && sides[1].index->isAscending()) {
+        double cost = rowCounts[0] + rowCounts[1];
+        if (cost < best.cost) {
+            best = {Strategy::MERGE, 0, cost};
+        }
+    }
+    return best;
+}
+
+std::vector<EquiJoin::OutputRows> EquiJoin::run(const Plan &plan, const PairVisitor &visit,
+                                                 std::optional<size_t> limit) const {
+    switch (plan.strategy) {
+        case Strategy::INDEX_NESTED_LOOP:
+            return indexNestedLoop(plan.outerSide, visit, limit);
+        case Strategy::MERGE:
+            return merge(visit, limit);
+        default:
+            return hashJoin(plan.outerSide, visit, limit);
+    }
+}
+
+std::vector<EquiJoin::OutputRows> EquiJoin::hashJoin(size_t probeSide, const PairVisitor &visit,
+                                                      std::optional<size_t> limit) const {
+    const auto &build = sides[1 - probeSide];
+    HashJoin hashTable(*build.rows, build.key, build.filter, scheduler, lanes);
+    return scan(probeSide, [&](OutputRows &output, const Row &row) {
+        if (auto matches = hashTable.find(row.data.at(sides[probeSide].key))) {
+            for (const auto &match: *matches) {
+                visitPair(visit, output, probeSide, row, match);
+            }
+        }
+    }, limit);
+}
+
+std::vector<EquiJoin::OutputRows> EquiJoin::indexNestedLoop(size_t outerSide, const PairVisitor &visit,
+                                                             std::optional<size_t> limit) const {
+    const auto &inner = sides[1 - outerSide];
+    return scan(outerSide, [&](OutputRows &output, const Row &row) {
+        auto position = inner.index->find(row.data.at(sides[outerSide].key));
+        if (!position || *position / TableSegment::CAPACITY >= inner.rows->getSegments().size()) {
+            return; // Only a row committed after the copy was taken may be missing from it
+        }
+        auto segment = inner.rows->readSegment(*position / TableSegment::CAPACITY);
+        size_t offset = *position % TableSegment::CAPACITY;
+        if (offset < (*segment).size() && inner.filter((*segment)[offset])) {
+            visitPair(visit, output, outerSide, row, (*segment)[offset]);
+        }
+    }, limit);
+}
+
+// Reads the rows of a frozen table in order with a non-null key, one pinned segment at a time
+class KeyCursor {
+    const Table &table;
+    const std::shared_ptr<Column> &key;
+    ScanRing ring;
+    std::optional<PinnedRows> segment;
+    size_t segmentIndex = 0;
+    size_t offset = 0;
+
+public:
+    KeyCursor(const Table &table, const std::shared_ptr<Column> &key) : table(table), key(key) {
+        skipNulls();
+    }
+
+    [[nodiscard]] const Row *row() const {
+        return segment ? &(**segment)[offset] : nullptr;
+    }
+
+    [[nodiscard]] const BoxedValue &value() const {
+        return row()->data.at(key);
+    }
+
+    void next() {
+        ++offset;
+        skipNulls();
+    }
+
+private:
+    void skipNulls() {
+        while (true) {
+            if (segment && offset >= (**segment).size()) {
+                segment.reset();
+                ++segmentIndex;
+                offset = 0;
+            }
+            if (!segment) {
+                if (segmentIndex >= table.getSegments().size()) {
+                    return;
+                }
+                segment.emplace(table.readSegment(segmentIndex, &ring));
+                continue;
+            }
+            if ((**segment)[offset].data.at(key).has_value()) {
+                return;
+            }
+            ++offset;
+        }
+    }
+};
+
+std::vector<EquiJoin::OutputRows> EquiJoin::merge(const PairVisitor &visit, std::optional<size_t> limit) const {
+    // Both keys are unique and ascending, so every row has at most one partner and the cursors never go back
+    OutputRows output;
+    KeyCursor left(*sides[0].rows, sides[0].key);
+    KeyCursor right(*sides[1].rows, sides[1].key);
+    while (left.row() && right.row() && (!limit || output.size() < *limit)) {
+        if (left.value() < right.value()) {
+            left.next();
+        } else if (right.value() < left.value()) {
+            right.next();
+        } else {
+            if (sides[0].filter(*left.row()) && sides[1].filter(*right.row())) {
+                visit(output, *left.row(), *right.row());
+            }
+            left.next();
+            right.next();
+        }
+    }
+    std::vector<OutputRows> chunks;
+    chunks.push_back(std::move(output));
+    return chunks;
+}
+
+std::vector<EquiJoin::OutputRows>
+EquiJoin::scan(size_t side, const std::function<void(OutputRows &, const Row &)> &body,
+               std::optional<size_t> limit) const {
+    const auto &scanned = sides[side];
+    size_t segmentCount = scanned.rows->getSegments().size();
+    std::vector<OutputRows> segmentRows(segmentCount);
+    std::atomic<size_t> found = 0;
+    auto scanSegments = [&](size_t begin, size_t end) {
+        ScanRing ring;
+        for (size_t s = begin; s < end; ++s) {
+            auto pinned = scanned.rows->readSegment(s, &ring);
+            for (const auto &row: *pinned) {
+                if (limit && segmentRows[s].size() >= *limit) {
+                    break; // The rows of this segment alone fill the limit
+                }
+                if (row.data.at(scanned.key).has_value() && scanned.filter(row)) {
+                    body(segmentRows[s], row);
+                }
+            }
+            found += segmentRows[s].size();
+        }
+    };
+    if (limit) {
+        scheduler.parallelForUntil(0, segmentCount, lanes, scanSegments, [&] { return found >= *limit; });
+    } else {
+        scheduler.parallelFor(0, segmentCount, std::max<size_t>(1, (segmentCount + lanes - 1) / lanes),
+                              scanSegments);
+    }
+    return segmentRows;
+}
+
+void EquiJoin::visitPair(const PairVisitor &visit, OutputRows &output, size_t side, const Row &row,
+                         const Row &other) {
+    if (side == 0) {
+        visit(output, row, other);
+    } else {
+        visit(output, other, row);
+    }
+}
+
+double EquiJoin::estimateSelectivity(const ConditionGroup &conditions,
+                                     const std::function<bool(const std::string &columnName)> &isUnique,
+                                     size_t rowCount) {
+    // AND multiplies the parts as if they were independent, OR adds them up
+    double selectivity = conditions.logicalOperator == TokenType::AND ? 1.0 : 0.0;
+    for (const auto &part: conditions.conditions) {
+        double partSelectivity;
+        if (const auto *condition = std::get_if<Condition>(&part)) {
+            if (condition->op == "=") {
+                partSelectivity = isUnique(condition->column) ? 1.0 / std::max<size_t>(rowCount, 1) : 0.1;
+            } else if (condition->op == "<>" || condition->op == "IS_NOT_NULL") {
+                partSelectivity = 0.9;
+            } else if (condition->op == "IS_NULL") {
+                partSelectivity = 0.1;
+            } else {
+                partSelectivity = 1.0 / 3; // A range
+            }
+        } else {
+            partSelectivity = estimateSelectivity(std::get<ConditionGroup>(part), isUnique, rowCount);
+        }
+        if (conditions.logicalOperator == TokenType::AND) {
+            selectivity *= partSelectivity;
+        } else {
+            selectivity = std::min(1.0, selectivity + partSelectivity);
+        }
+    }
+    return selectivity;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "HashIndex.h"
+#include "Query.h"
+#include "Table.h"
+#include "TaskScheduler.h"
+#include <array>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Equi-join of two frozen tables on one column of each. Every strategy hands the matching pairs of rows to a
+// visitor; rows failing the filter of their own table are dropped before they are paired and NULL keys match nothing.
+class EquiJoin {
+public:
+    enum class Strategy {
+        HASH, // Copies the side with fewer estimated rows into a hash table, the other side probes it in parallel
+        INDEX_NESTED_LOOP, // Scans the outer side in parallel and looks every key up in the index of the inner side
+        MERGE, // Walks both sides side by side, both are sorted by their keys
+    };
+
+    struct Side {
+        std::shared_ptr<Table> rows; // Frozen copy
+        std::shared_ptr<Column> key;
+        std::shared_ptr<HashIndex> index; // Index of the key in the live table, null when there is none
+        std::function<bool(const Row &)> filter; // Conditions on this table alone
+        double estimatedRows = 0; // Rows expected to pass the filter
+    };
+
+    struct Plan {
+        Strategy strategy = Strategy::HASH;
+        size_t outerSide = 0; // Side that is scanned and probes the other one, unused by a merge join
+        double cost = 0; // Roughly in rows read
+    };
+
+    using OutputRows = std::vector<std::vector<BoxedValue>>;
+    // Adds the output of a pair of rows, the row of side 0 first, to the rows of the task that found the pair
+    using PairVisitor = std::function<void(OutputRows &output, const Row &left, const Row &right)>;
+
+    EquiJoin(std::array<Side, 2> sides, TaskScheduler &scheduler, size_t lanes);
+
+    // Cheapest strategy for the estimated row counts. Merge needs both keys indexed and ascending,
+    // an index nested-loop join needs the key of the inner side indexed.
+    [[nodiscard]] virtual Plan plan() const;
+    // Rows come out in chunks in the order of the outer side, one chunk per segment it was scanned by.
+    // A merge join returns a single chunk in the order of the keys. With a limit the join stops once the chunks
+    // hold that many rows in order, the last ones may hold more.
+    [[nodiscard]] virtual std::vector<OutputRows> run(const Plan &plan, const PairVisitor &visit,
+                                                      std::optional<size_t> limit = std::nullopt) const;
+
+    // Fraction of the rows of a table expected to satisfy the conditions, from fixed guesses per operator.
+    // isUnique tells whether a column holds no value twice, so that = matches a single row.
+    static double estimateSelectivity(const ConditionGroup &conditions,
+                                      const std::function<bool(const std::string &columnName)> &isUnique,
+                                      size_t rowCount);
+
+private:
+    std::array<Side, 2> sides;
+    TaskScheduler &scheduler;
+    size_t lanes; // Tasks a parallel scan is split into
+
+    [[nodiscard]] virtual std::vector<OutputRows> hashJoin(size_t probeSide, const PairVisitor &visit,
+                                                           std::optional<size_t> limit) const;
+    [[nodiscard]] virtual std::vector<OutputRows> indexNestedLoop(size_t outerSide, const PairVisitor &visit,
+                                                                  std::optional<size_t> limit) const;
+    [[nodiscard]] virtual std::vector<OutputRows> merge(const PairVisitor &visit, std::optional<size_t> limit) const;
+    // Calls body for every row of the side with a key that passes the filter, segments in parallel,
+    // and returns the output of every segment. With a limit segments are read in waves until they output that many.
+    [[nodiscard]] virtual std::vector<OutputRows>
+    scan(size_t side, const std::function<void(OutputRows &, const Row &)> &body, std::optional<size_t> limit) const;
+    // Hands a pair over to the visitor with the row of side 0 first
+    static void visitPair(const PairVisitor &visit, OutputRows &output, size_t side, const Row &row,
+                          const Row &other);
+};
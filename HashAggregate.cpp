@@ -0,0 +1,268 @@
+#include "HashAggregate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+static constexpr size_t PARTITIONS = 64; // Hash partitions of every partial, merged in parallel
+
+// Digits of the sum of an INTEGER column, NULL when no value was added
+static BoxedValue exactText(const HashAggregate::Accumulator &accumulator) {
+    if (accumulator.count == 0) {
+        return {DataType::TEXT, std::nullopt};
+    }
+    return {DataType::TEXT, std::to_string(accumulator.integerSum)};
+}
+
+static size_t combineHashes(size_t seed, size_t hash) {
+    return seed ^ (hash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+size_t HashAggregate::GroupHash::operator()(const GroupKey &key) const {
+    return key.hash;
+}
+
+size_t HashAggregate::GroupHash::operator()(const GroupProbe &probe) const {
+    return probe.hash;
+}
+
+bool HashAggregate::GroupEqual::operator()(const GroupKey &first, const GroupKey &second) const {
+    return first.hash == second.hash && first.values == second.values;
+}
+
+bool HashAggregate::GroupEqual::operator()(const GroupProbe &first, const GroupKey &second) const {
+    return first.hash == second.hash
+           && std::ranges::equal(first.values, second.values, [](const BoxedValue *value, const BoxedValue &other) {
+               return *value == other;
+           });
+}
+
+bool HashAggregate::GroupEqual::operator()(const GroupKey &first, const GroupProbe &second) const {
+    return (*this)(second, first);
+}
+
+HashAggregate::HashAggregate(std::vector<Aggregate> aggregatesArg, std::vector<DataType> inputTypesArg)
+        : aggregates(std::move(aggregatesArg)), inputTypes(std::move(inputTypesArg)) {
+    for (size_t i = 0; i < aggregates.size(); ++i) {
+        bool numeric = inputTypes[i] == DataType::INTEGER || inputTypes[i] == DataType::FLOAT
+                       || inputTypes[i] == DataType::DOUBLE;
+        auto function = aggregates[i].function;
+        if ((function == Aggregate::Function::SUM || function == Aggregate::Function::AVG) && !numeric) {
+            throw std::runtime_error(aggregates[i].toString() + " needs a column of numbers");
+        }
+    }
+    size_t exact = 0;
+    exactSums.resize(aggregates.size());
+    for (size_t i = 0; i < aggregates.size(); ++i) {
+        if (aggregates[i].function == Aggregate::Function::SUM && inputTypes[i] == DataType::INTEGER) {
+            exactSums[i] = exact++;
+        }
+    }
+}
+
+void HashAggregate::add(Partial &partial, const ValueRefs &keys, const ValueRefs &inputs) const {
+    auto &accumulators = findGroup(partial, keys);
+    for (size_t i = 0; i < aggregates.size(); ++i) {
+        auto &accumulator = accumulators[i];
+        if (aggregates[i].countsRows()) {
+            ++accumulator.count;
+            continue;
+        }
+        const BoxedValue *value = inputs[i];
+        if (!value->has_value()) {
+            continue;
+        }
+        ++accumulator.count;
+        switch (aggregates[i].function) {
+            case Aggregate::Function::SUM:
+            case Aggregate::Function::AVG:
+                if (value->type == DataType::INTEGER) {
+                    addInteger(i, accumulator, std::get<int>(*value->data));
+                } else if (value->type == DataType::FLOAT) {
+                    accumulator.sum += std::get<float>(*value->data);
+                } else {
+                    accumulator.sum += std::get<double>(*value->data);
+                }
+                break;
+            case Aggregate::Function::MIN:
+                if (!accumulator.extreme.has_value() || *value < accumulator.extreme) {
+                    accumulator.extreme = *value;
+                }
+                break;
+            case Aggregate::Function::MAX:
+                if (!accumulator.extreme.has_value() || accumulator.extreme < *value) {
+                    accumulator.extreme = *value;
+                }
+                break;
+            case Aggregate::Function::APPROX_COUNT_DISTINCT:
+                accumulator.distinct.add(*value);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void HashAggregate::addSummary(Partial &partial, const std::vector<const TableSegment::ColumnSummary *> &summaries,
+                               uint64_t rows) const {
+    std::vector<Accumulator> segment(aggregates.size());
+    for (size_t i = 0; i < aggregates.size(); ++i) {
+        if (aggregates[i].countsRows()) {
+            segment[i].count = rows;
+        } else if (aggregates[i].function == Aggregate::Function::APPROX_COUNT_DISTINCT) {
+            segment[i].distinct = summaries[i]->distinct;
+        } else {
+            segment[i].extreme = aggregates[i].function == Aggregate::Function::MIN ? summaries[i]->min
+                                                                                     : summaries[i]->max;
+        }
+    }
+    combine(findGroup(partial, {}), segment);
+}
+
+std::vector<HashAggregate::Accumulator> &HashAggregate::findGroup(Partial &partial, const ValueRefs &keys) const {
+    if (partial.partitions.empty()) {
+        partial.partitions.resize(PARTITIONS);
+    }
+    size_t hash = 0;
+    for (const auto *key: keys) {
+        hash = combineHashes(hash, BoxedValueHash{}(*key));
+    }
+    auto &groups = partial.partitions[hash % PARTITIONS];
+    auto group = groups.find(GroupProbe{hash, keys});
+    if (group == groups.end()) {
+        GroupKey key{hash, {}};
+        key.values.reserve(keys.size());
+        for (const auto *value: keys) {
+            key.values.push_back(*value);
+        }
+        group = groups.emplace(std::move(key), std::vector<Accumulator>(aggregates.size())).first;
+    }
+    return group->second;
+}
+
+std::vector<HashAggregate::ValueRow> HashAggregate::merge(std::vector<Partial> partials, bool grouped,
+                                                         TaskScheduler &scheduler) const {
+    // A group hashes to the same partition in every partial, so partitions merge independently
+    std::vector<std::vector<ValueRow>> partitionRows(PARTITIONS);
+    scheduler.parallelFor(0, PARTITIONS, 1, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+            Groups merged;
+            for (auto &partial: partials) {
+                if (partial.partitions.empty()) {
+                    continue;
+                }
+                auto &groups = partial.partitions[p];
+                if (groups.size() > merged.size()) {
+                    std::swap(groups, merged); // The larger table takes in the smaller one
+                }
+                merged.merge(groups); // Moves over the groups merged does not have yet, the others stay
+                for (const auto &[key, accumulators]: groups) {
+                    combine(merged.find(key)->second, accumulators);
+                }
+            }
+
+            auto &rows = partitionRows[p];
+            rows.reserve(merged.size());
+            while (!merged.empty()) {
+                auto group = merged.extract(merged.begin());
+                auto &row = rows.emplace_back(std::move(group.key().values));
+                for (size_t i = 0; i < aggregates.size(); ++i) {
+                    row.push_back(result(i, group.mapped()[i]));
+                }
+                for (size_t i = 0; i < aggregates.size(); ++i) {
+                    if (exactSums[i]) {
+                        row.push_back(exactText(group.mapped()[i]));
+                    }
+                }
+            }
+        }
+    });
+
+    std::vector<ValueRow> rows;
+    for (auto &partition: partitionRows) {
+        std::ranges::move(partition, std::back_inserter(rows));
+    }
+    if (!grouped && rows.empty()) {
+        // Nothing matched, the aggregates of no rows
+        auto &row = rows.emplace_back();
+        for (size_t i = 0; i < aggregates.size(); ++i) {
+            row.push_back(result(i, Accumulator()));
+        }
+        for (size_t i = 0; i < aggregates.size(); ++i) {
+            if (exactSums[i]) {
+                row.push_back(exactText(Accumulator()));
+            }
+        }
+    }
+    return rows;
+}
+
+DataType HashAggregate::resultType(size_t aggregate) const {
+    auto function = aggregates[aggregate].function;
+    if (function == Aggregate::Function::MIN || function == Aggregate::Function::MAX) {
+        return inputTypes[aggregate];
+    }
+    return DataType::DOUBLE;
+}
+
+std::optional<size_t> HashAggregate::exactSum(size_t aggregate) const {
+    return exactSums[aggregate];
+}
+
+std::string HashAggregate::toString(size_t aggregate, const BoxedValue &result) const {
+    auto function = aggregates[aggregate].function;
+    bool whole = function == Aggregate::Function::COUNT || function == Aggregate::Function::APPROX_COUNT_DISTINCT;
+    if (whole && result.has_value()) {
+        return std::to_string(std::llround(std::get<double>(*result.data)));
+    }
+    return result.toString();
+}
+
+void HashAggregate::combine(std::vector<Accumulator> &into, const std::vector<Accumulator> &from) const {
+    for (size_t i = 0; i < aggregates.size(); ++i) {
+        into[i].count += from[i].count;
+        addInteger(i, into[i], from[i].integerSum);
+        into[i].sum += from[i].sum;
+        if (aggregates[i].function == Aggregate::Function::APPROX_COUNT_DISTINCT) {
+            into[i].distinct.merge(from[i].distinct);
+        }
+        const auto &extreme = from[i].extreme;
+        if (!extreme.has_value()) {
+            continue;
+        }
+        if (!into[i].extreme.has_value()
+            || (aggregates[i].function == Aggregate::Function::MIN ? extreme < into[i].extreme
+                                                                   : into[i].extreme < extreme)) {
+            into[i].extreme = extreme;
+        }
+    }
+}
+
+void HashAggregate::addInteger(size_t aggregate, Accumulator &accumulator, int64_t value) const {
+    if (__builtin_add_overflow(accumulator.integerSum, value, &accumulator.integerSum)) {
+        throw std::runtime_error(aggregates[aggregate].toString() + " is out of the range of a 64-bit integer");
+    }
+}
+
+BoxedValue HashAggregate::result(size_t aggregate, const Accumulator &accumulator) const {
+    const auto &function = aggregates[aggregate].function;
+    if (function == Aggregate::Function::COUNT) {
+        return {DataType::DOUBLE, static_cast<double>(accumulator.count)};
+    }
+    if (function == Aggregate::Function::APPROX_COUNT_DISTINCT) {
+        return {DataType::DOUBLE, std::round(accumulator.distinct.estimate())};
+    }
+    if (function == Aggregate::Function::MIN || function == Aggregate::Function::MAX) {
+        return accumulator.extreme.has_value() ? accumulator.extreme : BoxedValue(inputTypes[aggregate], std::nullopt);
+    }
+    if (accumulator.count == 0) {
+        return {DataType::DOUBLE, std::nullopt};
+    }
+    double sum = inputTypes[aggregate] == DataType::INTEGER ? static_cast<double>(accumulator.integerSum)
+                                                            : accumulator.sum;
+    return {DataType::DOUBLE, function == Aggregate::Function::AVG ? sum / static_cast<double>(accumulator.count)
+                                                                   : sum};
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "HyperLogLog.h"
+#include "Query.h"
+#include "Table.h"
+#include "TableSegment.h"
+#include "TaskScheduler.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// GROUP BY with aggregates. Every scanning task folds its rows into a Partial of its own, a hash table from the
+// values of the group columns to the running aggregates of the group, so the tasks share nothing until merge()
+// combines their partials, one hash partition per task. Groups are hashed and compared by their typed values,
+// rows are never rendered as text.
+class HashAggregate {
+public:
+    using ValueRow = std::vector<BoxedValue>;
+    using ValueRefs = std::vector<const BoxedValue *>; // Values of the row being added, copied only for a new group
+
+    // Running state of one aggregate of one group
+    struct Accumulator {
+        uint64_t count = 0; // Values seen, or rows for COUNT(*)
+        int64_t integerSum = 0; // SUM and AVG of INTEGER, exact, adding past its range throws
+        double sum = 0; // SUM and AVG of FLOAT and DOUBLE
+        BoxedValue extreme; // MIN or MAX so far, empty until a value is seen
+        HyperLogLog distinct; // APPROX_COUNT_DISTINCT
+    };
+
+    // Values of the group columns with their hash, computed once when the group is first seen, so merging and
+    // rehashing never hash the values again
+    struct GroupKey {
+        size_t hash;
+        ValueRow values;
+    };
+    // Group of a row being added, looked up without copying its values
+    struct GroupProbe {
+        size_t hash;
+        const ValueRefs &values;
+    };
+    struct GroupHash {
+        using is_transparent = void;
+        size_t operator()(const GroupKey &key) const;
+        size_t operator()(const GroupProbe &probe) const;
+    };
+    struct GroupEqual {
+        using is_transparent = void;
+        bool operator()(const GroupKey &first, const GroupKey &second) const;
+        bool operator()(const GroupProbe &first, const GroupKey &second) const;
+        bool operator()(const GroupKey &first, const GroupProbe &second) const;
+    };
+    using Groups = std::unordered_map<GroupKey, std::vector<Accumulator>, GroupHash, GroupEqual>;
+    // Groups of one task, split into partitions by hash, so that merging runs a partition per task
+    struct Partial {
+        std::vector<Groups> partitions; // Created by the first add
+    };
+
+    // inputTypes holds the type of the column every aggregate reads, anything for COUNT(*).
+    // Throws when SUM or AVG reads a column that holds no numbers.
+    HashAggregate(std::vector<Aggregate> aggregates, std::vector<DataType> inputTypes);
+
+    // Folds a row into its group. keys are the values of the group columns, inputs the value every aggregate
+    // reads, null for COUNT(*). NULL inputs are skipped, NULL keys form a group of their own.
+    virtual void add(Partial &partial, const ValueRefs &keys, const ValueRefs &inputs) const;
+    // Folds a segment from its summary instead of its rows, only without group columns and when every aggregate
+    // is COUNT(*), MIN, MAX or APPROX_COUNT_DISTINCT. summaries holds the summary of the column every aggregate
+    // reads, null for COUNT(*).
+    virtual void addSummary(Partial &partial, const std::vector<const TableSegment::ColumnSummary *> &summaries,
+                            uint64_t rows) const;
+    // A row per group: the values of the group columns, the result of every aggregate, then the exact sum of every
+    // SUM of INTEGER as TEXT. Without group columns there is one row even when nothing was added, COUNT gives 0 there
+    // and the others NULL.
+    [[nodiscard]] virtual std::vector<ValueRow> merge(std::vector<Partial> partials, bool grouped,
+                                                      TaskScheduler &scheduler) const;
+    // COUNT, SUM, AVG and APPROX_COUNT_DISTINCT give a DOUBLE, MIN and MAX the type of their column. The DOUBLE of
+    // a SUM of INTEGER only orders rows, past 2^53 it is not exact.
+    [[nodiscard]] virtual DataType resultType(size_t aggregate) const;
+    // Position of the exact sum of a SUM of INTEGER among the exact sums that merge() appends to a row
+    [[nodiscard]] virtual std::optional<size_t> exactSum(size_t aggregate) const;
+    // Text of a result, COUNT and APPROX_COUNT_DISTINCT are whole numbers
+    [[nodiscard]] virtual std::string toString(size_t aggregate, const BoxedValue &result) const;
+
+private:
+    std::vector<Aggregate> aggregates;
+    std::vector<DataType> inputTypes;
+    std::vector<std::optional<size_t>> exactSums; // For every SUM of INTEGER
+
+    // Accumulators of the group, created empty for a new group
+    [[nodiscard]] virtual std::vector<Accumulator> &findGroup(Partial &partial, const ValueRefs &keys) const;
+
+    virtual void combine(std::vector<Accumulator> &into, const std::vector<Accumulator> &from) const;
+    // Adds to the exact sum of an INTEGER column, throws when it leaves the range of int64_t
+    virtual void addInteger(size_t aggregate, Accumulator &accumulator, int64_t value) const;
+    [[nodiscard]] virtual BoxedValue result(size_t aggregate, const Accumulator &accumulator) const;
+};
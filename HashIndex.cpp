@@ -0,0 +1,153 @@
+#include "HashIndex.h"
+
+#include "BufferPool.h"
+#include "TableSegment.h"
+#include <mutex>
+#include <stdexcept>
+
+HashIndex::HashIndex(std::shared_ptr<Column> column) : column(std::move(column)) {}
+
+static size_t shardIndex(const BoxedValue &value, size_t shardCount) {
+    // Integers hash to themselves, multiplying spreads consecutive keys over the shards
+    return (BoxedValueHash{}(value) * 0x9e3779b97f4a7c15ULL >> 32) % shardCount;
+}
+
+HashIndex::Shard &HashIndex::shardOf(const BoxedValue &value) {
+    return shards[shardIndex(value, SHARD_COUNT)];
+}
+
+const HashIndex::Shard &HashIndex::shardOf(const BoxedValue &value) const {
+    return shards[shardIndex(value, SHARD_COUNT)];
+}
+
+void HashIndex::insert(const BoxedValue &value, size_t position) {
+    if (value.has_value()) {
+        {
+            auto &shard = shardOf(value);
+            std::lock_guard lock(shard.mutex);
+            shard.positions.insert_or_assign(value, position);
+        }
+        extendOrder(value);
+    }
+}
+
+void HashIndex::extendOrder(const BoxedValue &value) {
+    std::lock_guard lock(orderMutex);
+    if (lastValue && !(*lastValue < value)) {
+        ascending = false;
+    }
+    lastValue = value;
+}
+
+bool HashIndex::claim(const BoxedValue &value) {
+    if (!value.has_value()) {
+        return true;
+    }
+    auto &shard = shardOf(value);
+    std::lock_guard lock(shard.mutex);
+    return shard.positions.try_emplace(value, CLAIMED).second;
+}
+
+void HashIndex::release(const BoxedValue &value) {
+    if (!value.has_value()) {
+        return;
+    }
+    auto &shard = shardOf(value);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.positions.find(value);
+    if (it != shard.positions.end() && it->second == CLAIMED) {
+        shard.positions.erase(it);
+    }
+}
+
+void HashIndex::rebuild(const Table &table) {
+    for (auto &shard: shards) {
+        shard.positions.clear();
+        shard.positions.reserve(table.getRowCount() / SHARD_COUNT);
+    }
+    lastValue.reset();
+    ascending = true;
+    size_t position = 0;
+    table.scanRows([&](const Row &row) {
+        insert(row.data.at(column), position++);
+        return true;
+    });
+}
+
+bool HashIndex::add(const BoxedValue &value, size_t position) {
+    if (!value.has_value()) {
+        return true;
+    }
+    auto &shard = shardOf(value);
+    std::lock_guard lock(shard.mutex);
+    return shard.positions.try_emplace(value, position).second;
+}
+
+void HashIndex::build(const Table &table, TaskScheduler &scheduler) {
+    for (auto &shard: shards) {
+        shard.positions.reserve(table.getRowCount() / SHARD_COUNT);
+    }
+    // First and last value of every segment and whether the values within it ascend
+    struct SegmentOrder {
+        std::optional<BoxedValue> first;
+        std::optional<BoxedValue> last;
+        bool ascending = true;
+    };
+    std::vector<SegmentOrder> orders(table.getSegments().size());
+
+    // Tasks fill the shards directly, with 64 of them two tasks rarely wait for the same lock
+    scheduler.parallelFor(0, table.getSegments().size(), 1, [&](size_t begin, size_t end) {
+        ScanRing ring;
+        for (size_t s = begin; s < end; ++s) {
+            auto rows = table.readSegment(s, &ring);
+            size_t position = s * TableSegment::CAPACITY;
+            for (const auto &row: *rows) {
+                const auto &value = row.data.at(column);
+                if (!add(value, position++)) {
+                    throw std::runtime_error("Value " + value.toString() + " already exists for column "
+                                             + column->getName());
+                }
+                if (value.has_value()) {
+                    auto &order = orders[s];
+                    order.ascending = order.ascending && (!order.last || *order.last < value);
+                    order.last = value;
+                    if (!order.first) {
+                        order.first = value;
+                    }
+                }
+            }
+        }
+    });
+
+    for (const auto &order: orders) {
+        if (order.first) {
+            ascending = ascending && order.ascending && (!lastValue || *lastValue < *order.first);
+            lastValue = order.last;
+        }
+    }
+}
+
+std::optional<size_t> HashIndex::find(const BoxedValue &value) const {
+    const auto &shard = shardOf(value);
+    std::shared_lock lock(shard.mutex);
+    auto it = shard.positions.find(value);
+    if (it == shard.positions.end() || it->second == CLAIMED) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+bool HashIndex::contains(const BoxedValue &value) const {
+    const auto &shard = shardOf(value);
+    std::shared_lock lock(shard.mutex);
+    return shard.positions.contains(value);
+}
+
+bool HashIndex::isAscending() const {
+    std::lock_guard lock(orderMutex);
+    return ascending;
+}
+
+const std::shared_ptr<Column> &HashIndex::getColumn() const {
+    return column;
+}
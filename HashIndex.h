@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Table.h"
+#include "TaskScheduler.h"
+#include <array>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+// Hash index over a PRIMARY_KEY or UNIQUE column, maps every non-null value to the position of its row.
+// Safe for concurrent inserts: values are spread over shards, each with a lock of its own. An insert claims
+// its values before it commits, so of two inserts racing for one value only the first claim succeeds.
+// Committed rows are inserted in the order of their positions, which tells whether the table is sorted by the column.
+class HashIndex {
+    static constexpr size_t SHARD_COUNT = 64;
+    static constexpr size_t CLAIMED = SIZE_MAX; // Position of a value whose row is not committed yet
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<BoxedValue, size_t, BoxedValueHash> positions;
+    };
+
+    std::shared_ptr<Column> column; // Indexed column
+    std::array<Shard, SHARD_COUNT> shards;
+    mutable std::mutex orderMutex; // Guards lastValue and ascending
+    std::optional<BoxedValue> lastValue; // Value of the row with the highest position so far
+    bool ascending = true; // Every value is larger than the values of the rows before it
+
+    [[nodiscard]] virtual Shard &shardOf(const BoxedValue &value);
+    [[nodiscard]] virtual const Shard &shardOf(const BoxedValue &value) const;
+    virtual void extendOrder(const BoxedValue &value); // Takes the values of committed rows in position order
+public:
+    explicit HashIndex(std::shared_ptr<Column> column);
+
+    virtual void insert(const BoxedValue &value, size_t position); // NULLs are not indexed, settles a claim
+    virtual bool claim(const BoxedValue &value); // Reserves the value for a row about to commit, false if taken
+    virtual void release(const BoxedValue &value); // Drops a claim of a row that did not commit
+    virtual void rebuild(const Table &table); // Indexes every row of the table from scratch, nothing else may run
+    virtual bool add(const BoxedValue &value, size_t position); // Indexes a committed row, false if the value is taken
+    // Indexes the rows of a frozen table on the scheduler, a segment per task. Throws on the first duplicate.
+    virtual void build(const Table &table, TaskScheduler &scheduler);
+
+    [[nodiscard]] virtual std::optional<size_t> find(const BoxedValue &value) const; // Position of a committed row
+    [[nodiscard]] virtual bool contains(const BoxedValue &value) const; // Claimed values count too
+    // Rows were added in ascending order of the values, e.g. ids counting up, so the table is sorted by the column
+    [[nodiscard]] virtual bool isAscending() const;
+    [[nodiscard]] virtual const std::shared_ptr<Column> &getColumn() const;
+};
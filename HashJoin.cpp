@@ -0,0 +1,37 @@
+#include "HashJoin.h"
+
+#include "BufferPool.h"
+#include "TableSegment.h"
+#include <algorithm>
+
+HashJoin::HashJoin(const Table &table, std::shared_ptr<Column> keyColumnArg,
+                   const std::function<bool(const Row &)> &filter, TaskScheduler &scheduler, size_t lanes)
+        : keyColumn(std::move(keyColumnArg)) {
+    // Segments are copied in parallel, each into its own slot, and bucketed in segment order
+    std::vector<std::vector<Row>> segmentRows(table.getSegments().size());
+    size_t grainSize = std::max<size_t>(1, (segmentRows.size() + lanes - 1) / std::max<size_t>(lanes, 1));
+    scheduler.parallelFor(0, segmentRows.size(), grainSize, [&](size_t begin, size_t end) {
+        ScanRing ring;
+        for (size_t s = begin; s < end; ++s) {
+            auto rows = table.readSegment(s, &ring);
+            for (const auto &row: *rows) {
+                if (row.data.at(keyColumn).has_value() && filter(row)) {
+                    segmentRows[s].push_back(row);
+                }
+            }
+        }
+    });
+
+    buckets.reserve(table.getRowCount());
+    for (auto &rows: segmentRows) {
+        for (auto &row: rows) {
+            auto key = row.data.at(keyColumn);
+            buckets[key].push_back(std::move(row));
+        }
+    }
+}
+
+const std::vector<Row> *HashJoin::find(const BoxedValue &key) const {
+    auto it = buckets.find(key);
+    return it == buckets.end() ? nullptr : &it->second;
+}
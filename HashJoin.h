@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Table.h"
+#include "TaskScheduler.h"
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Hash table over the rows of the build side of an equi-join, keyed by the join column.
+// The other side probes it row by row. NULL keys never match, so their rows are left out.
+class HashJoin {
+    std::shared_ptr<Column> keyColumn;
+    std::unordered_map<BoxedValue, std::vector<Row>, BoxedValueHash> buckets;
+public:
+    // Copies the rows of a frozen table that pass the filter, its segments are read by up to lanes parallel tasks
+    HashJoin(const Table &table, std::shared_ptr<Column> keyColumn, const std::function<bool(const Row &)> &filter,
+             TaskScheduler &scheduler, size_t lanes);
+
+    [[nodiscard]] virtual const std::vector<Row> *find(const BoxedValue &key) const; // Null when no row matches
+};
@@ -0,0 +1,100 @@
+#include "HyperLogLog.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+static constexpr size_t SPARSE_LIMIT = HyperLogLog::REGISTERS / 16; // 1 KiB of entries against 4 KiB of registers
+
+// BoxedValueHash leaves integers as they are, the registers need every bit mixed
+static uint64_t mix(uint64_t hash) {
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+void HyperLogLog::add(const BoxedValue &value) {
+    if (!value.has_value()) {
+        return;
+    }
+    uint64_t hash = mix(BoxedValueHash{}(value));
+    auto index = static_cast<size_t>(hash >> (64 - PRECISION));
+    uint64_t rest = hash << PRECISION;
+    // Zeros before the first one in the bits left, counting a one past them when they are all zero
+    auto rank = static_cast<uint8_t>(std::min(std::countl_zero(rest), static_cast<int>(64 - PRECISION)) + 1);
+    set(index, rank);
+}
+
+void HyperLogLog::merge(const HyperLogLog &other) {
+    if (!other.dense.empty()) {
+        densify();
+        for (size_t i = 0; i < REGISTERS; ++i) {
+            dense[i] = std::max(dense[i], other.dense[i]);
+        }
+        return;
+    }
+    for (auto entry: other.sparse) {
+        set(entry >> 8, static_cast<uint8_t>(entry & 0xff));
+    }
+}
+
+double HyperLogLog::estimate() const {
+    // Registers still zero each add 2^0 to the harmonic sum
+    double sum = 0;
+    size_t zeros = 0;
+    if (dense.empty()) {
+        zeros = REGISTERS - sparse.size();
+        sum = static_cast<double>(zeros);
+        for (auto entry: sparse) {
+            sum += std::ldexp(1.0, -static_cast<int>(entry & 0xff));
+        }
+    } else {
+        for (auto rank: dense) {
+            zeros += rank == 0;
+            sum += std::ldexp(1.0, -static_cast<int>(rank));
+        }
+    }
+
+    auto registers = static_cast<double>(REGISTERS);
+    double alpha = 0.7213 / (1 + 1.079 / registers);
+    double estimate = alpha * registers * registers / sum;
+    if (estimate <= 2.5 * registers && zeros != 0) {
+        // Few values leave many registers empty, counting those is more accurate there
+        estimate = registers * std::log(registers / static_cast<double>(zeros));
+    }
+    return estimate;
+}
+
+void HyperLogLog::set(size_t index, uint8_t rank) {
+    if (!dense.empty()) {
+        dense[index] = std::max(dense[index], rank);
+        return;
+    }
+    auto found = std::ranges::find_if(sparse, [&](uint32_t entry) {
+        return entry >> 8 == index;
+    });
+    if (found != sparse.end()) {
+        if ((*found & 0xff) < rank) {
+            *found = static_cast<uint32_t>(index << 8 | rank);
+        }
+        return;
+    }
+    sparse.push_back(static_cast<uint32_t>(index << 8 | rank));
+    if (sparse.size() > SPARSE_LIMIT) {
+        densify();
+    }
+}
+
+void HyperLogLog::densify() {
+    if (!dense.empty()) {
+        return;
+    }
+    dense.resize(REGISTERS);
+    for (auto entry: sparse) {
+        dense[entry >> 8] = static_cast<uint8_t>(entry & 0xff);
+    }
+    sparse.clear();
+    sparse.shrink_to_fit();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Table.h"
+#include <cstdint>
+#include <vector>
+
+// Sketch that estimates how many distinct values it was given, within about 1.6%, in at most 4 KiB.
+// Values are hashed, the leading bits of a hash pick one of the registers, which keeps the longest run of zeros
+// seen in the remaining bits. Sketches of different rows merge by taking the larger register, so sketches of
+// segments or of scanning tasks combine into the sketch of all their rows.
+// A sketch of few values keeps only the registers that are set and switches to the full array as it grows.
+class HyperLogLog {
+public:
+    static constexpr unsigned PRECISION = 12; // Bits of the hash that pick a register
+    static constexpr size_t REGISTERS = size_t{1} << PRECISION;
+
+    virtual void add(const BoxedValue &value); // NULL is skipped
+    virtual void merge(const HyperLogLog &other);
+    [[nodiscard]] virtual double estimate() const;
+
+private:
+    std::vector<uint32_t> sparse; // Register, then its value in the low 8 bits, while dense is empty
+    std::vector<uint8_t> dense; // Every register, once the entries of sparse would take a quarter of its size
+
+    virtual void set(size_t index, uint8_t rank); // Raises a register to rank
+    virtual void densify();
+};
@@ -1,5 +1,6 @@
 #include "Lexer.h"
 
+#include <algorithm>
 #include <cctype>
 #include <utility>
 #include <stdexcept>
@@ -9,7 +10,7 @@ void Lexer::reportError(const std::string& message) const {
     throw std::runtime_error("Lexer Error at position " + std::to_string(position) + ": " + message);
 }
 
-Lexer::Lexer(std::string input) : input(std::move(input)), position(0) {}
+Lexer::Lexer(std::string_view input) : input(input), position(0) {}
 
 Token Lexer::nextToken() {
     skipWhitespace();
@@ -48,11 +49,29 @@ bool Lexer::isFileEnd() const {
 }
 
 bool Lexer::isQueryEnd() const {
-    return input[position] == ';';
+    return openQuote == 0 && input[position] == ';';
+}
+
+size_t Lexer::findQueryEnd() const {
+    // Scanned from the start of the query, the current position may be anywhere after a failed token
+    char quote = 0;
+    size_t end = queryStart;
+    for (; end < input.size() && input[end] != '\0'; ++end) {
+        char c = input[end];
+        if (quote != 0) {
+            quote = c == quote ? 0 : quote;
+        } else if (c == '\'' || c == '\"') {
+            quote = c;
+        } else if (c == ';') {
+            break;
+        }
+    }
+    return std::max(end, position);
 }
 
 char Lexer::get() {
     if (isEnd()) return '\0';
+    if (input[position] == '\n') ++line;
     return input[position++];
 }
 
@@ -61,6 +80,34 @@ char Lexer::peek() const {
     return input[position];
 }
 
+void Lexer::skipToNextQuery() {
+    size_t end = findQueryEnd();
+    openQuote = 0;
+    while (position < end) {
+        if (input[position] == '\n') ++line;
+        ++position;
+    }
+    if (!isFileEnd()) ++position; // Consume ;
+}
+
+bool Lexer::hasMoreQueries() {
+    while (!isFileEnd() && (isQueryEnd() || std::isspace(static_cast<unsigned char>(input[position])))) {
+        if (input[position] == '\n') ++line;
+        ++position;
+    }
+    queryStart = position;
+    return !isFileEnd();
+}
+
+size_t Lexer::getLine() const {
+    return line;
+}
+
+std::string_view Lexer::getQueryText() const {
+    size_t end = std::min(findQueryEnd() + 1, input.size());
+    return input.substr(queryStart, end - queryStart);
+}
+
 void Lexer::skipWhitespace() {
     while (!isEnd() && std::isspace(peek())) {
         get(); // Consume the character
@@ -77,10 +124,12 @@ Token Lexer::singleCharToken(char c) {
 
 Token Lexer::stringLiteral() {
     char endChar = get(); // should be '\'' or '\"'
+    openQuote = endChar;
     std::string value;
     while (!isEnd() && peek() != endChar) {
         value += get();
     }
+    openQuote = 0;
     get(); // Consume the closing quote
     return Token(TokenType::STRING, value);
 }
@@ -121,6 +170,10 @@ Token Lexer::identifierOrKeyword() {
     std::string value;
     while (!isEnd() && (isAlpha(peek()) || isDigit(peek()) || peek() == '_')) {
         value += get();
+        // A column qualified with its table, e.g. users.id, is a single identifier
+        if (!isEnd() && peek() == '.' && position + 1 < input.size() && isAlpha(input[position + 1])) {
+            value += get();
+        }
     }
 
     // Check if it's a keyword
@@ -2,16 +2,26 @@
 
 #include "Token.h"
 #include <string>
+#include <string_view>
 
 class Lexer {
 public:
-    explicit Lexer(std::string input);
+    explicit Lexer(std::string_view input); // The input is not copied, it has to outlive the lexer
 
     virtual Token nextToken();
 
+    // Helper methods for scripts with many queries separated by ';'
+    virtual void skipToNextQuery(); // Skips the rest of the current query including its ';'
+    [[nodiscard]] virtual bool hasMoreQueries(); // Skips blanks and empty queries, false at the end of input
+    [[nodiscard]] virtual size_t getLine() const; // 1-based line of the current position
+    [[nodiscard]] virtual std::string_view getQueryText() const; // Current query up to and including its ';'
+
 private:
-    std::string input;
+    std::string_view input;
     size_t position = 0;
+    size_t line = 1;
+    size_t queryStart = 0; // Where the current query begins
+    char openQuote = 0; // Quote of the string literal being read, a ';' inside it does not end the query
 
     virtual void skipWhitespace();
     virtual Token identifierOrKeyword();
@@ -28,6 +38,8 @@ private:
     [[nodiscard]] virtual bool isFileEnd() const;
 
     [[nodiscard]] virtual bool isQueryEnd() const;
+    // Position of the ';' ending the current query, skipping the ones inside quotes, or the end of input
+    [[nodiscard]] virtual size_t findQueryEnd() const;
 
     virtual Token comparisonOperator() ;
-};
\ No newline at end of file
+};
@@ -0,0 +1,58 @@
+#include "LogCompactor.h"
+
+#include "Logger.h"
+#include "Snapshot.h"
+#include <chrono>
+#include <fmt/format.h>
+
+LogCompactor::LogCompactor(std::string snapshotFilename, std::shared_ptr<WriteAheadLog> log)
+        : snapshotFilename(std::move(snapshotFilename)), log(std::move(log)) {}
+
+LogCompactor::~LogCompactor() {
+    wait();
+}
+
+bool LogCompactor::startCheckpoint(std::shared_ptr<Database> view, uint64_t logSequence) {
+    std::lock_guard lock(mutex);
+    if (running) {
+        return false;
+    }
+    if (worker.joinable()) {
+        worker.join(); // The previous job has finished
+    }
+    running = true;
+    worker = std::thread([this, view = std::move(view), logSequence] {
+        checkpoint(*view, logSequence);
+        running = false;
+    });
+    return true;
+}
+
+void LogCompactor::wait() {
+    std::lock_guard lock(mutex);
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool LogCompactor::isRunning() const {
+    return running;
+}
+
+void LogCompactor::checkpoint(const Database &view, uint64_t logSequence) {
+    auto start = std::chrono::steady_clock::now();
+    try {
+        // The records folded into the snapshot have to be durable before they can be dropped from the log
+        log->sync();
+        CheckpointStats stats = Snapshot::write(view, snapshotFilename, logSequence);
+        log->discardThrough(logSequence);
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+        Logger::info(fmt::format("Checkpoint written to {} in {} ms ({} segments written, {} unchanged, {} bytes{})",
+                                 snapshotFilename, elapsed.count(), stats.segmentsWritten, stats.segmentsReused,
+                                 stats.bytesWritten, stats.rewritten ? ", data file rewritten" : ""));
+    } catch (const std::exception &e) {
+        Logger::error(fmt::format("Checkpoint failed: {}", e.what()));
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Database.h"
+#include "WriteAheadLog.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Folds the write-ahead log into the snapshot on a background thread, one checkpoint at a time.
+// A checkpoint writes a frozen view of the live database, taken together with the log position it matches,
+// and drops the log records the view reflects. Only the segments changed since the last checkpoint are written,
+// so its cost follows the changes rather than the size of the database.
+class LogCompactor {
+    std::string snapshotFilename;
+    std::shared_ptr<WriteAheadLog> log;
+    std::mutex mutex; // Guards worker
+    std::thread worker;
+    std::atomic<bool> running = false;
+
+    virtual void checkpoint(const Database &view, uint64_t logSequence);
+public:
+    LogCompactor(std::string snapshotFilename, std::shared_ptr<WriteAheadLog> log);
+    LogCompactor(const LogCompactor &) = delete;
+    LogCompactor &operator=(const LogCompactor &) = delete;
+    virtual ~LogCompactor(); // Waits for a running job
+
+    // Starts writing the view as the snapshot, logSequence is the last log record reflected in it.
+    // False when a job is already running.
+    virtual bool startCheckpoint(std::shared_ptr<Database> view, uint64_t logSequence);
+    virtual void wait(); // Waits for a running job to finish
+    [[nodiscard]] virtual bool isRunning() const;
+};
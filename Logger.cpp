@@ -7,8 +7,10 @@
 std::string getCurrentTime() {
     auto now = std::chrono::system_clock::now();
     auto now_c = std::chrono::system_clock::to_time_t(now);
+    std::tm local{};
+    localtime_r(&now_c, &local); // std::localtime shares one buffer between threads
     char buf[100];
-    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", std::localtime(&now_c));
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &local);
     return buf;
 }
 
@@ -0,0 +1,55 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file " + filename);
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat file " + filename);
+    }
+
+    size = static_cast<size_t>(st.st_size);
+    // mmap does not accept zero-length mappings, an empty file is just an empty view
+    if (size > 0) {
+        void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map file " + filename);
+        }
+        // The file is read front to back, let the kernel read ahead aggressively
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(mapping);
+    }
+
+    ::close(fd); // The mapping stays valid after the descriptor is closed
+}
+
+MappedFile::MappedFile(int fd, uint64_t offset, size_t length) : size(length) {
+    if (size > 0) {
+        void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(offset));
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Cannot map file range");
+        }
+        data = static_cast<const char *>(mapping);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (data) {
+        ::munmap(const_cast<char *>(data), size);
+    }
+}
+
+std::string_view MappedFile::view() const {
+    return {data, size};
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file or a part of it, unmapped on destruction
+class MappedFile {
+    const char *data = nullptr; // Start of the mapping (nullptr for an empty file)
+    size_t size = 0; // Size of the mapping in bytes
+public:
+    explicit MappedFile(const std::string &filename); // Throws if the file cannot be opened or mapped
+    // Maps a range of an open file, offset aligned to the page size. The mapping is shared, so what is written
+    // to the file later shows up in it, also past the end of the file at the time of the mapping.
+    MappedFile(int fd, uint64_t offset, size_t length);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    virtual ~MappedFile();
+
+    [[nodiscard]] virtual std::string_view view() const; // Mapped contents
+};
@@ -25,12 +25,27 @@ std::unique_ptr<Query> Parser::parseQuery() {
     } else if (currentToken.type == TokenType::DROP) {
         nextToken(); // Consumes DROP
         return parseDrop();
+    } else if (currentToken.type == TokenType::BEGIN || currentToken.type == TokenType::COMMIT
+               || currentToken.type == TokenType::ROLLBACK) {
+        auto action = currentToken.type;
+        nextToken(); // Consumes the keyword
+        return std::make_unique<TransactionQuery>(action);
     } else {
         // Handle other types or error
-        expect({TokenType::SELECT, TokenType::INSERT, TokenType::CREATE, TokenType::ALTER, TokenType::DROP});
+        expect({TokenType::SELECT, TokenType::INSERT, TokenType::CREATE, TokenType::ALTER, TokenType::DROP,
+                TokenType::BEGIN, TokenType::COMMIT, TokenType::ROLLBACK});
     }
 }
 
+bool Parser::nextQuery() {
+    lexer.skipToNextQuery(); // Drop whatever is left of the current query, also after a parse error
+    if (!lexer.hasMoreQueries()) {
+        return false;
+    }
+    nextToken(); // Pull the first token of the next query
+    return true;
+}
+
 void Parser::nextToken() {
     currentToken = lexer.nextToken();
 }
@@ -54,6 +69,11 @@ void Parser::error(const std::string &message) {
 std::unique_ptr<Query> Parser::parseSelect() {
     auto query = std::make_unique<SelectQuery>();
 
+    if (currentToken.type == TokenType::DISTINCT) {
+        query->distinct = true;
+        nextToken(); // Consume DISTINCT
+    }
+
     // Parse columns or * for all columns
     parseColumns(query);
 
@@ -63,6 +83,11 @@ std::unique_ptr<Query> Parser::parseSelect() {
     // Parse WHERE clause
     parseWhere(query);
 
+    parseGroupBy(query);
+    parseOrderBy(query);
+    parseLimit(query);
+    expect({TokenType::END_OF_QUERY});
+
     return query;
 }
 
@@ -78,7 +103,12 @@ void Parser::parseColumns(std::unique_ptr<SelectQuery> &query) {
 
         if (currentToken.type == TokenType::IDENTIFIER || currentToken.type == TokenType::STAR) {
             query->columns.push_back(currentToken.lexeme);
+            query->aggregates.emplace_back();
             nextToken(); // Consume column name or *
+        } else if (currentToken.type != TokenType::FROM) {
+            auto aggregate = parseAggregate();
+            query->columns.push_back(aggregate.toString());
+            query->aggregates.emplace_back(std::move(aggregate));
         }
     }
     if (query->columns.empty()) {
@@ -86,6 +116,31 @@ void Parser::parseColumns(std::unique_ptr<SelectQuery> &query) {
     }
 }
 
+Aggregate Parser::parseAggregate() {
+    static const std::map<TokenType, Aggregate::Function> functions{
+            {TokenType::COUNT, Aggregate::Function::COUNT}, {TokenType::SUM, Aggregate::Function::SUM},
+            {TokenType::AVG, Aggregate::Function::AVG}, {TokenType::MIN, Aggregate::Function::MIN},
+            {TokenType::MAX, Aggregate::Function::MAX},
+            {TokenType::APPROX_COUNT_DISTINCT, Aggregate::Function::APPROX_COUNT_DISTINCT},
+    };
+    expect({TokenType::COUNT, TokenType::SUM, TokenType::AVG, TokenType::MIN, TokenType::MAX,
+            TokenType::APPROX_COUNT_DISTINCT});
+    auto function = functions.at(currentToken.type);
+    nextToken(); // Consume the function
+    expect({TokenType::LEFT_PAREN});
+    nextToken(); // Consume (
+    std::string column;
+    if (function == Aggregate::Function::COUNT && currentToken.type == TokenType::STAR) {
+        column = currentToken.lexeme;
+        nextToken(); // Consume *
+    } else {
+        column = parseColumnName();
+    }
+    expect({TokenType::RIGHT_PAREN});
+    nextToken(); // Consume )
+    return {function, column};
+}
+
 void Parser::parseFrom(std::unique_ptr<SelectQuery> &query) {
     // From is already in Parser
     expect({TokenType::FROM});
@@ -93,6 +148,18 @@ void Parser::parseFrom(std::unique_ptr<SelectQuery> &query) {
     expect({TokenType::IDENTIFIER});
     query->fromTable = currentToken.lexeme;
     nextToken(); // Consume table name
+
+    if (currentToken.type == TokenType::JOIN) {
+        nextToken(); // Consume JOIN
+        std::string tableName = parseTableName();
+        expect({TokenType::ON});
+        nextToken(); // Consume ON
+        std::string leftColumn = parseColumnName();
+        expect({TokenType::EQUAL});
+        nextToken(); // Consume =
+        std::string rightColumn = parseColumnName();
+        query->join.emplace(std::move(tableName), std::move(leftColumn), std::move(rightColumn));
+    }
 }
 
 
@@ -155,7 +222,71 @@ void Parser::parseWhere(std::unique_ptr<SelectQuery> &query) {
     }
     nextToken(); // Consume WHERE
     query->whereClause = parseOrExpression();
-    expect({TokenType::END_OF_QUERY});
+}
+
+void Parser::parseGroupBy(std::unique_ptr<SelectQuery> &query) {
+    if (currentToken.type != TokenType::GROUP) {
+        return;
+    }
+    nextToken(); // Consume GROUP
+    expect({TokenType::BY});
+    nextToken(); // Consume BY
+
+    query->groupBy.push_back(parseColumnName());
+    while (currentToken.type == TokenType::COMMA) {
+        nextToken(); // Consume comma
+        query->groupBy.push_back(parseColumnName());
+    }
+}
+
+void Parser::parseOrderBy(std::unique_ptr<SelectQuery> &query) {
+    if (currentToken.type != TokenType::ORDER) {
+        return;
+    }
+    nextToken(); // Consume ORDER
+    expect({TokenType::BY});
+    nextToken(); // Consume BY
+
+    while (true) {
+        // An aggregate is sorted by under the name of its result column
+        std::string column = currentToken.type == TokenType::IDENTIFIER ? parseColumnName()
+                                                                         : parseAggregate().toString();
+        bool descending = false;
+        if (currentToken.type == TokenType::ASC || currentToken.type == TokenType::DESC) {
+            descending = currentToken.type == TokenType::DESC;
+            nextToken(); // Consume the direction
+        }
+        query->orderBy.emplace_back(std::move(column), descending);
+        if (currentToken.type != TokenType::COMMA) {
+            break;
+        }
+        nextToken(); // Consume comma
+    }
+}
+
+void Parser::parseLimit(std::unique_ptr<SelectQuery> &query) {
+    if (currentToken.type != TokenType::LIMIT) {
+        return;
+    }
+    auto wholeNumber = [this](const std::string &keyword) {
+        nextToken(); // Consume the keyword
+        expect({TokenType::NUMBER});
+        if (currentToken.lexeme.find('.') != std::string::npos) {
+            error(keyword + " has to be a whole number, got " + currentToken.lexeme);
+        }
+        size_t number = 0;
+        try {
+            number = std::stoull(currentToken.lexeme);
+        } catch (const std::out_of_range &) {
+            error(keyword + " is too large, got " + currentToken.lexeme);
+        }
+        nextToken(); // Consume the number
+        return number;
+    };
+    query->limit = wholeNumber("LIMIT");
+    if (currentToken.type == TokenType::OFFSET) {
+        query->offset = wholeNumber("OFFSET");
+    }
 }
 
 std::unique_ptr<Query> Parser::parseInsert() {
@@ -231,6 +362,9 @@ std::vector<std::string> Parser::parseValues() {
 }
 
 std::unique_ptr<Query> Parser::parseCreate() {
+    if (currentToken.type == TokenType::UNIQUE) {
+        return parseCreateIndex();
+    }
 
     expect({TokenType::TABLE});
     nextToken(); // Consume TABLE
@@ -356,6 +490,24 @@ ParsedRelation Parser::createRelation(const TableConstraint &constraint) {
     return {columnName, referencedTableName, referencedColumnName};
 }
 
+std::unique_ptr<Query> Parser::parseCreateIndex() {
+    nextToken(); // Consume UNIQUE
+    expect({TokenType::INDEX});
+    nextToken(); // Consume INDEX
+    expect({TokenType::ON});
+    nextToken(); // Consume ON
+
+    std::string tableName = parseTableName();
+    expect({TokenType::LEFT_PAREN});
+    nextToken(); // Consume (
+    std::string columnName = parseColumnName();
+    expect({TokenType::RIGHT_PAREN});
+    nextToken(); // Consume )
+    expect({TokenType::END_OF_QUERY});
+
+    return std::make_unique<CreateIndexQuery>(std::move(tableName), std::move(columnName));
+}
+
 std::unique_ptr<Query> Parser::parseAlter() {
     expect({TokenType::TABLE});
     nextToken(); // Consumes TABLE
@@ -11,6 +11,7 @@ public:
     explicit Parser(Lexer &lexer);
 
     std::unique_ptr<Query> parseQuery(); // Parses the entire query
+    virtual bool nextQuery(); // Skips to the next query of a script, false when there are no more queries
 private:
     Lexer &lexer;
     Token currentToken;
@@ -19,6 +20,7 @@ private:
     virtual std::unique_ptr<Query> parseSelect(); // Parses a SELECT query
     virtual std::unique_ptr<Query> parseInsert(); // Parses an INSERT query
     virtual std::unique_ptr<Query> parseCreate(); // Parses a CREATE query
+    virtual std::unique_ptr<Query> parseCreateIndex(); // Parses CREATE UNIQUE INDEX ON table (column)
     virtual std::unique_ptr<Query> parseAlter();
     virtual std::unique_ptr<Query> parseDrop();
 
@@ -29,8 +31,13 @@ private:
 
     // Helper methods for parsing specific parts of the SQL query
     virtual void parseColumns(std::unique_ptr<SelectQuery> &query);
-    virtual void parseFrom(std::unique_ptr<SelectQuery> &query);
+    // COUNT(*), or COUNT, SUM, AVG, MIN, MAX or APPROX_COUNT_DISTINCT of a column
+    virtual Aggregate parseAggregate();
+    virtual void parseFrom(std::unique_ptr<SelectQuery> &query); // FROM table, optionally JOIN table ON a = b
     virtual void parseWhere(std::unique_ptr<SelectQuery> &query);
+    virtual void parseGroupBy(std::unique_ptr<SelectQuery> &query); // GROUP BY column, ...
+    virtual void parseOrderBy(std::unique_ptr<SelectQuery> &query); // ORDER BY column [ASC | DESC], ...
+    virtual void parseLimit(std::unique_ptr<SelectQuery> &query); // LIMIT count [OFFSET skipped]
 
     // Helper methods for parsing WHERE clause
     virtual ConditionGroup parseOrExpression();
@@ -0,0 +1,20 @@
+#include "PwriteIo.h"
+
+#include "BinaryFormat.h"
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+
+PwriteIo::PwriteIo() : pool(THREAD_COUNT) {}
+
+std::future<void> PwriteIo::submitWrite(int fd, std::string_view data, uint64_t offset) {
+    return pool.submit([fd, data, offset] { BinaryFile::writeAt(fd, data, offset); });
+}
+
+std::future<void> PwriteIo::submitSync(int fd) {
+    return pool.submit([fd] {
+        if (::fdatasync(fd) != 0) {
+            throw std::runtime_error(std::string("Cannot sync file: ") + std::strerror(errno));
+        }
+    });
+}
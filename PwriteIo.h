@@ -0,0 +1,16 @@
+#pragma once
+
+#include "AsyncIo.h"
+#include "ThreadPool.h"
+
+// Fallback without io_uring: blocking pwrite and fdatasync calls on a small pool of threads
+class PwriteIo : public AsyncIo {
+    static constexpr size_t THREAD_COUNT = 4; // Writes in flight at once
+
+    ThreadPool pool;
+public:
+    PwriteIo();
+
+    std::future<void> submitWrite(int fd, std::string_view data, uint64_t offset) override;
+    std::future<void> submitSync(int fd) override;
+};
@@ -1,5 +1,8 @@
 #include "Query.h"
 
+#include <algorithm>
+#include <iterator>
+
 Condition::Condition(std::string column, std::string op, std::string value)
         : column(std::move(column)), op(std::move(op)), value(std::move(value)) {}
 
@@ -15,6 +18,35 @@ void ConditionGroup::addConditionGroup(const ConditionGroup &conditionGroup) {
     conditions.emplace_back(conditionGroup);
 }
 
+std::vector<std::variant<Condition, ConditionGroup>> ConditionGroup::getConjuncts() const {
+    if (logicalOperator == TokenType::OR && conditions.size() != 1) {
+        return {*this};
+    }
+    std::vector<std::variant<Condition, ConditionGroup>> conjuncts;
+    for (const auto &condition: conditions) {
+        if (std::holds_alternative<ConditionGroup>(condition)) {
+            auto nested = std::get<ConditionGroup>(condition).getConjuncts();
+            std::ranges::move(nested, std::back_inserter(conjuncts));
+        } else {
+            conjuncts.push_back(condition);
+        }
+    }
+    return conjuncts;
+}
+
+std::vector<std::string> ConditionGroup::getColumnNames() const {
+    std::vector<std::string> columnNames;
+    for (const auto &condition: conditions) {
+        if (std::holds_alternative<ConditionGroup>(condition)) {
+            auto nested = std::get<ConditionGroup>(condition).getColumnNames();
+            std::ranges::move(nested, std::back_inserter(columnNames));
+        } else {
+            columnNames.push_back(std::get<Condition>(condition).column);
+        }
+    }
+    return columnNames;
+}
+
 // Default to AND for top-level group
 SelectQuery::SelectQuery() : whereClause(TokenType::AND) {}
 
@@ -22,6 +54,25 @@ void SelectQuery::addConditionGroup(const ConditionGroup &conditionGroup) {
     whereClause.addConditionGroup(conditionGroup);
 }
 
+bool SelectQuery::isAggregated() const {
+    return distinct || !groupBy.empty() || std::ranges::any_of(aggregates, [](const auto &aggregate) {
+        return aggregate.has_value();
+    });
+}
+
+bool Aggregate::countsRows() const {
+    return function == Function::COUNT && column == "*";
+}
+
+std::string Aggregate::toString() const {
+    static const std::map<Function, std::string> names{
+            {Function::COUNT, "COUNT"}, {Function::SUM, "SUM"}, {Function::AVG, "AVG"},
+            {Function::MIN, "MIN"}, {Function::MAX, "MAX"},
+            {Function::APPROX_COUNT_DISTINCT, "APPROX_COUNT_DISTINCT"},
+    };
+    return names.at(function) + "(" + column + ")";
+}
+
 
 // Data Transfer Objects
 ParsedRelation::ParsedRelation(std::string foreignKeyColumnName, std::string referencedTableName,
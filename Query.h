@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <optional>
 #include <variant>
 
 
@@ -86,6 +87,20 @@ public:
     std::vector<std::string> values;  // Values to insert
 };
 
+// Inserts of a committed transaction, added to the database together or not at all
+class InsertBatchQuery : public Query {
+public:
+    std::vector<std::unique_ptr<InsertQuery>> inserts; // In the order they were issued
+};
+
+// Represents BEGIN, COMMIT or ROLLBACK
+class TransactionQuery : public Query {
+public:
+    TokenType action; // BEGIN, COMMIT or ROLLBACK
+
+    explicit TransactionQuery(TokenType action) : action(action) {}
+};
+
 // Represents a CREATE TABLE query
 class CreateTableQuery : public Query {
 public:
@@ -94,6 +109,16 @@ public:
     std::vector<ParsedRelation> relations; // List of relations
 };
 
+// Represents CREATE UNIQUE INDEX ON table (column), built while inserts into the table go on
+class CreateIndexQuery : public Query {
+public:
+    std::string tableName;
+    std::string columnName; // Gets the UNIQUE constraint once its index is built
+
+    CreateIndexQuery(std::string tableName, std::string columnName)
+            : tableName(std::move(tableName)), columnName(std::move(columnName)) {}
+};
+
 // Represents a condition in the WHERE clause
 class Condition {
 public:
@@ -117,15 +142,70 @@ public:
     virtual void addCondition(const Condition &condition);
 
     virtual void addConditionGroup(const ConditionGroup &conditionGroup);
+
+    // Parts that all have to hold for the group to hold, nested AND groups and groups of one part are flattened
+    [[nodiscard]] virtual std::vector<std::variant<Condition, ConditionGroup>> getConjuncts() const;
+    [[nodiscard]] virtual std::vector<std::string> getColumnNames() const; // Columns of every condition in the group
+};
+
+// Represents JOIN table ON leftColumn = rightColumn, column names may be qualified as table.column
+class JoinClause {
+public:
+    std::string tableName;   // Table joined to the one in FROM
+    std::string leftColumn;
+    std::string rightColumn;
+
+    JoinClause(std::string tableName, std::string leftColumn, std::string rightColumn)
+            : tableName(std::move(tableName)), leftColumn(std::move(leftColumn)),
+              rightColumn(std::move(rightColumn)) {}
+};
+
+// Represents one column of ORDER BY with its direction
+class OrderByItem {
+public:
+    std::string column;
+    bool descending; // DESC, ASC is the default
+
+    OrderByItem(std::string column, bool descending) : column(std::move(column)), descending(descending) {}
+};
+
+// Represents an aggregate in the column list, e.g. SUM(amount), computed over the rows of every group
+class Aggregate {
+public:
+    enum class Function {
+        COUNT, // Rows with a value, or all rows for COUNT(*)
+        SUM,
+        AVG,
+        MIN,
+        MAX,
+        APPROX_COUNT_DISTINCT, // Distinct values, estimated from a HyperLogLog sketch
+    };
+
+    Function function;
+    std::string column; // * for COUNT(*)
+
+    Aggregate(Function function, std::string column) : function(function), column(std::move(column)) {}
+
+    [[nodiscard]] virtual bool countsRows() const; // COUNT(*), which reads no column
+    [[nodiscard]] virtual std::string toString() const; // As written in a query, names the result column
 };
 
 class SelectQuery : public Query {
 public:
     std::vector<std::string> columns;   // List of columns to select
     std::string fromTable;              // From which table
+    std::optional<JoinClause> join;     // Second table, if any
     ConditionGroup whereClause;         // Conditions in the WHERE clause
+    std::vector<std::optional<Aggregate>> aggregates; // Aggregate of every column, empty for a plain column
+    std::vector<std::string> groupBy;   // Columns of GROUP BY
+    std::vector<OrderByItem> orderBy;   // Sort keys, the first one sorts first, empty keeps the order of the table
+    std::optional<size_t> limit;        // Most rows to return
+    size_t offset = 0;                  // Rows skipped before the first one returned
+    bool distinct = false;              // SELECT DISTINCT, returns every combination of values once
 
     SelectQuery();
 
     virtual void addConditionGroup(const ConditionGroup &conditionGroup);
+    // Has an aggregate, GROUP BY or DISTINCT, so it returns a row per group
+    [[nodiscard]] virtual bool isAggregated() const;
 };
@@ -0,0 +1,49 @@
+#include "QueryClient.h"
+
+#include "Logger.h"
+#include "WireProtocol.h"
+#include <fmt/color.h>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+QueryClient::QueryClient(const std::string &address) : fd(WireProtocol::connect(address)) {}
+
+QueryClient::~QueryClient() {
+    ::close(fd);
+}
+
+QueryResult QueryClient::execute(const std::string &query) {
+    WireProtocol::writeFrame(fd, query);
+    auto response = WireProtocol::readFrame(fd);
+    if (!response) {
+        throw std::runtime_error("The server closed the connection");
+    }
+    return WireProtocol::decodeResponse(*response);
+}
+
+void QueryClient::run() {
+    std::string input;
+    std::string query;
+    fmt::print(fg(fmt::color::green), "Connected to FranekQL server, type \\q to quit\n");
+    fmt::print(fg(fmt::color::green), "db > ");
+    while (std::getline(std::cin, input) && input != "\\q") {
+        if (!query.empty()) {
+            query += '\n'; // Keep the lines of a multi-line query apart
+        }
+        query += input;
+
+        if (!query.empty() && query.back() == ';') {
+            try {
+                QueryResult result = execute(query);
+                if (result.hasRows) {
+                    result.printTable();
+                }
+            } catch (const std::exception &e) {
+                Logger::error(e.what());
+            }
+            query.clear();
+            fmt::print(fg(fmt::color::green), "db > ");
+        }
+    }
+}
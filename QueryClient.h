@@ -0,0 +1,17 @@
+#pragma once
+
+#include "QueryResult.h"
+#include <string>
+
+// Connection to a query server, see QueryServer
+class QueryClient {
+    int fd = -1;
+public:
+    explicit QueryClient(const std::string &address); // See WireProtocol::connect
+    QueryClient(const QueryClient &) = delete;
+    QueryClient &operator=(const QueryClient &) = delete;
+    virtual ~QueryClient();
+
+    virtual QueryResult execute(const std::string &query); // Throws the error the query failed with
+    virtual void run(); // Console reading queries from standard input, like the local one
+};
@@ -4,37 +4,276 @@
 #include "Logger.h"
 #include "Lexer.h"
 #include "Parser.h"
+#include <algorithm>
+#include <fmt/format.h>
 
 QueryExecutor::QueryExecutor(const std::shared_ptr<Database> &sharedDB) : db(sharedDB) {} // Constructor
 
+QueryExecutor::~QueryExecutor() {
+    std::unique_lock lock(submitMutex);
+    drained.wait(lock, [&] { return !draining; });
+}
+
+
+std::unique_ptr<QueryExecutor> QueryExecutor::newSession() const {
+    auto session = std::make_unique<QueryExecutor>(db);
+    session->setWriteAheadLog(log);
+    return session;
+}
 
 void QueryExecutor::execute(const std::string &query) {
-    Lexer lexer(query);
-    Parser parser(lexer);
     try {
-        std::unique_ptr<Query> parsedQuery = parser.parseQuery();
-
-        #pragma clang diagnostic push
-        #pragma ide diagnostic ignored "ConstantConditionsOC"
-        #pragma ide diagnostic ignored "UnreachableCode"
-
-        if (auto selectQuery = dynamic_cast<SelectQuery *>(parsedQuery.get())) {
-            db->selectFrom(*selectQuery);
-        } else if (auto createTableQuery = dynamic_cast<CreateTableQuery *>(parsedQuery.get())) {
-            db->createTable(*createTableQuery);
-        } else if (auto insertQuery = dynamic_cast<InsertQuery *>(parsedQuery.get())) {
-            db->insertInto(*insertQuery);
-        } else if (auto alterQuery = dynamic_cast<AlterTableQuery *>(parsedQuery.get())) {
-            db->alterTable(*alterQuery);
-        } else if (auto dropQuery = dynamic_cast<DropTableQuery *>(parsedQuery.get())) {
-            db->dropTable(*dropQuery);
-        } else {
-            throw std::runtime_error("Unknown query type");
+        QueryResult result = executeQuery(query);
+        if (result.hasRows) {
+            result.printTable();
         }
+    } catch (const std::exception &e) {
+        Logger::error(e.what());
+    }
+}
 
-        #pragma clang diagnostic pop
+QueryResult QueryExecutor::executeQuery(const std::string &query) {
+    uint64_t sequenceNumber = 0;
+    QueryOutcome outcome = executeWithoutWait(query, sequenceNumber);
+    if (auto error = std::get_if<QueryError>(&outcome)) {
+        throw std::runtime_error(error->message);
+    }
+    // The locks are released before waiting for the log
+    if (sequenceNumber) {
+        log->commit(sequenceNumber);
+    }
+    return std::get<QueryResult>(std::move(outcome));
+}
 
+QueryOutcome QueryExecutor::executeWithoutWait(const std::string &query, uint64_t &sequenceNumber) {
+    sequenceNumber = 0;
+    std::unique_ptr<Query> parsedQuery;
+    try {
+        Lexer lexer(query);
+        Parser parser(lexer);
+        parsedQuery = parser.parseQuery();
     } catch (const std::exception &e) {
-        Logger::error(e.what());
+        return QueryError{QueryError::Stage::PARSE, e.what()};
+    }
+
+    QueryResult result;
+    try {
+        sequenceNumber = executeAndLog(*parsedQuery, query, &result);
+    } catch (const std::exception &e) {
+        return QueryError{QueryError::Stage::EXECUTION, e.what()};
+    }
+    return result;
+}
+
+std::future<QueryOutcome> QueryExecutor::submit(std::string query) {
+    std::promise<QueryOutcome> outcome;
+    auto future = outcome.get_future();
+    std::lock_guard lock(submitMutex);
+    submitted.push_back({std::move(query), std::move(outcome)});
+    if (!draining) {
+        // One task per executor at a time keeps its queries in order. Queries wait on locks, so they run on the
+        // blocking pool and not on the scheduler their scans use.
+        draining = true;
+        (void) db->getBlockingPool().submit([this] { runSubmitted(); });
+    }
+    return future;
+}
+
+void QueryExecutor::runSubmitted() {
+    std::unique_lock lock(submitMutex);
+    while (!submitted.empty()) {
+        auto batch = std::make_shared<std::deque<SubmittedQuery>>(std::move(submitted));
+        submitted.clear();
+        lock.unlock();
+
+        auto outcomes = std::make_shared<std::vector<QueryOutcome>>();
+        auto logged = std::make_shared<std::vector<bool>>();
+        uint64_t lastSequenceNumber = 0;
+        for (auto &query: *batch) {
+            uint64_t sequenceNumber = 0;
+            outcomes->push_back(executeWithoutWait(query.text, sequenceNumber));
+            logged->push_back(sequenceNumber != 0);
+            lastSequenceNumber = std::max(lastSequenceNumber, sequenceNumber);
+        }
+
+        // The flusher hands out the outcomes once every record of the batch is durable, the next batch runs
+        // in the meantime
+        auto complete = [batch, outcomes, logged](const std::string &logFailure) {
+            for (size_t i = 0; i < batch->size(); ++i) {
+                if ((*logged)[i] && !logFailure.empty()) {
+                    (*outcomes)[i] = QueryError{QueryError::Stage::LOG, logFailure};
+                }
+                (*batch)[i].outcome.set_value(std::move((*outcomes)[i]));
+            }
+        };
+        if (lastSequenceNumber) {
+            log->commitAsync(lastSequenceNumber, complete);
+        } else {
+            complete("");
+        }
+        lock.lock();
+    }
+    draining = false;
+    drained.notify_all();
+}
+
+void QueryExecutor::execute(const Query &query) {
+    auto lock = db->lock(query);
+    run(query);
+}
+
+uint64_t QueryExecutor::executeAndLog(const Query &query, std::string_view text, QueryResult *result) {
+    if (auto transactionQuery = dynamic_cast<const TransactionQuery *>(&query)) {
+        return runTransactionControl(*transactionQuery);
+    }
+    if (transaction && !dynamic_cast<const SelectQuery *>(&query)) {
+        stage(query, text);
+        return 0;
     }
+
+    // Logged when the change commits, so the log has the changes in the order they were made
+    auto lock = db->lock(query);
+    uint64_t sequenceNumber = 0;
+    QueryResult queryResult = run(query, [&] { sequenceNumber = appendToLog(query, text); });
+    if (result) {
+        *result = std::move(queryResult);
+    }
+    return sequenceNumber;
+}
+
+uint64_t QueryExecutor::runTransactionControl(const TransactionQuery &query) {
+    if (query.action == TokenType::BEGIN) {
+        if (transaction) {
+            throw std::runtime_error("A transaction is already open");
+        }
+        transaction = std::make_unique<InsertBatchQuery>();
+        return 0;
+    }
+    if (!transaction) {
+        throw std::runtime_error("No transaction is open");
+    }
+
+    // The transaction ends here whether its rows make it into the database or not
+    auto batch = std::move(transaction);
+    std::string text = "BEGIN;\n" + std::move(transactionText) + "COMMIT;";
+    transactionText.clear();
+    transactionKeys.clear();
+    if (query.action == TokenType::ROLLBACK || batch->inserts.empty()) {
+        return 0;
+    }
+
+    // Rows of other sessions committed since the inserts were checked may clash with them, so the whole batch
+    // is validated again under the locks
+    auto lock = db->lock(*batch);
+    uint64_t sequenceNumber = 0;
+    db->insertBatch(*batch, [&] { sequenceNumber = appendToLog(*batch, text); });
+    return sequenceNumber;
+}
+
+void QueryExecutor::stage(const Query &query, std::string_view text) {
+    auto insertQuery = dynamic_cast<const InsertQuery *>(&query);
+    if (!insertQuery) {
+        throw std::runtime_error("Only INSERT and SELECT can run inside a transaction");
+    }
+    {
+        // Report a bad row right away, it is left out of the transaction
+        auto lock = db->lock(query);
+        (void) db->prepareRow(*insertQuery, transactionKeys);
+    }
+    transaction->inserts.push_back(std::make_unique<InsertQuery>(*insertQuery));
+    transactionText.append(text);
+    transactionText.push_back('\n');
+}
+
+QueryResult QueryExecutor::run(const Query &query, const std::function<void()> &atCommit) {
+    #pragma clang diagnostic push
+    #pragma ide diagnostic ignored "ConstantConditionsOC"
+    #pragma ide diagnostic ignored "UnreachableCode"
+
+    if (auto selectQuery = dynamic_cast<const SelectQuery *>(&query)) {
+        return db->selectFrom(*selectQuery);
+    } else if (auto insertQuery = dynamic_cast<const InsertQuery *>(&query)) {
+        db->insertInto(*insertQuery, atCommit);
+        return {};
+    } else if (auto batchQuery = dynamic_cast<const InsertBatchQuery *>(&query)) {
+        db->insertBatch(*batchQuery, atCommit);
+        return {};
+    } else if (auto indexQuery = dynamic_cast<const CreateIndexQuery *>(&query)) {
+        db->createIndex(*indexQuery, atCommit);
+        return {};
+    } else if (auto createTableQuery = dynamic_cast<const CreateTableQuery *>(&query)) {
+        // Schema changes hold the whole catalog and log before they apply, nothing else commits in between
+        db->createTable(*createTableQuery, atCommit);
+    } else if (auto alterQuery = dynamic_cast<const AlterTableQuery *>(&query)) {
+        db->alterTable(*alterQuery, atCommit);
+    } else if (auto dropQuery = dynamic_cast<const DropTableQuery *>(&query)) {
+        db->dropTable(*dropQuery, atCommit);
+    } else {
+        throw std::runtime_error("Unknown query type");
+    }
+
+    #pragma clang diagnostic pop
+    return {};
+}
+
+ScriptResult QueryExecutor::executeScript(std::string_view script) {
+    ScriptResult result;
+    // One lexer and one parser stream over the whole script, queries may span many lines
+    Lexer lexer(script);
+    if (!lexer.hasMoreQueries()) {
+        return result;
+    }
+    Parser parser(lexer);
+    uint64_t lastSequenceNumber = 0;
+    do {
+        size_t line = lexer.getLine();
+        try {
+            std::unique_ptr<Query> parsedQuery = parser.parseQuery();
+            // The whole script is committed at once at the end
+            QueryResult queryResult;
+            if (uint64_t sequenceNumber = executeAndLog(*parsedQuery, lexer.getQueryText(), &queryResult)) {
+                lastSequenceNumber = sequenceNumber;
+            }
+            if (queryResult.hasRows) {
+                queryResult.printTable();
+            }
+            ++result.executed;
+        } catch (const std::exception &e) {
+            // Report and carry on with the next query
+            ++result.failed;
+            Logger::error(fmt::format("Query {} (line {}): {}", result.executed + result.failed, line, e.what()));
+        }
+    } while (parser.nextQuery());
+
+    if (rollbackOpenTransaction()) {
+        ++result.failed;
+        Logger::error(fmt::format("Query {}: the script ended inside a transaction, it was rolled back",
+                                  result.executed + result.failed));
+    }
+    if (lastSequenceNumber) {
+        log->commit(lastSequenceNumber);
+    }
+    return result;
+}
+
+bool QueryExecutor::rollbackOpenTransaction() {
+    if (!transaction) {
+        return false;
+    }
+    transaction.reset();
+    transactionText.clear();
+    transactionKeys.clear();
+    return true;
+}
+
+uint64_t QueryExecutor::appendToLog(const Query &query, std::string_view text) {
+    // SELECT does not change anything, there is nothing to recover
+    if (!log || dynamic_cast<const SelectQuery *>(&query)) {
+        return 0;
+    }
+    return log->append(text);
+}
+
+void QueryExecutor::setWriteAheadLog(std::shared_ptr<WriteAheadLog> writeAheadLog) {
+    log = std::move(writeAheadLog);
 }
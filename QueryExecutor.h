@@ -1,14 +1,76 @@
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <future>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <mutex>
 #include "Database.h"
+#include "WriteAheadLog.h"
 
+// Outcome of running a script with many queries
+struct ScriptResult {
+    size_t executed = 0; // Number of queries executed successfully
+    size_t failed = 0; // Number of queries that raised an error
+};
+
+// Runs queries on a database shared by many threads, each query under the database locks it needs.
+// Between BEGIN and COMMIT inserts are checked and buffered, COMMIT adds them all at once and writes them
+// to the log as one record. The open transaction belongs to the executor, so every session needs its own.
+// Queries given to submit() run in order on the blocking pool of the database; a run of queued queries waits
+// for the log once and without holding a thread, so pipelining many of them costs no thread per query and one sync
+// per run.
 class QueryExecutor {
+    // Query waiting for the blocking pool
+    struct SubmittedQuery {
+        std::string text;
+        std::promise<QueryOutcome> outcome;
+    };
+
+    std::mutex submitMutex; // Guards submitted and draining
+    std::condition_variable drained;
+    std::deque<SubmittedQuery> submitted;
+    bool draining = false; // A task of the blocking pool is running the submitted queries
+
+    virtual void runSubmitted(); // Task of the blocking pool, runs queries until none are left
+
 protected:
     std::shared_ptr<Database> db; // Make sure this is a shared pointer
+    std::shared_ptr<WriteAheadLog> log; // Statements that change the database are appended here, may be empty
+    std::unique_ptr<InsertBatchQuery> transaction; // Inserts of the open transaction, null outside of one
+    std::string transactionText; // Statements of the open transaction as they go to the log
+    PendingKeys transactionKeys; // Keys of the buffered rows, checked by the next inserts of the transaction
+
+    virtual uint64_t appendToLog(const Query &query, std::string_view text); // Returns 0 when nothing was logged
+    // Returns the sequence number or 0, the rows of a SELECT go to result when it is given
+    virtual uint64_t executeAndLog(const Query &query, std::string_view text, QueryResult *result = nullptr);
+    virtual uint64_t runTransactionControl(const TransactionQuery &query); // Returns the sequence number or 0
+    virtual void stage(const Query &query, std::string_view text); // Buffers a statement of the open transaction
+    // Runs the query on the database, the caller holds its lock. atCommit runs once a change commits.
+    virtual QueryResult run(const Query &query, const std::function<void()> &atCommit = nullptr);
+    // Parses, runs and logs the query without waiting for the log, sequenceNumber is 0 when nothing was logged
+    virtual QueryOutcome executeWithoutWait(const std::string &query, uint64_t &sequenceNumber);
 public:
     explicit QueryExecutor(const std::shared_ptr<Database> &sharedDB);
+    QueryExecutor(const QueryExecutor &) = delete;
+    QueryExecutor &operator=(const QueryExecutor &) = delete;
+    virtual ~QueryExecutor(); // Waits for the submitted queries
 
+    // Executor of another session over the same database and log, e.g. for one client of a server
+    [[nodiscard]] virtual std::unique_ptr<QueryExecutor> newSession() const;
     virtual void execute(const std::string &query); // Function to execute a query
-};
\ No newline at end of file
+    // Runs one query, waits until its log record is durable and returns its rows, throws on errors
+    virtual QueryResult executeQuery(const std::string &query);
+    // Queues the query and returns at once. The outcome is ready when the query ran and its log record is durable.
+    // Do not mix with the synchronous calls on the same executor while queries are pending.
+    virtual std::future<QueryOutcome> submit(std::string query);
+    virtual void execute(const Query &query); // Executes an already parsed query without logging it, throws on errors
+    // Tokenizes the script once and runs every query. A transaction the script leaves open is rolled back and
+    // counted as a failed query, so it does not take in the queries that follow the script.
+    virtual ScriptResult executeScript(std::string_view script);
+    // Drops the inserts of the open transaction, e.g. when its session ends. Returns whether one was open.
+    virtual bool rollbackOpenTransaction();
+    virtual void setWriteAheadLog(std::shared_ptr<WriteAheadLog> writeAheadLog);
+};
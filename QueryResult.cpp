@@ -0,0 +1,54 @@
+#include "QueryResult.h"
+
+#include <algorithm>
+#include <fmt/format.h>
+
+std::string QueryResult::toTable() const {
+    std::string table;
+    writeTable([&table](std::string_view text) { table += text; });
+    return table;
+}
+
+void QueryResult::printTable() const {
+    writeTable([](std::string_view text) { fmt::print("{}", text); });
+}
+
+void QueryResult::writeTable(const std::function<void(std::string_view text)> &write) const {
+    if (rows.empty()) {
+        write("No data to display.\n");
+        return;
+    }
+
+    // Width of every column, fitting its name and all of its values. A LIMIT is applied before the rows get
+    // here, so a small page of a large table only measures its own rows.
+    std::vector<size_t> widths;
+    for (const auto &column: columns) {
+        widths.push_back(column.length());
+    }
+    for (const auto &row: rows) {
+        for (size_t i = 0; i < widths.size(); ++i) {
+            widths[i] = std::max(widths[i], row[i].length());
+        }
+    }
+
+    // Create a horizontal separator
+    std::string separator;
+    for (size_t width: widths) {
+        separator += "+" + std::string(width + 2, '-');  // +2 for spacing
+    }
+    separator += "+\n";
+
+    // Header, then the rows, each written out on its own
+    std::string line;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        line += fmt::format("| {:^{}} ", columns[i], widths[i]);
+    }
+    write(separator + line + "|\n" + separator);
+    for (const auto &row: rows) {
+        line.clear();
+        for (size_t i = 0; i < columns.size(); ++i) {
+            line += fmt::format("| {:^{}} ", row[i], widths[i]);
+        }
+        write(line + "|\n" + separator);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// Rows a query returned, values already rendered as text. Statements that only change the database return none.
+struct QueryResult {
+    bool hasRows = false; // Set by SELECT, even when no row matched
+    std::vector<std::string> columns;
+    std::vector<std::vector<std::string>> rows; // Values in the order of columns
+
+    [[nodiscard]] virtual std::string toTable() const; // Bordered table as the console prints it
+    virtual void printTable() const; // Prints the table to stdout a row at a time
+    // Hands the table over in pieces, a row at a time, instead of building all of its text first
+    virtual void writeTable(const std::function<void(std::string_view text)> &write) const;
+};
+
+// Why a query failed
+struct QueryError {
+    enum class Stage {
+        PARSE, // The text is not a valid query, nothing ran
+        EXECUTION, // The query was rejected by the database, nothing changed
+        LOG, // The change was made but the log could not make it durable
+    };
+
+    Stage stage;
+    std::string message;
+};
+
+using QueryOutcome = std::variant<QueryResult, QueryError>;
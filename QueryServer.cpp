@@ -0,0 +1,142 @@
+#include "QueryServer.h"
+
+#include "Logger.h"
+#include "WireProtocol.h"
+#include <cerrno>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+QueryServer::Session::Session(int fd, std::unique_ptr<QueryExecutor> executor)
+        : fd(fd), executor(std::move(executor)) {}
+
+QueryServer::Session::~Session() {
+    if (executor->rollbackOpenTransaction()) {
+        Logger::warning("A client disconnected inside a transaction, it was rolled back");
+    }
+    ::close(fd);
+}
+
+QueryServer::QueryServer(std::shared_ptr<QueryExecutor> executor, size_t workerCount,
+                         std::function<void()> afterQuery)
+        : executor(std::move(executor)), afterQuery(std::move(afterQuery)) {
+    if (::pipe2(wakeFds, O_CLOEXEC | O_NONBLOCK) != 0) {
+        throw std::runtime_error("Cannot create the wake-up pipe of the server");
+    }
+    workers = std::make_unique<ThreadPool>(workerCount);
+}
+
+QueryServer::~QueryServer() {
+    workers.reset(); // Running requests still hand their sessions back
+    if (listenFd >= 0) {
+        ::close(listenFd);
+    }
+    ::close(wakeFds[0]);
+    ::close(wakeFds[1]);
+}
+
+void QueryServer::listen(const std::string &address) {
+    listenFd = WireProtocol::listen(address);
+}
+
+void QueryServer::run() {
+    if (listenFd < 0) {
+        throw std::runtime_error("The server is not listening");
+    }
+
+    std::map<int, std::shared_ptr<Session>> idle; // Connections waiting for their next request
+    while (true) {
+        std::vector<pollfd> watched{{wakeFds[0], POLLIN, 0}, {listenFd, POLLIN, 0}};
+        for (const auto &[fd, session]: idle) {
+            watched.push_back({fd, POLLIN, 0});
+        }
+        if (::poll(watched.data(), watched.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Waiting for clients failed");
+        }
+
+        if (watched[0].revents) {
+            char drained[64];
+            while (::read(wakeFds[0], drained, sizeof(drained)) > 0) {}
+            std::lock_guard lock(mutex);
+            if (stopping) {
+                break;
+            }
+            for (auto &session: returned) {
+                int fd = session->fd;
+                idle.emplace(fd, std::move(session));
+            }
+            returned.clear();
+        }
+
+        if (watched[1].revents & POLLIN) {
+            int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                timeval timeout{RECEIVE_TIMEOUT_SECONDS, 0};
+                ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                idle.emplace(fd, std::make_shared<Session>(fd, executor->newSession()));
+            }
+        }
+
+        // A request, or the client went away, either way a worker takes the session
+        for (size_t i = 2; i < watched.size(); ++i) {
+            if (watched[i].revents) {
+                auto it = idle.find(watched[i].fd);
+                workers->submit([this, session = std::move(it->second)] { serve(session); });
+                idle.erase(it);
+            }
+        }
+    }
+
+    // Let the running requests finish, their sessions are then dropped with the idle ones
+    workers.reset();
+    std::lock_guard lock(mutex);
+    returned.clear();
+}
+
+void QueryServer::serve(const std::shared_ptr<Session> &session) {
+    try {
+        auto request = WireProtocol::readFrame(session->fd);
+        if (!request) {
+            return; // The client disconnected, dropping the session closes the connection
+        }
+
+        std::string response;
+        try {
+            response = WireProtocol::encodeResult(session->executor->executeQuery(*request));
+        } catch (const std::exception &e) {
+            response = WireProtocol::encodeError(e.what());
+        }
+        WireProtocol::writeFrame(session->fd, response);
+        if (afterQuery) {
+            afterQuery();
+        }
+    } catch (const std::exception &e) {
+        Logger::warning(fmt::format("Dropping client connection: {}", e.what()));
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        returned.push_back(session);
+    }
+    wake();
+}
+
+void QueryServer::wake() {
+    char signal = 1;
+    [[maybe_unused]] auto written = ::write(wakeFds[1], &signal, 1); // A full pipe already wakes the server
+}
+
+void QueryServer::stop() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake();
+}
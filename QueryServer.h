@@ -0,0 +1,51 @@
+#pragma once
+
+#include "QueryExecutor.h"
+#include "ThreadPool.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Serves queries of many local clients over a Unix socket or a loopback TCP port.
+// One thread waits for connections and requests, the queries run on a fixed pool of workers sharing one
+// database. Every connection is a session with its own executor, so a transaction stays with its client.
+// A session is handed to a worker for one request at a time, so requests of one client run in order.
+class QueryServer {
+    // One client connection, closed when the last reference goes away
+    struct Session {
+        int fd;
+        std::unique_ptr<QueryExecutor> executor;
+
+        Session(int fd, std::unique_ptr<QueryExecutor> executor);
+        ~Session();
+    };
+
+    static constexpr int RECEIVE_TIMEOUT_SECONDS = 30; // A client stuck in the middle of a request frees its worker
+
+    std::shared_ptr<QueryExecutor> executor; // Sessions are created from it
+    std::function<void()> afterQuery; // Runs on the worker after every query, e.g. to start a log compaction
+    int listenFd = -1;
+    int wakeFds[2] = {-1, -1}; // Pipe that interrupts the wait of the serving thread
+    std::unique_ptr<ThreadPool> workers;
+
+    std::mutex mutex; // Guards returned and stopping
+    std::vector<std::shared_ptr<Session>> returned; // Sessions done with a request, to be watched again
+    bool stopping = false;
+
+    virtual void serve(const std::shared_ptr<Session> &session); // Answers one request, runs on a worker
+    virtual void wake();
+
+public:
+    QueryServer(std::shared_ptr<QueryExecutor> executor, size_t workerCount,
+                std::function<void()> afterQuery = nullptr);
+    QueryServer(const QueryServer &) = delete;
+    QueryServer &operator=(const QueryServer &) = delete;
+    virtual ~QueryServer();
+
+    virtual void listen(const std::string &address); // See WireProtocol::listen
+    virtual void run(); // Serves clients until stop(), then waits for the running queries and drops the connections
+    virtual void stop(); // Safe to call from any thread
+};
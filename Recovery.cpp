@@ -0,0 +1,243 @@
+#include "Recovery.h"
+
+#include "Lexer.h"
+#include "Logger.h"
+#include "Parser.h"
+#include "QueryExecutor.h"
+#include "Snapshot.h"
+#include "WriteAheadLog.h"
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <fmt/format.h>
+#include <future>
+#include <map>
+#include <mutex>
+
+// Log record that failed on replay
+struct ReplayFailure {
+    uint64_t sequenceNumber;
+    std::string message;
+};
+
+// Inserts into one table between two schema changes, replayed in log order by a single thread
+struct InsertGroup {
+    std::vector<std::pair<uint64_t, const InsertQuery *>> inserts;
+    std::vector<size_t> dependents; // Groups of the tables referencing this one
+    size_t waitingFor = 0; // Groups of referenced tables not replayed yet
+    size_t executed = 0;
+    std::vector<ReplayFailure> failures;
+};
+
+// A record is one statement, or a whole transaction written as BEGIN; ...; COMMIT;
+static std::unique_ptr<Query> parseRecord(std::string_view statement) {
+    Lexer lexer(statement);
+    Parser parser(lexer);
+    auto query = parser.parseQuery();
+    if (!dynamic_cast<const TransactionQuery *>(query.get())) {
+        return query;
+    }
+
+    auto batch = std::make_unique<InsertBatchQuery>();
+    while (parser.nextQuery()) {
+        auto next = parser.parseQuery();
+        auto end = dynamic_cast<const TransactionQuery *>(next.get());
+        if (dynamic_cast<const InsertQuery *>(next.get())) {
+            batch->inserts.emplace_back(static_cast<InsertQuery *>(next.release()));
+        } else if (end && end->action == TokenType::COMMIT) {
+            return batch;
+        } else {
+            throw std::runtime_error("Unexpected statement in a logged transaction");
+        }
+    }
+    throw std::runtime_error("Logged transaction has no COMMIT");
+}
+
+static void replayGroup(QueryExecutor &executor, InsertGroup &group) {
+    for (const auto &[sequenceNumber, insert]: group.inserts) {
+        try {
+            executor.execute(*insert);
+            ++group.executed;
+        } catch (const std::exception &e) {
+            group.failures.push_back({sequenceNumber, e.what()});
+        }
+    }
+}
+
+// Replays a run of inserts with no schema change in between. Tables only depend on each other through
+// foreign keys, so every table gets its own task, started once all the tables it references are complete.
+// Rows are never deleted, hence a referenced table holding more rows than it did at the time of the insert
+// cannot change the outcome of the insert.
+static void replayInserts(const std::shared_ptr<Database> &database, QueryExecutor &executor, TaskScheduler &scheduler,
+                          std::vector<std::pair<uint64_t, std::unique_ptr<Query>>> &inserts,
+                          RecoveryResult &result, std::vector<ReplayFailure> &failures) {
+    if (inserts.empty()) {
+        return;
+    }
+
+    std::vector<InsertGroup> groups;
+    std::map<std::string, size_t> groupOfTable;
+    for (const auto &[sequenceNumber, query]: inserts) {
+        const auto *insert = static_cast<const InsertQuery *>(query.get());
+        auto [it, added] = groupOfTable.try_emplace(insert->tableName, groups.size());
+        if (added) {
+            groups.emplace_back();
+        }
+        groups[it->second].inserts.emplace_back(sequenceNumber, insert);
+    }
+
+    // Dependency DAG from the foreign keys of the tables as they are right now
+    for (const auto &[tableName, groupIndex]: groupOfTable) {
+        auto table = database->getTableDefinition(tableName);
+        if (!table.has_value()) {
+            continue; // Every insert of the group fails anyway
+        }
+        for (const auto &foreignKey: table.value()->getForeignKeys()) {
+            auto referenced = groupOfTable.find(foreignKey.getReferencedTable()->getName());
+            if (referenced != groupOfTable.end() && referenced->second != groupIndex) {
+                groups[referenced->second].dependents.push_back(groupIndex);
+                ++groups[groupIndex].waitingFor;
+            }
+        }
+    }
+
+    // Kahn's algorithm only to find out whether the graph has a cycle
+    std::vector<size_t> waiting;
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < groups.size(); ++i) {
+        waiting.push_back(groups[i].waitingFor);
+        if (groups[i].waitingFor == 0) {
+            ready.push_back(i);
+        }
+    }
+    size_t ordered = 0;
+    while (!ready.empty()) {
+        size_t current = ready.back();
+        ready.pop_back();
+        ++ordered;
+        for (size_t dependent: groups[current].dependents) {
+            if (--waiting[dependent] == 0) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+
+    if (ordered < groups.size()) {
+        // Tables referencing each other, only the original order is safe
+        InsertGroup all;
+        for (const auto &[sequenceNumber, query]: inserts) {
+            all.inserts.emplace_back(sequenceNumber, static_cast<const InsertQuery *>(query.get()));
+        }
+        replayGroup(executor, all);
+        groups = {std::move(all)};
+    } else {
+        std::mutex mutex; // Guards waitingFor and remaining
+        std::condition_variable finished;
+        size_t remaining = groups.size();
+
+        std::function<void(size_t)> schedule = [&](size_t groupIndex) {
+            scheduler.submit([&, groupIndex] {
+                replayGroup(executor, groups[groupIndex]);
+                std::lock_guard lock(mutex);
+                for (size_t dependent: groups[groupIndex].dependents) {
+                    if (--groups[dependent].waitingFor == 0) {
+                        schedule(dependent);
+                    }
+                }
+                if (--remaining == 0) {
+                    finished.notify_one();
+                }
+            });
+        };
+
+        {
+            std::lock_guard lock(mutex);
+            for (size_t i = 0; i < groups.size(); ++i) {
+                if (groups[i].waitingFor == 0) {
+                    schedule(i);
+                }
+            }
+        }
+        std::unique_lock lock(mutex);
+        finished.wait(lock, [&] { return remaining == 0; });
+    }
+
+    for (auto &group: groups) {
+        result.replayed += group.executed;
+        result.failed += group.failures.size();
+        std::ranges::move(group.failures, std::back_inserter(failures));
+    }
+    inserts.clear();
+}
+
+RecoveryResult Recovery::restore(const std::shared_ptr<Database> &database, const std::string &snapshotFilename,
+                                 const std::string &logFilename) {
+    RecoveryResult result;
+    auto &scheduler = *database->getScheduler();
+    if (std::filesystem::exists(snapshotFilename)) {
+        result.logSequence = Snapshot::load(snapshotFilename, *database);
+        result.snapshotLoaded = true;
+    }
+
+    if (!std::filesystem::exists(logFilename) || std::filesystem::file_size(logFilename) == 0) {
+        return result;
+    }
+
+    // The executor has no log attached, so nothing is written twice
+    QueryExecutor executor(database);
+    std::vector<std::pair<uint64_t, std::unique_ptr<Query>>> inserts; // Since the last schema change
+    std::vector<ReplayFailure> failures;
+
+    // Records up to the snapshot's sequence are already in it, e.g. after a crash in the middle of a checkpoint
+    std::vector<LogRecord> records = WriteAheadLog::readRecords(logFilename);
+    std::erase_if(records, [&](const LogRecord &record) {
+        return record.sequenceNumber <= result.logSequence;
+    });
+    if (!records.empty()) {
+        result.logSequence = records.back().sequenceNumber;
+    }
+
+    // Parsing does not touch the database, contiguous chunks of records are parsed in parallel
+    std::vector<std::unique_ptr<Query>> queries(records.size());
+    std::vector<std::string> parseErrors(records.size());
+    size_t grainSize = std::max<size_t>(1, (records.size() + scheduler.size() - 1) / scheduler.size());
+    scheduler.parallelFor(0, records.size(), grainSize, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            try {
+                queries[i] = parseRecord(records[i].statement);
+            } catch (const std::exception &e) {
+                parseErrors[i] = e.what();
+            }
+        }
+    });
+
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (!queries[i]) {
+            ++result.failed;
+            failures.push_back({records[i].sequenceNumber, parseErrors[i]});
+            continue;
+        }
+
+        if (dynamic_cast<const InsertQuery *>(queries[i].get())) {
+            inserts.emplace_back(records[i].sequenceNumber, std::move(queries[i]));
+            continue;
+        }
+
+        // Schema changes and transactions are barriers: everything before them is replayed first, then they run alone
+        replayInserts(database, executor, scheduler, inserts, result, failures);
+        try {
+            executor.execute(*queries[i]);
+            ++result.replayed;
+        } catch (const std::exception &e) {
+            ++result.failed;
+            failures.push_back({records[i].sequenceNumber, e.what()});
+        }
+    }
+    replayInserts(database, executor, scheduler, inserts, result, failures);
+
+    std::ranges::sort(failures, {}, &ReplayFailure::sequenceNumber);
+    for (const auto &failure: failures) {
+        Logger::error(fmt::format("Log record {}: {}", failure.sequenceNumber, failure.message));
+    }
+    return result;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Database.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Outcome of rebuilding a database from disk
+struct RecoveryResult {
+    bool snapshotLoaded = false;
+    uint64_t logSequence = 0; // Last log record reflected in the rebuilt database
+    size_t replayed = 0; // Log records executed after the snapshot
+    size_t failed = 0; // Log records that raised an error
+};
+
+// Rebuilds a database from the last snapshot and the write-ahead log records written after it.
+// Tables are loaded and their log records replayed on the scheduler of the database, in the order of their foreign keys.
+class Recovery {
+public:
+    static RecoveryResult restore(const std::shared_ptr<Database> &database, const std::string &snapshotFilename,
+                                  const std::string &logFilename);
+};
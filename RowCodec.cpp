@@ -0,0 +1,135 @@
+#include "RowCodec.h"
+
+#include <stdexcept>
+
+void RowCodec::encodeValue(ByteWriter &writer, DataType type, const VariantType &value) {
+    switch (type) {
+        case DataType::INTEGER:
+            writer.writeI32(std::get<int>(value));
+            break;
+        case DataType::FLOAT:
+            writer.writeFloat(std::get<float>(value));
+            break;
+        case DataType::BOOLEAN:
+            writer.writeU8(std::get<bool>(value) ? 1 : 0);
+            break;
+        case DataType::TEXT:
+            writer.writeString(std::get<std::string>(value));
+            break;
+        case DataType::DOUBLE:
+            writer.writeDouble(std::get<double>(value));
+            break;
+        case DataType::CHAR:
+            writer.writeU8(static_cast<uint8_t>(std::get<char>(value)));
+            break;
+        case DataType::DATE: {
+            const auto &date = std::get<Date>(value);
+            writer.writeI32(date.year);
+            writer.writeU8(static_cast<uint8_t>(date.month));
+            writer.writeU8(static_cast<uint8_t>(date.day));
+            break;
+        }
+        case DataType::TIME: {
+            const auto &time = std::get<Time>(value);
+            writer.writeU8(static_cast<uint8_t>(time.hour));
+            writer.writeU8(static_cast<uint8_t>(time.minute));
+            writer.writeU8(static_cast<uint8_t>(time.second));
+            break;
+        }
+        case DataType::DATETIME: {
+            const auto &dateTime = std::get<DateTime>(value);
+            writer.writeI32(dateTime.date.year);
+            writer.writeU8(static_cast<uint8_t>(dateTime.date.month));
+            writer.writeU8(static_cast<uint8_t>(dateTime.date.day));
+            writer.writeU8(static_cast<uint8_t>(dateTime.time.hour));
+            writer.writeU8(static_cast<uint8_t>(dateTime.time.minute));
+            writer.writeU8(static_cast<uint8_t>(dateTime.time.second));
+            break;
+        }
+        default:
+            throw std::runtime_error("Unsupported type");
+    }
+}
+
+VariantType RowCodec::decodeValue(ByteReader &reader, DataType type) {
+    switch (type) {
+        case DataType::INTEGER:
+            return reader.readI32();
+        case DataType::FLOAT:
+            return reader.readFloat();
+        case DataType::BOOLEAN:
+            return reader.readU8() != 0;
+        case DataType::TEXT:
+            return std::string(reader.readString());
+        case DataType::DOUBLE:
+            return reader.readDouble();
+        case DataType::CHAR:
+            return static_cast<char>(reader.readU8());
+        case DataType::DATE: {
+            Date date;
+            date.year = reader.readI32();
+            date.month = reader.readU8();
+            date.day = reader.readU8();
+            return date;
+        }
+        case DataType::TIME: {
+            Time time;
+            time.hour = reader.readU8();
+            time.minute = reader.readU8();
+            time.second = reader.readU8();
+            return time;
+        }
+        case DataType::DATETIME: {
+            DateTime dateTime;
+            dateTime.date.year = reader.readI32();
+            dateTime.date.month = reader.readU8();
+            dateTime.date.day = reader.readU8();
+            dateTime.time.hour = reader.readU8();
+            dateTime.time.minute = reader.readU8();
+            dateTime.time.second = reader.readU8();
+            return dateTime;
+        }
+        default:
+            throw std::runtime_error("Unsupported type");
+    }
+}
+
+void RowCodec::encodeRows(ByteWriter &writer, const std::vector<std::shared_ptr<Column>> &columns,
+                          std::span<const Row> rows) {
+    for (const auto &column: columns) {
+        // Null bitmap, one bit per row
+        std::string nullBitmap((rows.size() + 7) / 8, '\0');
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (!rows[i].data.at(column).has_value()) {
+                nullBitmap[i / 8] = static_cast<char>(nullBitmap[i / 8] | (1 << (i % 8)));
+            }
+        }
+        writer.writeBytes(nullBitmap);
+
+        // Values of the non-null rows, packed one after another
+        for (const auto &row: rows) {
+            const auto &value = row.data.at(column);
+            if (value.has_value()) {
+                encodeValue(writer, column->getDataType(), value.data.value());
+            }
+        }
+    }
+}
+
+std::vector<Row> RowCodec::decodeRows(ByteReader &reader, const std::vector<std::shared_ptr<Column>> &columns,
+                                      size_t rowCount) {
+    std::vector<Row> rows(rowCount);
+    for (const auto &column: columns) {
+        auto nullBitmap = reader.readBytes((rowCount + 7) / 8);
+        for (size_t i = 0; i < rowCount; ++i) {
+            bool isNull = (static_cast<uint8_t>(nullBitmap[i / 8]) >> (i % 8)) & 1;
+            if (isNull) {
+                rows[i].data.emplace(column, BoxedValue(column->getDataType(), std::nullopt));
+            } else {
+                rows[i].data.emplace(column, BoxedValue(column->getDataType(),
+                                                        decodeValue(reader, column->getDataType())));
+            }
+        }
+    }
+    return rows;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "BinaryFormat.h"
+#include "Table.h"
+#include <memory>
+#include <span>
+#include <vector>
+
+// Binary encoding of rows shared by snapshots and table segment pages
+class RowCodec {
+public:
+    // Column-wise encoding of a run of rows: a null bitmap followed by the non-null values of each column
+    static void encodeRows(ByteWriter &writer, const std::vector<std::shared_ptr<Column>> &columns,
+                           std::span<const Row> rows);
+    static std::vector<Row> decodeRows(ByteReader &reader, const std::vector<std::shared_ptr<Column>> &columns,
+                                       size_t rowCount);
+
+    static void encodeValue(ByteWriter &writer, DataType type, const VariantType &value);
+    static VariantType decodeValue(ByteReader &reader, DataType type);
+};
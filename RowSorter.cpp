@@ -0,0 +1,157 @@
+#include "RowSorter.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+RowSorter::RowSorter(std::vector<Key> keysArg, DataType keyType, std::optional<size_t> limit)
+        : keys(std::move(keysArg)), limit(limit) {
+    radix = keys.size() == 1
+            && (keyType == DataType::INTEGER || keyType == DataType::DATE || keyType == DataType::DATETIME);
+}
+
+void RowSorter::add(std::vector<ValueRow> &chunk, ValueRow row) const {
+    if (!limit) {
+        chunk.push_back(std::move(row));
+        return;
+    }
+
+    // The chunk is a heap with the row that comes last on top
+    auto comparator = [this](const ValueRow &first, const ValueRow &second) { return before(first, second); };
+    if (chunk.size() < *limit) {
+        chunk.push_back(std::move(row));
+        std::ranges::push_heap(chunk, comparator);
+    } else if (*limit > 0 && before(row, chunk.front())) {
+        std::ranges::pop_heap(chunk, comparator);
+        chunk.back() = std::move(row);
+        std::ranges::push_heap(chunk, comparator);
+    }
+}
+
+std::vector<RowSorter::ValueRow> RowSorter::sort(std::vector<std::vector<ValueRow>> chunks,
+                                                 TaskScheduler &scheduler) const {
+    scheduler.parallelFor(0, chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            sortChunk(chunks[i]);
+        }
+    });
+    return merge(std::move(chunks));
+}
+
+bool RowSorter::before(const ValueRow &first, const ValueRow &second) const {
+    for (const auto &key: keys) {
+        auto order = first[key.value] <=> second[key.value];
+        if (order != 0) {
+            return key.descending ? order > 0 : order < 0;
+        }
+    }
+    return false;
+}
+
+void RowSorter::sortChunk(std::vector<ValueRow> &chunk) const {
+    auto comparator = [this](const ValueRow &first, const ValueRow &second) { return before(first, second); };
+    if (limit) {
+        std::ranges::sort_heap(chunk, comparator);
+    } else if (radix) {
+        radixSort(chunk);
+    } else {
+        std::ranges::stable_sort(chunk, comparator);
+    }
+}
+
+void RowSorter::radixSort(std::vector<ValueRow> &chunk) const {
+    // Codes are sorted together with the positions of their rows, the rows are moved once at the end
+    std::vector<std::pair<uint64_t, size_t>> codes(chunk.size());
+    for (size_t i = 0; i < chunk.size(); ++i) {
+        uint64_t code = radixCode(chunk[i][keys[0].value]);
+        codes[i] = {keys[0].descending ? ~code : code, i};
+    }
+
+    std::vector<std::pair<uint64_t, size_t>> buffer(codes.size());
+    for (size_t shift = 0; shift < 64; shift += 8) {
+        std::array<size_t, 256> counts{};
+        for (const auto &[code, position]: codes) {
+            ++counts[(code >> shift) & 0xff];
+        }
+        if (std::ranges::find(counts, codes.size()) != counts.end()) {
+            continue; // Every code has the same byte here, e.g. the high bytes of small numbers
+        }
+        size_t offset = 0;
+        for (auto &count: counts) {
+            offset += std::exchange(count, offset);
+        }
+        for (const auto &entry: codes) {
+            buffer[counts[(entry.first >> shift) & 0xff]++] = entry;
+        }
+        codes.swap(buffer);
+    }
+
+    std::vector<ValueRow> sorted;
+    sorted.reserve(chunk.size());
+    for (const auto &[code, position]: codes) {
+        sorted.push_back(std::move(chunk[position]));
+    }
+    chunk = std::move(sorted);
+}
+
+std::vector<RowSorter::ValueRow> RowSorter::merge(std::vector<std::vector<ValueRow>> chunks) const {
+    // Heap of the next row of every chunk, the chunk index breaks ties so that the merge is stable
+    std::vector<std::pair<size_t, size_t>> heads; // Chunk and row within it
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (!chunks[i].empty()) {
+            heads.emplace_back(i, 0);
+        }
+    }
+    auto after = [&](const std::pair<size_t, size_t> &first, const std::pair<size_t, size_t> &second) {
+        const auto &firstRow = chunks[first.first][first.second];
+        const auto &secondRow = chunks[second.first][second.second];
+        if (before(secondRow, firstRow)) {
+            return true;
+        }
+        return !before(firstRow, secondRow) && second.first < first.first;
+    };
+    std::ranges::make_heap(heads, after);
+
+    std::vector<ValueRow> merged;
+    size_t total = 0;
+    for (const auto &chunk: chunks) {
+        total += chunk.size();
+    }
+    size_t count = limit ? std::min(*limit, total) : total;
+    merged.reserve(count);
+    while (merged.size() < count) {
+        std::ranges::pop_heap(heads, after);
+        auto &[chunk, row] = heads.back();
+        merged.push_back(std::move(chunks[chunk][row]));
+        if (++row < chunks[chunk].size()) {
+            std::ranges::push_heap(heads, after);
+        } else {
+            heads.pop_back();
+        }
+    }
+    return merged;
+}
+
+uint64_t RowSorter::radixCode(const BoxedValue &value) {
+    if (!value.has_value()) {
+        return 0;
+    }
+    // Signed fields are shifted by 2^31 so that they order as unsigned numbers
+    constexpr int64_t BIAS = int64_t{1} << 31;
+    auto dateCode = [&](const Date &date) {
+        return static_cast<uint64_t>(date.year + BIAS) << 9 | static_cast<uint64_t>(date.month) << 5
+               | static_cast<uint64_t>(date.day);
+    };
+    switch (value.type) {
+        case DataType::INTEGER:
+            return static_cast<uint64_t>(std::get<int>(*value.data) + BIAS) + 1;
+        case DataType::DATE:
+            return dateCode(std::get<Date>(*value.data)) + 1;
+        default: {
+            const auto &dateTime = std::get<DateTime>(*value.data);
+            return (dateCode(dateTime.date) << 17 | static_cast<uint64_t>(dateTime.time.hour) << 12
+                    | static_cast<uint64_t>(dateTime.time.minute) << 6 | static_cast<uint64_t>(dateTime.time.second))
+                   + 1;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Table.h"
+#include "TaskScheduler.h"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Orders result rows of typed values for ORDER BY. Rows arrive in chunks, one per task or segment; with a limit each
+// chunk is kept as a bounded heap of its first rows while it fills, so a top-N query holds only N rows per chunk.
+// Chunks are sorted in parallel and then merged. A single INTEGER, DATE or DATETIME key is radix sorted.
+class RowSorter {
+public:
+    using ValueRow = std::vector<BoxedValue>;
+
+    struct Key {
+        size_t value; // Position of the key in the row
+        bool descending;
+    };
+
+    // keyType is the type of the first key. NULLs sort before every value, and after them when descending.
+    RowSorter(std::vector<Key> keys, DataType keyType, std::optional<size_t> limit);
+
+    virtual void add(std::vector<ValueRow> &chunk, ValueRow row) const; // Drops rows that cannot be among the first
+    // Sorts the chunks on the scheduler, then merges them and returns no more rows than the limit.
+    // Without a limit rows with equal keys keep their order, chunk by chunk.
+    [[nodiscard]] virtual std::vector<ValueRow> sort(std::vector<std::vector<ValueRow>> chunks,
+                                                     TaskScheduler &scheduler) const;
+
+private:
+    std::vector<Key> keys;
+    bool radix; // The only key has a type radixCode encodes
+    std::optional<size_t> limit;
+
+    [[nodiscard]] virtual bool before(const ValueRow &first, const ValueRow &second) const;
+    virtual void sortChunk(std::vector<ValueRow> &chunk) const;
+    virtual void radixSort(std::vector<ValueRow> &chunk) const; // Stable, a byte of the code per pass
+    [[nodiscard]] virtual std::vector<ValueRow> merge(std::vector<std::vector<ValueRow>> chunks) const;
+    // Unsigned code in the order of the values, NULL is 0
+    [[nodiscard]] static uint64_t radixCode(const BoxedValue &value);
+};
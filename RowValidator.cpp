@@ -1,10 +1,19 @@
 #include "RowValidator.h"
 
+#include "HashIndex.h"
 #include <algorithm>
 
 
 
-void RowValidator::validateDataInsertion(const Table& table, const Row& row) {
+static bool isPending(const PendingKeys *pending, const std::shared_ptr<Column>& column, const BoxedValue& value) {
+    if (!pending) {
+        return false;
+    }
+    auto it = pending->find(column);
+    return it != pending->end() && it->second.contains(value);
+}
+
+void RowValidator::validateDataInsertion(const Table& table, const Row& row, const PendingKeys *pending) {
     // Check column constraints
     for (const auto& column : table.getColumns()) {
         const auto& value = row.data.at(column);
@@ -18,10 +27,18 @@ void RowValidator::validateDataInsertion(const Table& table, const Row& row) {
 
         if (std::ranges::find(constraints, ColumnConstraint::UNIQUE) != constraints.end()
             || std::ranges::find(constraints, ColumnConstraint::PRIMARY_KEY) != constraints.end()) {
-            for (const auto& existingRow : table.getRows()) {
-                if (value.has_value() && existingRow.data.at(column) == value) {
-                    throw std::runtime_error("Value " + value.toString() + " already exists for column " + column->getName());
-                }
+            auto index = table.getIndex(column);
+            bool exists = false;
+            if (index) {
+                exists = index->contains(value);
+            } else {
+                table.scanRows([&](const Row& existingRow) {
+                    exists = value.has_value() && existingRow.data.at(column) == value;
+                    return !exists;
+                });
+            }
+            if (exists || (value.has_value() && isPending(pending, column, value))) {
+                throw std::runtime_error("Value " + value.toString() + " already exists for column " + column->getName());
             }
         }
     }
@@ -33,16 +50,27 @@ void RowValidator::validateDataInsertion(const Table& table, const Row& row) {
         const auto& value = row.data.at(foreignKeyColumn);
         if (value.has_value()) {
             bool found = false;
-            for (const auto& existingRow : referencedTable->getRows()) {
-                if (existingRow.data.at(referencedColumn) == value) {
-                    found = true;
-                    break;
-                }
+            if (auto index = referencedTable->getIndex(referencedColumn)) {
+                found = index->find(value).has_value(); // A claimed key may still be given back
+            } else {
+                referencedTable->scanRows([&](const Row& existingRow) {
+                    found = existingRow.data.at(referencedColumn) == value;
+                    return !found;
+                });
             }
-            if (!found) {
+            if (!found && !isPending(pending, referencedColumn, value)) {
                 throw std::runtime_error("Value " + value.toString() + " does not exist in referenced table " +
                 referencedTable->getName());
             }
         }
     }
+}
+
+void RowValidator::addPendingKeys(const Table& table, const Row& row, PendingKeys &pending) {
+    for (const auto& column : table.getColumns()) {
+        const auto& value = row.data.at(column);
+        if (value.has_value() && table.getIndex(column)) {
+            pending[column].insert(value);
+        }
+    }
 }
\ No newline at end of file
@@ -1,10 +1,17 @@
 #pragma once
 
 #include "Table.h"
+#include <map>
 #include <optional>
+#include <unordered_set>
 
+// Key values of rows validated but not added to their tables yet, e.g. earlier rows of the same transaction.
+// Column pointers are unique across tables, so the columns alone tell the tables apart.
+using PendingKeys = std::map<std::shared_ptr<Column>, std::unordered_set<BoxedValue, BoxedValueHash>>;
 
 class RowValidator {
 public:
-    static void validateDataInsertion(const Table& table, const Row& row);
+    // Pending keys count as rows of their tables, both for uniqueness and for foreign keys
+    static void validateDataInsertion(const Table& table, const Row& row, const PendingKeys *pending = nullptr);
+    static void addPendingKeys(const Table& table, const Row& row, PendingKeys &pending); // Keys of the indexed columns
 };
\ No newline at end of file
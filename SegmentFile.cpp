@@ -0,0 +1,98 @@
+#include "SegmentFile.h"
+
+#include "BinaryFormat.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+static constexpr std::string_view PAGE_MAGIC = "FQLPAGE1";
+static constexpr size_t PAGE_ALIGNMENT = 4096;
+
+// SEGMENT PAGE
+SegmentPage::SegmentPage(std::shared_ptr<const MappedFile> window, std::string_view contents)
+        : window(std::move(window)), contents(contents) {}
+
+std::string_view SegmentPage::view() const {
+    return contents;
+}
+
+// SEGMENT FILE
+SegmentFile::SegmentFile(const std::string &directory) {
+    fd = ::open(directory.c_str(), O_TMPFILE | O_RDWR, 0600);
+    if (fd < 0) {
+        // Not every file system supports O_TMPFILE, fall back to a named file removed at once
+        std::string path = directory + "/franekql-segments-XXXXXX";
+        std::vector<char> pathBuffer(path.begin(), path.end());
+        pathBuffer.push_back('\0');
+        fd = ::mkstemp(pathBuffer.data());
+        if (fd < 0) {
+            throw std::runtime_error("Cannot create a segment file in " + directory);
+        }
+        ::unlink(pathBuffer.data());
+    }
+}
+
+SegmentFile::~SegmentFile() {
+    ::close(fd);
+}
+
+PageLocation SegmentFile::writePage(uint32_t rowCount, std::string_view payload) {
+    ByteWriter writer;
+    writer.writeBytes(PAGE_MAGIC);
+    writer.writeU32(rowCount);
+    writer.writeU32(Crc32::compute(payload));
+    writer.writeU64(payload.size());
+    writer.writeBytes(payload);
+    size_t padding = (PAGE_ALIGNMENT - writer.size() % PAGE_ALIGNMENT) % PAGE_ALIGNMENT;
+    writer.writeBytes(std::string(padding, '\0'));
+
+    const std::string &page = writer.data();
+    uint64_t windowEnd = (fileSize / WINDOW_SIZE + 1) * WINDOW_SIZE;
+    if (fileSize + page.size() > windowEnd && page.size() <= WINDOW_SIZE) {
+        fileSize = windowEnd; // The hole takes no disk space
+    }
+    BinaryFile::writeAt(fd, page, fileSize);
+
+    PageLocation location{fileSize, page.size()};
+    fileSize += page.size();
+    return location;
+}
+
+std::shared_ptr<SegmentPage> SegmentFile::mapPage(const PageLocation &location) {
+    if (location.length > WINDOW_SIZE) {
+        auto mapping = std::make_shared<const MappedFile>(fd, location.offset, location.length);
+        ++largePageMappings;
+        return std::make_shared<SegmentPage>(mapping, mapping->view());
+    }
+    size_t windowIndex = location.offset / WINDOW_SIZE;
+    if (windowIndex >= windows.size()) {
+        windows.resize(windowIndex + 1);
+    }
+    auto &window = windows[windowIndex];
+    if (!window) {
+        // Past the end of the file for now, only pages written before they are mapped are read
+        window = std::make_shared<const MappedFile>(fd, windowIndex * WINDOW_SIZE, WINDOW_SIZE);
+    }
+    return std::make_shared<SegmentPage>(window, window->view().substr(location.offset % WINDOW_SIZE,
+                                                                      location.length));
+}
+
+size_t SegmentFile::getMappingCount() const {
+    return largePageMappings + std::ranges::count_if(windows, [](const auto &window) { return window != nullptr; });
+}
+
+std::string_view SegmentFile::pagePayload(std::string_view page, uint32_t &rowCount) {
+    ByteReader reader(page);
+    if (reader.readBytes(PAGE_MAGIC.size()) != PAGE_MAGIC) {
+        throw std::runtime_error("Corrupted table segment page");
+    }
+    rowCount = reader.readU32();
+    uint32_t checksum = reader.readU32();
+    auto payload = reader.readBytes(reader.readU64());
+    if (Crc32::compute(payload) != checksum) {
+        throw std::runtime_error("Corrupted table segment page");
+    }
+    return payload;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Place of a page in a segment file
+struct PageLocation {
+    uint64_t offset = 0;
+    size_t length = 0; // Including the header and the padding
+};
+
+// Where a checkpoint stored a segment
+struct CheckpointBlock {
+    uint64_t storeId = 0; // Chain of checkpoints the block belongs to
+    uint32_t fileId = 0; // Data file next to the manifest
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    uint32_t checksum = 0;
+};
+
+// Written page of a segment file, a slice of the window mapped around it. The page keeps the window mapped.
+class SegmentPage {
+    std::shared_ptr<const MappedFile> window;
+    std::string_view contents;
+public:
+    SegmentPage(std::shared_ptr<const MappedFile> window, std::string_view contents);
+
+    [[nodiscard]] virtual std::string_view view() const;
+};
+
+// Anonymous file holding the sealed segments of one table as pages.
+// A page is a header (magic, row count, checksum, payload length) followed by the encoded rows,
+// padded to a multiple of the memory page size.
+// The file is mapped in windows of WINDOW_SIZE bytes, each shared by the pages inside it, so a large table takes
+// a few mappings instead of one per segment and stays far below the limit of mappings of a process.
+// A page never crosses a window boundary; one larger than a window gets a mapping of its own.
+// The file is unlinked right after it is created, the kernel drops it once the last mapping is gone.
+class SegmentFile {
+    int fd = -1;
+    uint64_t fileSize = 0; // Where the next page is written
+    std::vector<std::shared_ptr<const MappedFile>> windows; // Mapped on first use, window i starts at i * WINDOW_SIZE
+    size_t largePageMappings = 0; // Pages larger than a window, mapped on their own
+public:
+    static constexpr uint64_t WINDOW_SIZE = uint64_t(1) << 30;
+
+    explicit SegmentFile(const std::string &directory); // Throws if no file can be created in the directory
+    SegmentFile(const SegmentFile &) = delete;
+    SegmentFile &operator=(const SegmentFile &) = delete;
+    virtual ~SegmentFile(); // Pages mapped already stay valid
+
+    // Appends a page, after a hole up to the next window when it does not fit in the rest of the current one
+    virtual PageLocation writePage(uint32_t rowCount, std::string_view payload);
+    // Maps the window of a written page if it is not mapped yet, the caller serialises calls with writePage
+    [[nodiscard]] virtual std::shared_ptr<SegmentPage> mapPage(const PageLocation &location);
+    [[nodiscard]] virtual size_t getMappingCount() const; // Windows and large pages mapped so far
+
+    // Checks the header of a mapped page and returns the encoded rows
+    static std::string_view pagePayload(std::string_view page, uint32_t &rowCount);
+};
@@ -0,0 +1,450 @@
+#include "Snapshot.h"
+
+#include "BufferPool.h"
+#include "MappedFile.h"
+#include "RowCodec.h"
+#include "TableSegment.h"
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+static constexpr std::string_view SNAPSHOT_MAGIC = "FQLSNAP1";
+static constexpr uint32_t MANIFEST_VERSION = 5; // Version 5 is a manifest, the rows are in data files next to it
+static constexpr uint32_t SEGMENTED_VERSION = 4; // Still readable, data of each table segment by segment
+static constexpr uint32_t SINGLE_BLOCK_VERSION = 3; // Still readable, one sized block of data per table
+static constexpr uint32_t UNSIZED_DATA_VERSION = 2; // Still readable, its tables are decoded one by one
+static constexpr uint32_t NO_PRIMARY_KEY = UINT32_MAX;
+static constexpr uint64_t MIN_REWRITE_BYTES = 1 << 20; // Data files smaller than this are never rewritten
+
+// Contents of a snapshot file before any table is built
+struct StoredColumn {
+    std::string name;
+    DataType type;
+    std::vector<ColumnConstraint> constraints;
+};
+
+struct StoredForeignKey {
+    uint32_t column;
+    std::string referencedTable;
+    std::string referencedColumn;
+};
+
+struct StoredBlock {
+    uint64_t rowCount = 0;
+    std::optional<CheckpointBlock> location; // Block in a data file, for a manifest
+    std::string_view data; // Encoded rows inside the file itself, for the older versions
+};
+
+struct StoredTable {
+    std::string name;
+    std::vector<StoredColumn> columns;
+    uint32_t primaryKey = NO_PRIMARY_KEY;
+    std::vector<StoredForeignKey> foreignKeys;
+    uint64_t rowCount = 0;
+    std::vector<StoredBlock> blocks;
+};
+
+struct StoredSnapshot {
+    uint32_t version = 0;
+    uint64_t logSequence = 0;
+    uint64_t storeId = 0;
+    std::vector<StoredTable> tables;
+};
+
+static std::string dataFilename(const std::string &filename, uint32_t fileId) {
+    return filename + "." + std::to_string(fileId);
+}
+
+static std::vector<std::shared_ptr<Column>> makeColumns(const StoredTable &table) {
+    std::vector<std::shared_ptr<Column>> columns;
+    for (const auto &column: table.columns) {
+        columns.push_back(std::make_shared<Column>(column.name, column.type, column.constraints));
+    }
+    return columns;
+}
+
+static StoredSnapshot parse(std::string_view contents, const std::string &filename) {
+    ByteReader reader(contents);
+    if (reader.readBytes(SNAPSHOT_MAGIC.size()) != SNAPSHOT_MAGIC) {
+        throw std::runtime_error("File " + filename + " is not a FranekQL snapshot");
+    }
+
+    StoredSnapshot snapshot;
+    snapshot.version = reader.readU32();
+    if (snapshot.version < UNSIZED_DATA_VERSION || snapshot.version > MANIFEST_VERSION) {
+        throw std::runtime_error("Unsupported snapshot version in " + filename);
+    }
+    snapshot.logSequence = reader.readU64();
+    if (snapshot.version == MANIFEST_VERSION) {
+        snapshot.storeId = reader.readU64();
+    }
+
+    uint32_t tableCount = reader.readU32();
+    for (uint32_t t = 0; t < tableCount; ++t) {
+        StoredTable &table = snapshot.tables.emplace_back();
+        table.name = reader.readString();
+
+        uint32_t columnCount = reader.readU32();
+        for (uint32_t c = 0; c < columnCount; ++c) {
+            StoredColumn &column = table.columns.emplace_back();
+            column.name = reader.readString();
+            column.type = static_cast<DataType>(reader.readU8());
+            column.constraints.resize(reader.readU8());
+            for (auto &constraint: column.constraints) {
+                constraint = static_cast<ColumnConstraint>(reader.readU8());
+            }
+        }
+        table.primaryKey = reader.readU32();
+
+        uint32_t foreignKeyCount = reader.readU32();
+        for (uint32_t f = 0; f < foreignKeyCount; ++f) {
+            StoredForeignKey &foreignKey = table.foreignKeys.emplace_back();
+            foreignKey.column = reader.readU32();
+            foreignKey.referencedTable = reader.readString();
+            foreignKey.referencedColumn = reader.readString();
+        }
+
+        table.rowCount = reader.readU64();
+        if (snapshot.version == UNSIZED_DATA_VERSION) {
+            // The only way to find the end of the data is to decode it
+            size_t start = reader.getPosition();
+            RowCodec::decodeRows(reader, makeColumns(table), table.rowCount);
+            table.blocks.push_back({table.rowCount, std::nullopt,
+                                    contents.substr(start, reader.getPosition() - start)});
+        } else if (snapshot.version == SINGLE_BLOCK_VERSION) {
+            table.blocks.push_back({table.rowCount, std::nullopt, reader.readBytes(reader.readU64())});
+        } else {
+            uint32_t blockCount = reader.readU32();
+            for (uint32_t b = 0; b < blockCount; ++b) {
+                StoredBlock &block = table.blocks.emplace_back();
+                if (snapshot.version == MANIFEST_VERSION) {
+                    CheckpointBlock location;
+                    location.storeId = snapshot.storeId;
+                    location.fileId = reader.readU32();
+                    location.offset = reader.readU64();
+                    location.length = reader.readU64();
+                    location.checksum = reader.readU32();
+                    block.location = location;
+                    block.rowCount = reader.readU64();
+                } else {
+                    block.rowCount = reader.readU64();
+                    block.data = reader.readBytes(reader.readU64());
+                }
+            }
+        }
+    }
+    return snapshot;
+}
+
+CheckpointStats Snapshot::write(const Database &database, const std::string &filename, uint64_t logSequence) {
+    CheckpointStats stats;
+
+    // Segments stay clean only if the current manifest still points at their blocks
+    StoredSnapshot previous;
+    if (std::filesystem::exists(filename)) {
+        MappedFile file(filename);
+        previous = parse(file.view(), filename);
+        // Data of an older, single-file snapshot is not reused, it goes to the first data file
+        if (previous.version != MANIFEST_VERSION) {
+            previous = StoredSnapshot();
+        }
+    }
+    uint64_t storeId = previous.storeId;
+    if (storeId == 0) {
+        std::random_device random;
+        storeId = (static_cast<uint64_t>(random()) << 32) | random() | 1;
+    }
+
+    std::set<std::pair<uint32_t, uint64_t>> previousBlocks; // File and offset
+    std::set<uint32_t> previousFiles;
+    for (const auto &table: previous.tables) {
+        for (const auto &block: table.blocks) {
+            previousBlocks.emplace(block.location->fileId, block.location->offset);
+            previousFiles.insert(block.location->fileId);
+        }
+    }
+    uint32_t currentFileId = previousFiles.empty() ? 0 : *previousFiles.rbegin();
+
+    auto isClean = [&](const TableSegment &segment) {
+        const auto &block = segment.getCheckpointBlock();
+        return block && block->storeId == storeId && previousBlocks.contains({block->fileId, block->offset});
+    };
+
+    // More than half of the data files is dead: copy the live blocks into a fresh file and drop the old ones
+    uint64_t existingBytes = 0;
+    for (uint32_t fileId: previousFiles) {
+        existingBytes += std::filesystem::file_size(dataFilename(filename, fileId));
+    }
+    uint64_t reusedBytes = 0;
+    for (const auto &[name, table]: database.getTables()) {
+        for (const auto &segment: table->getSegments()) {
+            if (isClean(*segment)) {
+                reusedBytes += segment->getCheckpointBlock()->length;
+            }
+        }
+    }
+    stats.rewritten = currentFileId != 0 && existingBytes > MIN_REWRITE_BYTES && existingBytes > 2 * reusedBytes;
+    uint32_t targetFileId = currentFileId == 0 || stats.rewritten ? currentFileId + 1 : currentFileId;
+    std::string targetFilename = dataFilename(filename, targetFileId);
+
+    int fd = ::open(targetFilename.c_str(), O_WRONLY | O_CREAT | (targetFileId != currentFileId ? O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open checkpoint data file " + targetFilename);
+    }
+    uint64_t baseOffset = static_cast<uint64_t>(::lseek(fd, 0, SEEK_END));
+
+    // Blocks to append are encoded one after another and handed to the disk in chunks, while the next
+    // chunk is encoded the previous ones are still being written
+    const auto &io = database.getStorage() ? database.getStorage()->getIo() : nullptr;
+    ByteWriter data;
+    uint64_t flushed = 0; // Bytes handed over before data
+    std::deque<std::string> buffers; // Chunks in flight, a deque never moves them
+    std::deque<std::future<void>> writes;
+    auto flush = [&] {
+        if (data.size() == 0) {
+            return;
+        }
+        uint64_t offset = baseOffset + flushed;
+        flushed += data.size();
+        buffers.push_back(data.release());
+        if (!io) {
+            BinaryFile::writeAt(fd, buffers.back(), offset);
+            buffers.pop_back();
+            return;
+        }
+        if (writes.size() >= AsyncIo::MAX_IN_FLIGHT) {
+            writes.front().get();
+            writes.pop_front();
+            buffers.pop_front();
+        }
+        writes.push_back(io->submitWrite(fd, buffers.back(), offset));
+    };
+    std::map<uint32_t, std::unique_ptr<MappedFile>> oldFiles; // Sources of the copied blocks
+    std::map<const TableSegment *, CheckpointBlock> locations;
+
+    ByteWriter manifest;
+    manifest.writeBytes(SNAPSHOT_MAGIC);
+    manifest.writeU32(MANIFEST_VERSION);
+    manifest.writeU64(logSequence);
+    manifest.writeU64(storeId);
+    manifest.writeU32(static_cast<uint32_t>(database.getTables().size()));
+
+    try {
+        for (const auto &[name, table]: database.getTables()) {
+            const auto &columns = table->getColumns();
+            auto columnIndex = [&](const std::shared_ptr<Column> &column) {
+                return static_cast<uint32_t>(std::ranges::find(columns, column) - columns.begin());
+            };
+
+            // Schema
+            manifest.writeString(name);
+            manifest.writeU32(static_cast<uint32_t>(columns.size()));
+            for (const auto &column: columns) {
+                manifest.writeString(column->getName());
+                manifest.writeU8(static_cast<uint8_t>(column->getDataType()));
+                auto constraints = column->getConstraints();
+                manifest.writeU8(static_cast<uint8_t>(constraints.size()));
+                for (const auto &constraint: constraints) {
+                    manifest.writeU8(static_cast<uint8_t>(constraint));
+                }
+            }
+            const auto &primaryKey = table->getPrimaryKey();
+            manifest.writeU32(primaryKey ? columnIndex(primaryKey->getKeyColumn()) : NO_PRIMARY_KEY);
+
+            // Foreign keys are stored by name and resolved once every table is loaded
+            manifest.writeU32(static_cast<uint32_t>(table->getForeignKeys().size()));
+            for (const auto &foreignKey: table->getForeignKeys()) {
+                manifest.writeU32(columnIndex(foreignKey.getKeyColumn()));
+                manifest.writeString(foreignKey.getReferencedTable()->getName());
+                manifest.writeString(foreignKey.getReferencePrimaryKey()->getKeyColumn()->getName());
+            }
+
+            // One block per segment, only the dirty ones are encoded and written
+            const auto &segments = table->getSegments();
+            ScanRing ring;
+            manifest.writeU64(table->getRowCount());
+            manifest.writeU32(static_cast<uint32_t>(segments.size()));
+            for (size_t s = 0; s < segments.size(); ++s) {
+                const auto &segment = *segments[s];
+                CheckpointBlock location;
+                if (isClean(segment) && !stats.rewritten) {
+                    location = *segment.getCheckpointBlock();
+                    ++stats.segmentsReused;
+                } else {
+                    size_t start = data.size();
+                    if (isClean(segment)) {
+                        // Copied as it is into the fresh file
+                        auto old = *segment.getCheckpointBlock();
+                        auto &oldFile = oldFiles[old.fileId];
+                        if (!oldFile) {
+                            oldFile = std::make_unique<MappedFile>(dataFilename(filename, old.fileId));
+                        }
+                        data.writeBytes(oldFile->view().substr(old.offset, old.length));
+                        ++stats.segmentsReused;
+                    } else if (auto payload = segment.getPagePayload(columns)) {
+                        // A spilled segment already holds the encoded rows
+                        data.writeBytes(*payload);
+                        ++stats.segmentsWritten;
+                    } else {
+                        RowCodec::encodeRows(data, columns, *table->readSegment(s, &ring));
+                        ++stats.segmentsWritten;
+                    }
+                    std::string_view encoded = std::string_view(data.data()).substr(start);
+                    location = {storeId, targetFileId, baseOffset + flushed + start, encoded.size(),
+                                Crc32::compute(encoded)};
+                    if (data.size() >= AsyncIo::CHUNK_SIZE) {
+                        flush();
+                    }
+                }
+                manifest.writeU32(location.fileId);
+                manifest.writeU64(location.offset);
+                manifest.writeU64(location.length);
+                manifest.writeU32(location.checksum);
+                manifest.writeU64(segment.size());
+                locations[&segment] = location;
+            }
+        }
+
+        flush();
+        for (auto &write: writes) {
+            write.get();
+        }
+        if (io) {
+            io->sync(fd);
+        } else if (::fdatasync(fd) != 0) {
+            throw std::runtime_error("Cannot sync checkpoint data file " + targetFilename);
+        }
+    } catch (...) {
+        // Writes still in flight use the buffers and the descriptor
+        for (auto &write: writes) {
+            if (write.valid()) {
+                write.wait();
+            }
+        }
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    stats.bytesWritten = flushed;
+
+    // The manifest is the commit point, the data it points at is already durable
+    BinaryFile::writeAtomically(filename, manifest.data());
+
+    for (const auto &[name, table]: database.getTables()) {
+        for (const auto &segment: table->getSegments()) {
+            segment->setCheckpointBlock(locations.at(segment.get()));
+        }
+    }
+
+    // Data files no longer referenced, including ones left behind by a crash
+    auto path = std::filesystem::absolute(filename);
+    std::string prefix = path.filename().string() + ".";
+    for (const auto &entry: std::filesystem::directory_iterator(path.parent_path())) {
+        std::string entryName = entry.path().filename().string();
+        std::string suffix = entryName.substr(std::min(prefix.size(), entryName.size()));
+        bool isDataFile = !suffix.empty() && std::ranges::all_of(suffix, [](char c) { return c >= '0' && c <= '9'; });
+        if (entryName.starts_with(prefix) && isDataFile && suffix != std::to_string(targetFileId)) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+    return stats;
+}
+
+uint64_t Snapshot::load(const std::string &filename, Database &database) {
+    MappedFile file(filename);
+    StoredSnapshot stored = parse(file.view(), filename);
+
+    // Every data file of a manifest is mapped once, blocks are views into the mappings
+    std::map<uint32_t, std::unique_ptr<MappedFile>> dataFiles;
+    for (auto &table: stored.tables) {
+        for (auto &block: table.blocks) {
+            if (!block.location) {
+                continue;
+            }
+            auto &dataFile = dataFiles[block.location->fileId];
+            if (!dataFile) {
+                dataFile = std::make_unique<MappedFile>(dataFilename(filename, block.location->fileId));
+            }
+            if (block.location->offset + block.location->length > dataFile->view().size()) {
+                throw std::runtime_error("Checkpoint data file of " + filename + " is truncated");
+            }
+            block.data = dataFile->view().substr(block.location->offset, block.location->length);
+        }
+    }
+
+    struct PendingForeignKey {
+        std::shared_ptr<Table> table;
+        std::shared_ptr<Column> column;
+        std::string referencedTableName;
+        std::string referencedColumnName;
+    };
+    std::vector<PendingForeignKey> pendingForeignKeys;
+    std::vector<std::shared_ptr<Table>> loadedTables;
+
+    for (auto &storedTable: stored.tables) {
+        auto table = std::make_shared<Table>(storedTable.name, database.getStorage());
+        for (const auto &column: makeColumns(storedTable)) {
+            table->addColumn(column);
+        }
+        const auto &columns = table->getColumns();
+
+        if (storedTable.primaryKey != NO_PRIMARY_KEY) {
+            table->setPrimaryKey(PrimaryKey(columns.at(storedTable.primaryKey)));
+        }
+        for (const auto &foreignKey: storedTable.foreignKeys) {
+            pendingForeignKeys.push_back({table, columns.at(foreignKey.column), foreignKey.referencedTable,
+                                          foreignKey.referencedColumn});
+        }
+        loadedTables.push_back(table);
+    }
+
+    // Stored rows passed every constraint when they were inserted, no need to validate them again.
+    // Tables do not share any state until foreign keys are wired below, so each one loads as a task of its own.
+    database.getScheduler()->parallelFor(0, loadedTables.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto &table = loadedTables[i];
+            for (const auto &block: stored.tables[i].blocks) {
+                if (block.location && Crc32::compute(block.data) != block.location->checksum) {
+                    throw std::runtime_error("Corrupted checkpoint block of table " + table->getName());
+                }
+                ByteReader dataReader(block.data);
+                table->loadRows(RowCodec::decodeRows(dataReader, table->getColumns(), block.rowCount),
+                                block.location);
+            }
+            table->rebuildIndexes();
+        }
+    });
+
+    for (const auto &table: loadedTables) {
+        if (database.getTableDefinition(table->getName()).has_value()) {
+            throw std::runtime_error("Table with name " + table->getName() + " already exists");
+        }
+    }
+    for (const auto &table: loadedTables) {
+        database.addTable(table);
+    }
+
+    for (const auto &pending: pendingForeignKeys) {
+        auto referencedTable = database.getTableDefinition(pending.referencedTableName);
+        if (!referencedTable.has_value()) {
+            throw std::runtime_error("Referenced table " + pending.referencedTableName + " not found");
+        }
+        auto referencedColumn = referencedTable.value()->getColumn(pending.referencedColumnName);
+        if (!referencedColumn.has_value()) {
+            throw std::runtime_error("Referenced column " + pending.referencedColumnName + " not found in table " +
+                                     pending.referencedTableName);
+        }
+        ForeignKey foreignKey(pending.column, std::make_shared<PrimaryKey>(referencedColumn.value()));
+        pending.table->addForeignKey(foreignKey);
+        pending.table->addRelation(Relation(std::make_shared<ForeignKey>(foreignKey), referencedTable.value()));
+    }
+
+    return stored.logSequence;
+}
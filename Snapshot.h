@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Database.h"
+#include <string>
+#include <vector>
+
+// What a checkpoint wrote
+struct CheckpointStats {
+    size_t segmentsWritten = 0; // Dirty segments encoded and written
+    size_t segmentsReused = 0; // Clean segments kept from earlier checkpoints
+    uint64_t bytesWritten = 0;
+    bool rewritten = false; // Live blocks were copied into a fresh data file to drop the dead ones
+};
+
+// Binary image of the whole database. The snapshot file is a manifest with the schema and constraints of every
+// table and the list of its segment blocks; the column-wise encoded rows of the blocks are appended to data files
+// next to it ("<snapshot>.<n>"). A segment unchanged since the last checkpoint keeps its block, so a checkpoint
+// writes only the dirty segments and the manifest.
+// Loading it restores the database without parsing any SQL.
+class Snapshot {
+public:
+    // Atomically replaces the manifest, logSequence is the last write-ahead log record reflected in the database.
+    // Data files nothing points at afterwards are removed.
+    static CheckpointStats write(const Database &database, const std::string &filename, uint64_t logSequence);
+    // Adds the stored tables to the database and returns the log sequence stored with them.
+    // Rows of the tables are decoded and indexed in parallel on the scheduler of the database.
+    static uint64_t load(const std::string &filename, Database &database);
+};
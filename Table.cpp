@@ -1,14 +1,41 @@
 #include "Table.h"
+#include "Logger.h"
+#include "fmt/core.h"
 
 #include "TableValidator.h"
 #include "RowValidator.h"
+#include "HashIndex.h"
+#include "TableSegment.h"
+#include "TableStorage.h"
+#include "VersionClock.h"
 #include <algorithm>
 #include <cmath>
 #include <chrono>
 #include <iomanip>
 
 // TABLE
-Table::Table(std::string name) : name(std::move(name)) {} // Constructor
+Table::Table(std::string name, std::shared_ptr<TableStorage> storage)
+        : name(std::move(name)), storage(std::move(storage)) {} // Constructor
+
+Table::~Table() = default; // SegmentFile is complete here
+
+std::shared_ptr<Table> Table::freeze(uint64_t version) const {
+    auto frozen = std::make_shared<Table>(name, storage);
+    frozen->columns = columns;
+    frozen->primaryKey = primaryKey;
+    frozen->foreignKeys = foreignKeys;
+    frozen->relations = relations;
+    std::lock_guard lock(segmentsMutex);
+    for (const auto &segment: segments) {
+        auto frozenSegment = TableSegment::freeze(segment, version);
+        if (frozenSegment->size() == 0) {
+            break; // Rows are committed in order, nothing later is visible either
+        }
+        frozen->rowCount += frozenSegment->size();
+        frozen->segments.push_back(std::move(frozenSegment));
+    }
+    return frozen;
+}
 
 void Table::addColumn(std::shared_ptr<Column> column) {
     TableValidator::validateColumnAddition(*this, column); // Validate the column addition
@@ -20,13 +47,47 @@ void Table::addColumn(std::shared_ptr<Column> column) {
 
     column = columns.back(); // Get a reference to the newly added column
 
-    // Add a null value for the new column in each existing row
-    for (auto &row : rows) {
-        row.data[column] = BoxedValue(column->getDataType(), std::nullopt);
+    // Add a null value for the new column in each existing row, spilled segments add it when they are read.
+    // Checkpoints store rows with the current columns, so every segment has to be written again.
+    for (const auto &segment: segments) {
+        segment->markDirty();
+        if (auto *resident = segment->getResidentRows()) {
+            for (auto &row: *resident) {
+                row.data[column] = BoxedValue(column->getDataType(), std::nullopt);
+            }
+        }
+    }
+
+    // Every existing row holds NULL, which is never indexed
+    auto constraints = column->getConstraints();
+    if (std::ranges::find(constraints, ColumnConstraint::PRIMARY_KEY) != constraints.end()
+        || std::ranges::find(constraints, ColumnConstraint::UNIQUE) != constraints.end()) {
+        indexes[column] = std::make_shared<HashIndex>(column);
     }
 }
 
-void Table::addRow(const RowBuilder &builder) {
+void Table::addRow(const RowBuilder &builder, VersionClock &clock, const std::function<void()> &atCommit) {
+    Row newRow = buildRow(builder);
+    RowValidator::validateDataInsertion(*this, newRow); // Validate the row addition
+    claimKeys(newRow);
+
+    // Add the new row to the table, readers starting from now on see it
+    clock.commit([&](uint64_t version) {
+        // The log record goes first, a row is never visible without it
+        try {
+            if (atCommit) {
+                atCommit();
+            }
+        } catch (...) {
+            releaseKeys(newRow);
+            throw;
+        }
+        addValidatedRow(std::move(newRow), version);
+    });
+    sealFullSegments();
+}
+
+Row Table::buildRow(const RowBuilder &builder) const {
     auto rowData = builder.build();
     Row newRow;
 
@@ -42,9 +103,159 @@ void Table::addRow(const RowBuilder &builder) {
         }
     }
 
-    RowValidator::validateDataInsertion(*this, newRow); // Validate the row addition
+    return newRow;
+}
+
+void Table::claimKeys(const Row &row) {
+    for (auto it = indexes.begin(); it != indexes.end(); ++it) {
+        const auto &value = row.data.at(it->first);
+        if (!it->second->claim(value)) {
+            for (auto claimed = indexes.begin(); claimed != it; ++claimed) {
+                claimed->second->release(row.data.at(claimed->first));
+            }
+            throw std::runtime_error("Value " + value.toString() + " already exists for column " + it->first->getName());
+        }
+    }
+}
+
+void Table::releaseKeys(const Row &row) {
+    for (const auto &[column, index]: indexes) {
+        index->release(row.data.at(column));
+    }
+}
+
+void Table::addValidatedRow(Row row, uint64_t version) {
+    // The keys are copied first, the row moves into its segment
+    std::vector<std::pair<HashIndex *, BoxedValue>> keys;
+    for (const auto &[column, index]: indexes) {
+        keys.emplace_back(index.get(), row.data.at(column));
+    }
+    std::optional<BoxedValue> buildKey;
+    if (indexBuild) {
+        buildKey = row.data.at(indexBuild->column);
+    }
+    size_t position = 0;
+    try {
+        position = appendRow(std::move(row), version);
+    } catch (...) {
+        for (const auto &[index, value]: keys) {
+            index->release(value); // The row is gone, its claims with it
+        }
+        throw;
+    }
+    for (const auto &[index, value]: keys) {
+        index->insert(value, position);
+    }
+    if (buildKey && buildKey->has_value()) {
+        std::lock_guard lock(indexBuild->mutex);
+        indexBuild->changes.emplace_back(std::move(*buildKey), position);
+    }
+}
+
+std::shared_ptr<Table> Table::startIndexBuild(const std::shared_ptr<Column> &column) {
+    if (indexBuild) {
+        throw std::runtime_error("An index is already being built on table " + name);
+    }
+    if (indexes.contains(column)) {
+        throw std::runtime_error("Column " + column->getName() + " already has an index");
+    }
+    indexBuild = std::make_unique<IndexBuild>();
+    indexBuild->column = column;
+    return freeze(); // No insert is running, every appended row is committed
+}
+
+void Table::mergeIndexBuild(const std::shared_ptr<HashIndex> &index) {
+    for (const auto &[value, position]: indexBuild->changes) {
+        if (index->contains(value)) {
+            throw std::runtime_error("Value " + value.toString() + " already exists for column "
+                                     + indexBuild->column->getName());
+        }
+        index->insert(value, position); // Recorded in commit order, so the index learns whether they ascend
+    }
+    indexBuild->changes.clear();
+}
+
+void Table::finishIndexBuild(const std::shared_ptr<HashIndex> &index) {
+    auto build = std::move(indexBuild);
+    build->column->addConstraint(ColumnConstraint::UNIQUE);
+    indexes[build->column] = index;
+}
+
+void Table::abortIndexBuild() {
+    indexBuild.reset();
+}
+
+void Table::loadRows(std::vector<Row> newRows, const std::optional<CheckpointBlock> &block) {
+    bool wholeSegment = (segments.empty() || segments.back()->isFull())
+                        && !newRows.empty() && newRows.size() <= TableSegment::CAPACITY;
+    for (auto &row: newRows) {
+        appendRow(std::move(row));
+    }
+    if (block && wholeSegment) {
+        segments.back()->setCheckpointBlock(*block);
+    }
+    sealFullSegments();
+}
+
+size_t Table::appendRow(Row row, uint64_t rowVersion) {
+    std::lock_guard lock(segmentsMutex);
+    if (segments.empty() || segments.back()->isFull()) {
+        segments.push_back(std::make_shared<TableSegment>());
+    }
+    segments.back()->append(std::move(row), rowVersion);
+    if (storage && segments.back()->isFull()) {
+        fullSegments.push_back(segments.back());
+    }
+    return rowCount++;
+}
 
-    rows.emplace_back(std::move(newRow)); // Add the new row to the table
+void Table::sealFullSegments() {
+    std::vector<std::shared_ptr<TableSegment>> toSeal;
+    {
+        std::lock_guard lock(segmentsMutex);
+        if (fullSegments.size() < spillRetrySegments) {
+            return; // The last spill failed, wait for another segment
+        }
+        toSeal.swap(fullSegments);
+    }
+    for (size_t i = 0; i < toSeal.size(); ++i) {
+        const auto &segment = toSeal[i];
+        // Rows of a full segment do not change any more, so they are encoded and written without blocking appends
+        std::shared_ptr<SegmentPage> page;
+        try {
+            std::string payload = segment->encode(columns);
+            std::lock_guard fileLock(segmentFileMutex);
+            if (!segmentFile) {
+                segmentFile = storage->createFile();
+            }
+            page = segmentFile->mapPage(segmentFile->writePage(TableSegment::CAPACITY, payload));
+        } catch (const std::exception &e) {
+            // The rows are committed already, they stay in memory until a later seal manages to write them
+            std::lock_guard lock(segmentsMutex);
+            fullSegments.insert(fullSegments.begin(), toSeal.begin() + static_cast<std::ptrdiff_t>(i), toSeal.end());
+            spillRetrySegments = fullSegments.size() + 1;
+            Logger::error(fmt::format("Cannot spill a segment of table {}, {} full segments stay in memory: {}", name,
+                                      fullSegments.size(), e.what()));
+            return;
+        }
+        std::lock_guard lock(segmentsMutex);
+        segment->spill(std::move(page), columns, storage->getBufferPool());
+    }
+    std::lock_guard lock(segmentsMutex);
+    spillRetrySegments = 0;
+}
+
+void Table::rebuildIndexes() {
+    for (const auto &[column, index]: indexes) {
+        index->rebuild(*this);
+    }
+}
+
+void Table::collectVersions(uint64_t oldestReader) {
+    std::lock_guard lock(segmentsMutex);
+    for (const auto &segment: segments) {
+        segment->collectVersions(oldestReader);
+    }
 }
 
 
@@ -70,8 +281,33 @@ const std::vector<std::shared_ptr<Column>> &Table::getColumns() const {
     return columns; // Return the vector of columns
 }
 
-const std::vector<Row> &Table::getRows() const {
-    return rows; // Return the vector of rows
+size_t Table::getRowCount() const {
+    return rowCount;
+}
+
+size_t Table::getUnspilledSegmentCount() const {
+    std::lock_guard lock(segmentsMutex);
+    return fullSegments.size();
+}
+
+const std::vector<std::shared_ptr<TableSegment>> &Table::getSegments() const {
+    return segments;
+}
+
+PinnedRows Table::readSegment(size_t segmentIndex, ScanRing *ring) const {
+    return segments.at(segmentIndex)->read(columns, storage ? &storage->getBufferPool() : nullptr, ring);
+}
+
+void Table::scanRows(const std::function<bool(const Row &)> &visitor) const {
+    ScanRing ring;
+    for (size_t s = 0; s < segments.size(); ++s) {
+        auto segmentRows = readSegment(s, &ring);
+        for (const auto &row: *segmentRows) {
+            if (!visitor(row)) {
+                return;
+            }
+        }
+    }
 }
 
 const std::shared_ptr<PrimaryKey> &Table::getPrimaryKey() const {
@@ -88,6 +324,18 @@ std::optional<std::shared_ptr<Column>> Table::getColumn(const std::string &basic
     return *it;
 }
 
+std::shared_ptr<HashIndex> Table::getIndex(const std::shared_ptr<Column> &column) const {
+    auto it = indexes.find(column);
+    if (it == indexes.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+std::shared_mutex &Table::getMutex() const {
+    return mutex;
+}
+
 const std::vector<ForeignKey> &Table::getForeignKeys() const {
     return foreignKeys;
 }
@@ -113,10 +361,16 @@ void Table::dropColumn(const std::string &columnName) {
     // Remove the column from the columns vector
     columns.erase(it);
 
-    // Remove the column from each row
-    for (auto &row : rows) {
-        row.data.erase(column);
+    // Remove the column from each row, spilled segments leave it out when they are read
+    for (const auto &segment: segments) {
+        segment->markDirty();
+        if (auto *resident = segment->getResidentRows()) {
+            for (auto &row: *resident) {
+                row.data.erase(column);
+            }
+        }
     }
+    indexes.erase(column);
 
     // Remove all foreign keys that involve the column
     foreignKeys.erase(std::remove_if(foreignKeys.begin(), foreignKeys.end(), [&](const ForeignKey &foreignKey) {
@@ -256,6 +510,49 @@ bool BoxedValue::operator==(const BoxedValue &other) const {
     return data.value() == other.data.value();
 }
 
+size_t BoxedValueHash::operator()(const BoxedValue &value) const {
+    if (!value.data.has_value()) {
+        return 0;
+    }
+
+    auto combine = [](size_t seed, size_t hash) {
+        return seed ^ (hash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+    };
+    auto hashDate = [&](const Date &date) {
+        return combine(combine(std::hash<int>{}(date.year), std::hash<int>{}(date.month)), std::hash<int>{}(date.day));
+    };
+    auto hashTime = [&](const Time &time) {
+        return combine(combine(std::hash<int>{}(time.hour), std::hash<int>{}(time.minute)),
+                       std::hash<int>{}(time.second));
+    };
+
+    const auto &data = value.data.value();
+    switch (value.type) {
+        case DataType::INTEGER:
+            return std::hash<int>{}(std::get<int>(data));
+        case DataType::FLOAT:
+            return std::hash<float>{}(std::get<float>(data) + 0.0f); // -0.0 and 0.0 are equal
+        case DataType::BOOLEAN:
+            return std::hash<bool>{}(std::get<bool>(data));
+        case DataType::TEXT:
+            return std::hash<std::string>{}(std::get<std::string>(data));
+        case DataType::DOUBLE:
+            return std::hash<double>{}(std::get<double>(data) + 0.0);
+        case DataType::CHAR:
+            return std::hash<char>{}(std::get<char>(data));
+        case DataType::DATE:
+            return hashDate(std::get<Date>(data));
+        case DataType::TIME:
+            return hashTime(std::get<Time>(data));
+        case DataType::DATETIME: {
+            const auto &dateTime = std::get<DateTime>(data);
+            return combine(hashDate(dateTime.date), hashTime(dateTime.time));
+        }
+        default:
+            throw std::runtime_error("Unsupported type");
+    }
+}
+
 std::string BoxedValue::toString() const {
     if (!data.has_value()) {
         return "NULL";
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
@@ -9,11 +11,20 @@
 #include "PrimaryKey.h"
 #include "Relation.h"
 #include "RowBuilder.h"
+#include "SegmentFile.h"
+#include <functional>
 #include <optional>
+#include <shared_mutex>
 #include <variant>
 
 class RowBuilder; // Forward declaration
 class Relation; // Forward declaration
+class HashIndex; // Forward declaration
+class TableSegment; // Forward declaration
+class TableStorage; // Forward declaration
+class PinnedRows; // Forward declaration
+class ScanRing; // Forward declaration
+class VersionClock; // Forward declaration
 
 enum class TableConstraint {
     FOREIGN_KEY
@@ -40,6 +51,11 @@ struct BoxedValue {
     static BoxedValue fromString(const std::string &value, DataType type);
 };
 
+// Hash consistent with BoxedValue::operator==, used by hash indexes
+struct BoxedValueHash {
+    size_t operator()(const BoxedValue &value) const;
+};
+
 struct Row {
     explicit Row(std::map<std::shared_ptr<Column>, BoxedValue> map);
 
@@ -59,14 +75,71 @@ struct Row {
 class Table : public std::enable_shared_from_this<Table> {
     std::string name; // Name of the table
     std::vector<std::shared_ptr<Column>> columns; // List of pointers to columns in the table
-    std::vector<Row> rows; // Each row is a map with column pointers as keys
+    std::vector<std::shared_ptr<TableSegment>> segments; // Rows in insertion order, each a map with column pointers as keys
+    std::atomic<size_t> rowCount = 0;
+    std::shared_ptr<TableStorage> storage; // Where full segments are spilled, null keeps every row in memory
+    std::unique_ptr<SegmentFile> segmentFile; // Created with the first spilled segment
     std::shared_ptr<PrimaryKey> primaryKey; // New member variable
     std::vector<ForeignKey> foreignKeys; // New member variable
     std::vector<Relation> relations; // New member variable
+    std::map<std::shared_ptr<Column>, std::shared_ptr<HashIndex>> indexes; // One per PRIMARY_KEY or UNIQUE column
+    mutable std::shared_mutex mutex; // Taken by Database::lock, shared by inserts, exclusive for a frozen copy
+    mutable std::mutex segmentsMutex; // Guards segments and fullSegments, appends are short critical sections
+    std::vector<std::shared_ptr<TableSegment>> fullSegments; // Filled up but not written to the segment file yet
+    std::mutex segmentFileMutex; // Guards segmentFile, pages are encoded before it is taken
+    // While segments cannot be written, the number of full segments to wait for before sealFullSegments tries again.
+    // Guarded by segmentsMutex.
+    size_t spillRetrySegments = 0;
+
+    // Keys of rows committed while an index is built online, merged into it before it is switched on
+    struct IndexBuild {
+        std::shared_ptr<Column> column;
+        std::mutex mutex; // Guards changes, concurrent inserts record into them
+        std::vector<std::pair<BoxedValue, size_t>> changes; // Value and row position
+    };
+    std::unique_ptr<IndexBuild> indexBuild; // Set and reset only while the table is held exclusively
+
+    // Adds a row to the last segment and returns its position. A full segment waits for sealFullSegments.
+    virtual size_t appendRow(Row row, uint64_t rowVersion = 0);
 public:
-    explicit Table(std::string name); // Constructor
+    explicit Table(std::string name, std::shared_ptr<TableStorage> storage = nullptr); // Constructor
+    virtual ~Table();
+    // Read-only point-in-time copy of the schema and the rows, e.g. for a checkpoint on another thread.
+    // The segments are shared copy-on-write, so this does not copy any rows. The copy holds the rows committed
+    // up to the given version and may be taken while an insert runs.
+    [[nodiscard]] virtual std::shared_ptr<Table> freeze(uint64_t version = UINT64_MAX) const;
     virtual void addColumn(std::shared_ptr<Column> column); //  virtual function to add a column to the table
-    virtual void addRow(const RowBuilder &builder); //  virtual function to load data into the table
+    // Validates the row and claims its keys, then commits it with the next version of the clock.
+    // atCommit runs inside the commit before the row is added, e.g. to log the insert in the order of the versions.
+    // The claims are given back when atCommit or the append throws.
+    virtual void addRow(const RowBuilder &builder, VersionClock &clock, const std::function<void()> &atCommit = nullptr);
+    [[nodiscard]] virtual Row buildRow(const RowBuilder &builder) const; // Columns left out of the builder are NULL
+    // Claims the values of the indexed columns for the row, so no concurrent insert can add them too.
+    // Throws and claims nothing when a value is taken.
+    virtual void claimKeys(const Row &row);
+    virtual void releaseKeys(const Row &row); // Gives back the claims of a row that is not committed after all
+    // Appends a row validated and claimed by the caller and indexes it, under a commit of the given version.
+    // Gives back the claims of the row when the append throws.
+    virtual void addValidatedRow(Row row, uint64_t version);
+    // Writes the segments filled by appends to the segment file, outside of the commit that filled them.
+    // A segment that cannot be written is logged and kept in memory. The next try waits until another segment
+    // has filled up, so a failing file costs one error and one attempt per segment, not per insert.
+    virtual void sealFullSegments();
+    // Starts recording the column's keys of the rows committed from now on and returns a copy of the rows
+    // committed so far, to build the index from. The caller holds the table exclusively.
+    [[nodiscard]] virtual std::shared_ptr<Table> startIndexBuild(const std::shared_ptr<Column> &column);
+    // Adds the recorded keys to the index built from the copy, throws on a duplicate. The index is not used yet,
+    // so the caller can still log the statement or abort the build. The caller holds the table exclusively.
+    virtual void mergeIndexBuild(const std::shared_ptr<HashIndex> &index);
+    // Switches the merged index on and gives the column the UNIQUE constraint. The caller holds the table
+    // exclusively since mergeIndexBuild.
+    virtual void finishIndexBuild(const std::shared_ptr<HashIndex> &index);
+    virtual void abortIndexBuild(); // The caller holds the table exclusively
+    // Appends already validated rows, indexes are not updated. Rows of a whole segment read from a checkpoint
+    // pass its block, so the segment starts out clean.
+    virtual void loadRows(std::vector<Row> newRows, const std::optional<CheckpointBlock> &block = std::nullopt);
+    virtual void rebuildIndexes(); // Rebuilds every index from the rows, e.g. after loadRows
+    virtual void collectVersions(uint64_t oldestReader); // Drops row versions no reader needs any more
     virtual void dropColumn(const std::string &columnName); //  virtual function to drop a column from the table
 
     virtual void setPrimaryKey(const PrimaryKey &primaryKeyArg);
@@ -80,7 +153,18 @@ public:
 
     [[nodiscard]] virtual const std::vector<std::shared_ptr<Column>> &getColumns() const;
 
-    [[nodiscard]] virtual const std::vector<Row> &getRows() const;
+    [[nodiscard]] virtual size_t getRowCount() const;
+
+    [[nodiscard]] virtual const std::vector<std::shared_ptr<TableSegment>> &getSegments() const;
+
+    [[nodiscard]] virtual size_t getUnspilledSegmentCount() const; // Full segments not written to the segment file yet
+
+    // Rows of one segment with the current columns, row i of segment s is row s * TableSegment::CAPACITY + i.
+    // A sequential reader passes a ring, so it does not flush the buffer pool.
+    [[nodiscard]] virtual PinnedRows readSegment(size_t segmentIndex, ScanRing *ring = nullptr) const;
+
+    // Visits rows in insertion order until the visitor returns false
+    virtual void scanRows(const std::function<bool(const Row &)> &visitor) const;
 
     [[nodiscard]] virtual const std::shared_ptr<PrimaryKey> &getPrimaryKey() const;
 
@@ -89,5 +173,9 @@ public:
     [[nodiscard]] virtual const std::vector<Relation> &getRelations() const;
 
     [[nodiscard]] virtual std::optional<std::shared_ptr<Column>> getColumn(const std::string &basicString) const;
+
+    [[nodiscard]] virtual std::shared_ptr<HashIndex> getIndex(const std::shared_ptr<Column> &column) const;
+
+    [[nodiscard]] virtual std::shared_mutex &getMutex() const;
 };
 
@@ -0,0 +1,197 @@
+#include "TableSegment.h"
+
+#include "RowCodec.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+static std::atomic<uint64_t> nextPageId = 1;
+
+TableSegment::TableSegment() : rows(std::make_shared<std::vector<Row>>()) {
+    rows->reserve(CAPACITY);
+}
+
+std::shared_ptr<TableSegment> TableSegment::freeze(const std::shared_ptr<TableSegment> &segment, uint64_t version) {
+    auto frozen = std::make_shared<TableSegment>();
+    frozen->rows = segment->rows;
+    frozen->rowCount = segment->rowCount;
+    if (segment->versions) {
+        // Versions grow with the rows, the rows a reader sees are a prefix
+        auto end = segment->versions->begin() + static_cast<std::ptrdiff_t>(segment->rowCount);
+        frozen->rowCount = std::upper_bound(segment->versions->begin(), end, version) - segment->versions->begin();
+    }
+    frozen->pageId = segment->pageId;
+    frozen->pageBytes = segment->pageBytes;
+    frozen->pageColumns = segment->pageColumns;
+    frozen->page = segment->page;
+    if (frozen->isFull()) {
+        frozen->summaries = segment->summaries; // Appends changed them until the segment filled up
+    }
+    std::lock_guard lock(segment->checkpointMutex);
+    frozen->checkpointBlock = segment->checkpointBlock;
+    frozen->origin = segment;
+    frozen->originVersion = segment->version;
+    return frozen;
+}
+
+void TableSegment::append(Row row, uint64_t rowVersion) {
+    if (!rows || isFull()) {
+        throw std::runtime_error("Cannot append to a sealed table segment");
+    }
+    if (rowVersion != 0 && !versions) {
+        versions = std::make_shared<std::vector<uint64_t>>(rowCount, 0);
+        versions->reserve(CAPACITY);
+    }
+    if (!summaries) {
+        summaries = std::make_shared<std::map<std::shared_ptr<Column>, ColumnSummary>>();
+        for (const auto &[column, value]: row.data) {
+            summaries->try_emplace(column, ColumnSummary{{value.type, std::nullopt}, {value.type, std::nullopt}, {}});
+        }
+    }
+    for (const auto &[column, value]: row.data) {
+        auto summary = summaries->find(column);
+        if (!value.has_value() || summary == summaries->end()) {
+            continue;
+        }
+        auto &[min, max, distinct] = summary->second;
+        if (!min.has_value() || value < min) {
+            min = value;
+        }
+        if (!max.has_value() || max < value) {
+            max = value;
+        }
+        distinct.add(value);
+    }
+    // Room for CAPACITY rows is reserved, so frozen copies keep reading their rows while this one is added
+    rows->push_back(std::move(row));
+    if (versions) {
+        versions->push_back(rowVersion);
+    }
+    ++rowCount;
+    markDirty();
+}
+
+void TableSegment::collectVersions(uint64_t oldestReader) {
+    if (versions && isFull() && versions->back() <= oldestReader) {
+        versions.reset();
+    }
+}
+
+void TableSegment::unshareRows() {
+    // A frozen copy that is done drops its reference, at worst this copies once too often
+    if (rows && rows.use_count() > 1) {
+        auto copy = std::make_shared<std::vector<Row>>();
+        copy->reserve(CAPACITY);
+        copy->assign(rows->begin(), rows->end());
+        rows = std::move(copy);
+    }
+}
+
+std::string TableSegment::encode(const std::vector<std::shared_ptr<Column>> &columns) const {
+    ByteWriter writer;
+    RowCodec::encodeRows(writer, columns, *rows);
+    return writer.release();
+}
+
+void TableSegment::spill(std::shared_ptr<SegmentPage> writtenPage, const std::vector<std::shared_ptr<Column>> &columns,
+                         BufferPool &pool) {
+    page = std::move(writtenPage);
+    pageColumns = columns;
+    pageId = nextPageId++;
+    pageBytes = BufferPool::estimateBytes(*rows);
+    // Freshly written rows are likely to be read soon, keep them while the pool has room
+    pool.put(pageId, std::move(rows), columns);
+    rows.reset();
+}
+
+PinnedRows TableSegment::read(const std::vector<std::shared_ptr<Column>> &columns, BufferPool *pool,
+                              ScanRing *ring) const {
+    if (rows) {
+        return {rows, rowCount};
+    }
+    // A page always holds the whole segment, a reader may see fewer of its rows
+    auto pinned = pool ? pool->pin(pageId, columns, [&] { return decode(columns); }, pageBytes, ring)
+                       : PinnedRows(decode(columns));
+    pinned.truncate(rowCount);
+    return pinned;
+}
+
+std::shared_ptr<std::vector<Row>> TableSegment::decode(const std::vector<std::shared_ptr<Column>> &columns) const {
+    uint32_t pageRowCount = 0;
+    ByteReader reader(SegmentFile::pagePayload(page->view(), pageRowCount));
+    auto decoded = std::make_shared<std::vector<Row>>(RowCodec::decodeRows(reader, pageColumns, pageRowCount));
+
+    if (pageColumns != columns) {
+        // The schema changed after the page was written
+        for (auto &row: *decoded) {
+            std::erase_if(row.data, [&](const auto &entry) {
+                return std::ranges::find(columns, entry.first) == columns.end();
+            });
+            for (const auto &column: columns) {
+                row.data.try_emplace(column, column->getDataType(), std::nullopt);
+            }
+        }
+    }
+    return decoded;
+}
+
+std::vector<Row> *TableSegment::getResidentRows() {
+    unshareRows();
+    return rows.get();
+}
+
+std::optional<std::string_view> TableSegment::getPagePayload(const std::vector<std::shared_ptr<Column>> &columns) const {
+    if (!page || pageColumns != columns) {
+        return std::nullopt;
+    }
+    uint32_t pageRowCount = 0;
+    auto payload = SegmentFile::pagePayload(page->view(), pageRowCount);
+    if (pageRowCount != rowCount) {
+        return std::nullopt; // A reader's copy without the newest rows of the page
+    }
+    return payload;
+}
+
+void TableSegment::markDirty() {
+    std::lock_guard lock(checkpointMutex);
+    ++version;
+    checkpointBlock.reset();
+}
+
+void TableSegment::setCheckpointBlock(const CheckpointBlock &block) {
+    {
+        std::lock_guard lock(checkpointMutex);
+        checkpointBlock = block;
+    }
+    if (auto live = origin.lock()) {
+        std::lock_guard lock(live->checkpointMutex);
+        if (live->version == originVersion) {
+            live->checkpointBlock = block;
+        }
+    }
+}
+
+std::optional<CheckpointBlock> TableSegment::getCheckpointBlock() const {
+    std::lock_guard lock(checkpointMutex);
+    return checkpointBlock;
+}
+
+const TableSegment::ColumnSummary *TableSegment::getSummary(const std::shared_ptr<Column> &column) const {
+    if (!isFull() || !summaries) {
+        return nullptr;
+    }
+    auto summary = summaries->find(column);
+    return summary == summaries->end() ? nullptr : &summary->second;
+}
+
+size_t TableSegment::size() const {
+    return rowCount;
+}
+
+bool TableSegment::isFull() const {
+    return rowCount >= CAPACITY;
+}
+
+bool TableSegment::isSpilled() const {
+    return page != nullptr;
+}
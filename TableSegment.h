@@ -0,0 +1,93 @@
+#pragma once
+
+#include "BufferPool.h"
+#include "HyperLogLog.h"
+#include "SegmentFile.h"
+#include "Table.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Fixed-capacity run of consecutive rows of a table.
+// A full segment is sealed: its rows are encoded into a page of the table's segment file, which is then
+// memory-mapped, and the decoded rows move to the buffer pool. Reading a page missing from the pool decodes it
+// from the mapping again.
+// A frozen copy shares the rows and the page of the segment. Appends only add rows past the ones the copy counts,
+// other changes copy the rows first, so the frozen copy keeps the rows as they were when it was taken.
+// Every row remembers the version of the commit that added it, a copy for a reader counts only the rows committed
+// up to the reader's version.
+// Appends keep a summary of every column, so a full segment answers MIN, MAX and APPROX_COUNT_DISTINCT without
+// reading its rows.
+class TableSegment {
+public:
+    struct ColumnSummary {
+        BoxedValue min; // Smallest value that is not NULL, NULL when the column holds none
+        BoxedValue max;
+        HyperLogLog distinct; // Sketch of the values, merged with the sketches of other segments
+    };
+
+private:
+    std::shared_ptr<std::vector<Row>> rows; // Decoded rows of a segment that is not spilled, shared with frozen copies
+    size_t rowCount = 0;
+    std::shared_ptr<std::vector<uint64_t>> versions; // Commit version of each row, null while all rows are old enough
+    uint64_t pageId = 0; // Key in the buffer pool, unique in the process
+    size_t pageBytes = 0; // Memory the decoded page takes, reserved in the pool while it is decoded again
+    std::vector<std::shared_ptr<Column>> pageColumns; // Columns of the table when the page was written
+    std::shared_ptr<SegmentPage> page; // Null until the segment is spilled
+    // Summaries of the columns the rows had since the first append, shared with frozen copies once the segment is full
+    std::shared_ptr<std::map<std::shared_ptr<Column>, ColumnSummary>> summaries;
+
+    mutable std::mutex checkpointMutex; // A background checkpoint marks segments while they change
+    std::optional<CheckpointBlock> checkpointBlock; // Set while the segment is unchanged since a checkpoint stored it
+    uint64_t version = 0; // Bumped by every change
+    std::weak_ptr<TableSegment> origin; // Live segment of a frozen copy
+    uint64_t originVersion = 0; // Version of the live segment when the copy was taken
+
+    virtual std::shared_ptr<std::vector<Row>> decode(const std::vector<std::shared_ptr<Column>> &columns) const;
+    virtual void unshareRows(); // Copies rows still read by a frozen copy
+
+public:
+    static constexpr size_t CAPACITY = 4096; // Rows per segment
+
+    TableSegment();
+
+    // Point-in-time copy for a reader on another thread, cheap as nothing is copied until the segment changes.
+    // It holds only the rows committed up to the given version.
+    static std::shared_ptr<TableSegment> freeze(const std::shared_ptr<TableSegment> &segment,
+                                                uint64_t version = UINT64_MAX);
+
+    // Only while the segment is not full, makes the segment dirty. Version 0 is visible to every reader.
+    virtual void append(Row row, uint64_t rowVersion = 0);
+    // Forgets the row versions once no reader started before the newest of them
+    virtual void collectVersions(uint64_t oldestReader);
+    // Page payload of a full segment, readers and appends to other segments go on meanwhile
+    [[nodiscard]] virtual std::string encode(const std::vector<std::shared_ptr<Column>> &columns) const;
+    // Switches a full segment over to its written page and hands the decoded rows over to the pool
+    virtual void spill(std::shared_ptr<SegmentPage> writtenPage, const std::vector<std::shared_ptr<Column>> &columns,
+                       BufferPool &pool);
+
+    // Rows with the given columns, pinned in the pool when the segment is spilled.
+    // Columns added after the page was written read as NULL, dropped ones are left out.
+    [[nodiscard]] virtual PinnedRows read(const std::vector<std::shared_ptr<Column>> &columns, BufferPool *pool,
+                                          ScanRing *ring = nullptr) const;
+    [[nodiscard]] virtual std::vector<Row> *getResidentRows(); // Null when spilled, the caller may change the rows
+    // Encoded rows straight from the page, only when it was written with exactly these columns
+    [[nodiscard]] virtual std::optional<std::string_view> getPagePayload(
+            const std::vector<std::shared_ptr<Column>> &columns) const;
+
+    virtual void markDirty(); // The rows changed, e.g. the table was altered
+    // Marks a frozen copy and its live segment too, unless that one changed since the copy was taken
+    virtual void setCheckpointBlock(const CheckpointBlock &block);
+    [[nodiscard]] virtual std::optional<CheckpointBlock> getCheckpointBlock() const;
+
+    // Summary of a column over all rows of a full segment, null while the segment fills or for a column added later
+    [[nodiscard]] virtual const ColumnSummary *getSummary(const std::shared_ptr<Column> &column) const;
+
+    [[nodiscard]] virtual size_t size() const;
+    [[nodiscard]] virtual bool isFull() const;
+    [[nodiscard]] virtual bool isSpilled() const;
+};
@@ -0,0 +1,20 @@
+#include "TableStorage.h"
+
+TableStorage::TableStorage(Options options)
+        : options(std::move(options)), bufferPool(this->options.bufferPoolBytes), io(AsyncIo::create()) {}
+
+std::unique_ptr<SegmentFile> TableStorage::createFile() const {
+    return std::make_unique<SegmentFile>(options.directory);
+}
+
+const TableStorage::Options &TableStorage::getOptions() const {
+    return options;
+}
+
+BufferPool &TableStorage::getBufferPool() {
+    return bufferPool;
+}
+
+const std::shared_ptr<AsyncIo> &TableStorage::getIo() const {
+    return io;
+}
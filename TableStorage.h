@@ -0,0 +1,29 @@
+#pragma once
+
+#include "AsyncIo.h"
+#include "BufferPool.h"
+#include "SegmentFile.h"
+#include <memory>
+#include <string>
+
+// Decides where sealed table segments go and caches their decoded pages within a memory budget.
+// Also owns the asynchronous I/O used for the log and checkpoints.
+class TableStorage {
+public:
+    struct Options {
+        std::string directory = "."; // Segment files are created here
+        size_t bufferPoolBytes = 256 << 20; // Budget of the buffer pool for decoded pages of all tables
+    };
+
+    explicit TableStorage(Options options);
+
+    [[nodiscard]] virtual std::unique_ptr<SegmentFile> createFile() const; // One per table
+    [[nodiscard]] virtual const Options &getOptions() const;
+    [[nodiscard]] virtual BufferPool &getBufferPool();
+    [[nodiscard]] virtual const std::shared_ptr<AsyncIo> &getIo() const;
+
+private:
+    Options options;
+    BufferPool bufferPool;
+    std::shared_ptr<AsyncIo> io;
+};
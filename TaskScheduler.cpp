@@ -0,0 +1,174 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+
+// Worker the current thread is, so tasks it submits go to its own deque
+static thread_local const TaskScheduler *currentScheduler = nullptr;
+static thread_local size_t currentWorker = 0;
+
+TaskScheduler::TaskScheduler(size_t workerCount) : started(std::chrono::steady_clock::now()) {
+    workerCount = std::max<size_t>(workerCount, 1);
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    threads.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        threads.emplace_back(&TaskScheduler::workerLoop, this, i);
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+void TaskScheduler::push(std::function<void()> task) {
+    size_t target = currentScheduler == this ? currentWorker : nextWorker++ % workers.size();
+    {
+        std::lock_guard lock(workers[target]->mutex);
+        workers[target]->tasks.push_back(std::move(task));
+    }
+    {
+        // Counted under the sleep lock, so a worker about to sleep cannot miss the task
+        std::lock_guard lock(sleepMutex);
+        ++queued;
+    }
+    taskAvailable.notify_one();
+}
+
+bool TaskScheduler::runOne(size_t self) {
+    std::function<void()> task;
+    {
+        std::lock_guard lock(workers[self]->mutex);
+        if (!workers[self]->tasks.empty()) {
+            task = std::move(workers[self]->tasks.back());
+            workers[self]->tasks.pop_back();
+        }
+    }
+    for (size_t i = 1; !task && i < workers.size(); ++i) {
+        auto &victim = *workers[(self + i) % workers.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            ++tasksStolen;
+        }
+    }
+    if (!task) {
+        return false;
+    }
+
+    --queued;
+    auto start = std::chrono::steady_clock::now();
+    task(); // Exceptions are captured by the packaged task
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    workers[self]->busyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    ++tasksRun;
+    return true;
+}
+
+void TaskScheduler::workerLoop(size_t index) {
+    currentScheduler = this;
+    currentWorker = index;
+    while (true) {
+        if (runOne(index)) {
+            continue;
+        }
+        std::unique_lock lock(sleepMutex);
+        taskAvailable.wait(lock, [&] { return stopping || queued > 0; });
+        if (stopping && queued == 0) {
+            return; // Stopping and nothing left to run
+        }
+    }
+}
+
+void TaskScheduler::parallelFor(size_t begin, size_t end, size_t grainSize,
+                                const std::function<void(size_t, size_t)> &body) {
+    if (begin >= end) {
+        return;
+    }
+    grainSize = std::max<size_t>(grainSize, 1);
+    size_t chunkCount = (end - begin + grainSize - 1) / grainSize;
+
+    // Helpers claim chunks until none are left, one that starts late finds nothing to do.
+    // The state outlives the call for such helpers, body is only touched while a chunk is claimed.
+    struct Loop {
+        std::atomic<size_t> nextChunk = 0;
+        std::atomic<size_t> finishedChunks = 0;
+        std::mutex mutex; // Guards failure
+        std::condition_variable finished;
+        std::exception_ptr failure;
+    };
+    auto loop = std::make_shared<Loop>();
+    auto runChunks = [loop, begin, end, grainSize, chunkCount, &body] {
+        for (size_t chunk = loop->nextChunk++; chunk < chunkCount; chunk = loop->nextChunk++) {
+            size_t chunkBegin = begin + chunk * grainSize;
+            try {
+                body(chunkBegin, std::min(end, chunkBegin + grainSize));
+            } catch (...) {
+                std::lock_guard lock(loop->mutex);
+                if (!loop->failure) {
+                    loop->failure = std::current_exception();
+                }
+            }
+            if (++loop->finishedChunks == chunkCount) {
+                std::lock_guard lock(loop->mutex);
+                loop->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(chunkCount - 1, workers.size());
+    for (size_t i = 0; i < helpers; ++i) {
+        push(runChunks);
+    }
+    runChunks();
+
+    // Only chunks already being run by helpers are left, they finish without waiting for anything else
+    std::exception_ptr failure;
+    {
+        std::unique_lock lock(loop->mutex);
+        loop->finished.wait(lock, [&] { return loop->finishedChunks == chunkCount; });
+        failure = std::move(loop->failure); // A helper may drop the state last, the exception stays with the caller
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+void TaskScheduler::parallelForUntil(size_t begin, size_t end, size_t lanes,
+                                     const std::function<void(size_t, size_t)> &body,
+                                     const std::function<bool()> &done) {
+    lanes = std::max<size_t>(lanes, 1);
+    for (size_t wave = 1; begin < end && !done(); wave *= 2) {
+        size_t waveEnd = begin + std::min(wave, end - begin);
+        parallelFor(begin, waveEnd, (waveEnd - begin + lanes - 1) / lanes, body);
+        begin = waveEnd;
+    }
+}
+
+size_t TaskScheduler::size() const {
+    return workers.size();
+}
+
+TaskScheduler::Stats TaskScheduler::getStats() const {
+    Stats stats;
+    stats.workerCount = workers.size();
+    stats.tasksRun = tasksRun;
+    stats.tasksStolen = tasksStolen;
+    uint64_t busy = 0;
+    for (const auto &worker: workers) {
+        busy += worker->busyNanoseconds;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+    if (elapsed.count() > 0) {
+        stats.utilisation = static_cast<double>(busy) / (static_cast<double>(elapsed.count()) * workers.size());
+    }
+    return stats;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Worker threads shared by every parallel operator of a database: snapshot loading, recovery, scans and
+// submitted queries. Every worker has its own deque of tasks. It runs the newest task of its own deque first
+// and steals the oldest task of another worker once its own deque is empty, so subtasks stay on the core that
+// spawned them until other workers run dry. Tasks submitted from other threads are spread round-robin.
+class TaskScheduler {
+public:
+    struct Stats {
+        size_t workerCount = 0;
+        uint64_t tasksRun = 0;
+        uint64_t tasksStolen = 0; // Taken from the deque of another worker
+        double utilisation = 0; // Share of the worker time spent running tasks since the scheduler started
+    };
+
+    explicit TaskScheduler(size_t workerCount = std::thread::hardware_concurrency()); // At least one worker
+    TaskScheduler(const TaskScheduler &) = delete;
+    TaskScheduler &operator=(const TaskScheduler &) = delete;
+    virtual ~TaskScheduler(); // Runs the queued tasks and joins the workers
+
+    // Queues a task, its result or exception is delivered through the future
+    template<typename Function>
+    std::future<std::invoke_result_t<Function>> submit(Function function);
+
+    // Calls body(chunkBegin, chunkEnd) for consecutive chunks of [begin, end) of at most grainSize indexes.
+    // The calling thread runs chunks too, so this may be called from a task. Rethrows the first exception.
+    virtual void parallelFor(size_t begin, size_t end, size_t grainSize,
+                             const std::function<void(size_t, size_t)> &body);
+    // parallelFor for scans that may only need the first indexes, e.g. under a LIMIT. Runs [begin, end) in waves
+    // of one index, then two, four and so on, each split into at most lanes chunks, and stops before a wave
+    // once done() holds.
+    virtual void parallelForUntil(size_t begin, size_t end, size_t lanes,
+                                  const std::function<void(size_t, size_t)> &body,
+                                  const std::function<bool()> &done);
+
+    [[nodiscard]] virtual size_t size() const; // Number of workers
+    [[nodiscard]] virtual Stats getStats() const;
+
+private:
+    struct Worker {
+        std::mutex mutex; // Guards tasks
+        std::deque<std::function<void()>> tasks;
+        std::atomic<uint64_t> busyNanoseconds = 0;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::mutex sleepMutex; // Guards stopping, workers sleep on it while every deque is empty
+    std::condition_variable taskAvailable;
+    bool stopping = false;
+    std::atomic<size_t> queued = 0; // Tasks in all deques
+    std::atomic<size_t> nextWorker = 0; // Deque for the next task submitted from outside the pool
+    std::atomic<uint64_t> tasksRun = 0;
+    std::atomic<uint64_t> tasksStolen = 0;
+    std::chrono::steady_clock::time_point started;
+
+    virtual void push(std::function<void()> task);
+    virtual bool runOne(size_t self); // Runs one task of its own deque or a stolen one, false when all are empty
+    virtual void workerLoop(size_t index);
+};
+
+template<typename Function>
+std::future<std::invoke_result_t<Function>> TaskScheduler::submit(Function function) {
+    // std::function needs a copyable target, the task itself is move-only
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Function>()>>(std::move(function));
+    auto future = task->get_future();
+    push([task] { (*task)(); });
+    return future;
+}
@@ -0,0 +1,42 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    threadCount = std::max<size_t>(threadCount, 1);
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (auto &worker: workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            taskAvailable.wait(lock, [&] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return; // Stopping and nothing left to run
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task(); // Exceptions are captured by the packaged task
+    }
+}
+
+size_t ThreadPool::size() const {
+    return workers.size();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads running submitted tasks in FIFO order
+class ThreadPool {
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex; // Guards tasks and stopping
+    std::condition_variable taskAvailable;
+    bool stopping = false;
+
+    virtual void workerLoop();
+public:
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency()); // At least one worker
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    virtual ~ThreadPool(); // Runs the queued tasks and joins the workers
+
+    // Queues a task, its result or exception is delivered through the future
+    template<typename Function>
+    std::future<std::invoke_result_t<Function>> submit(Function function);
+
+    [[nodiscard]] virtual size_t size() const; // Number of workers
+};
+
+template<typename Function>
+std::future<std::invoke_result_t<Function>> ThreadPool::submit(Function function) {
+    // std::function needs a copyable target, the task itself is move-only
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Function>()>>(std::move(function));
+    auto future = task->get_future();
+    {
+        std::lock_guard lock(mutex);
+        tasks.emplace([task] { (*task)(); });
+    }
+    taskAvailable.notify_one();
+    return future;
+}
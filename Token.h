@@ -45,7 +45,27 @@ X(IS_NOT_NULL, "IS_NOT_NULL")   \
 X(ALTER, "ALTER")   \
 X(ADD, "ADD")       \
 X(DROP, "DROP")     \
-X(COLUMN, "COLUMN")
+X(COLUMN, "COLUMN") \
+X(BEGIN, "BEGIN")   \
+X(COMMIT, "COMMIT") \
+X(ROLLBACK, "ROLLBACK") \
+X(INDEX, "INDEX")   \
+X(ON, "ON")         \
+X(JOIN, "JOIN")     \
+X(ORDER, "ORDER")   \
+X(BY, "BY")         \
+X(ASC, "ASC")       \
+X(DESC, "DESC")     \
+X(LIMIT, "LIMIT")   \
+X(OFFSET, "OFFSET") \
+X(GROUP, "GROUP")   \
+X(COUNT, "COUNT")   \
+X(SUM, "SUM")       \
+X(AVG, "AVG")       \
+X(MIN, "MIN")       \
+X(MAX, "MAX")       \
+X(DISTINCT, "DISTINCT") \
+X(APPROX_COUNT_DISTINCT, "APPROX_COUNT_DISTINCT")
 
 
 
@@ -99,7 +119,27 @@ static inline const std::unordered_map<std::string, TokenType> keywords = {
         {"ALTER", TokenType::ALTER},
         {"ADD", TokenType::ADD},
         {"DROP", TokenType::DROP},
-        {"COLUMN", TokenType::COLUMN}
+        {"COLUMN", TokenType::COLUMN},
+        {"BEGIN", TokenType::BEGIN},
+        {"COMMIT", TokenType::COMMIT},
+        {"ROLLBACK", TokenType::ROLLBACK},
+        {"INDEX", TokenType::INDEX},
+        {"ON", TokenType::ON},
+        {"JOIN", TokenType::JOIN},
+        {"ORDER", TokenType::ORDER},
+        {"BY", TokenType::BY},
+        {"ASC", TokenType::ASC},
+        {"DESC", TokenType::DESC},
+        {"LIMIT", TokenType::LIMIT},
+        {"OFFSET", TokenType::OFFSET},
+        {"GROUP", TokenType::GROUP},
+        {"COUNT", TokenType::COUNT},
+        {"SUM", TokenType::SUM},
+        {"AVG", TokenType::AVG},
+        {"MIN", TokenType::MIN},
+        {"MAX", TokenType::MAX},
+        {"DISTINCT", TokenType::DISTINCT},
+        {"APPROX_COUNT_DISTINCT", TokenType::APPROX_COUNT_DISTINCT}
 };
 
 
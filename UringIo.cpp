@@ -0,0 +1,263 @@
+#include "UringIo.h"
+
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct UringIo::Request {
+    enum class Kind {
+        WRITE,
+        SYNC,
+        STOP, // Last request, ends the completion thread
+    };
+
+    Kind kind;
+    int fd;
+    const char *data; // Rest of the data of a write
+    size_t length;
+    uint64_t offset;
+    std::promise<void> done;
+
+    explicit Request(Kind kind, int fd = -1, const char *data = nullptr, size_t length = 0, uint64_t offset = 0)
+            : kind(kind), fd(fd), data(data), length(length), offset(offset) {}
+};
+
+static int enter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static std::string errorText(int error) {
+    return std::strerror(error);
+}
+
+UringIo::UringIo() {
+    io_uring_params params{};
+    ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params));
+    if (ringFd < 0) {
+        throw std::runtime_error("io_uring is not available: " + errorText(errno));
+    }
+    // Kernels without this feature do not have the write operation either
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        ::close(ringFd);
+        throw std::runtime_error("io_uring of this kernel cannot write files");
+    }
+
+    submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMapping = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMapping) {
+        submissionRingSize = completionRingSize = std::max(submissionRingSize, completionRingSize);
+    }
+    entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+    auto map = [&](size_t size, off_t offset) -> void * {
+        void *address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+        if (address == MAP_FAILED) {
+            int error = errno;
+            unmap();
+            ::close(ringFd);
+            throw std::runtime_error("Cannot map io_uring: " + errorText(error));
+        }
+        return address;
+    };
+    submissionRing = map(submissionRingSize, IORING_OFF_SQ_RING);
+    completionRing = singleMapping ? submissionRing : map(completionRingSize, IORING_OFF_CQ_RING);
+    entries = static_cast<io_uring_sqe *>(map(entriesSize, IORING_OFF_SQES));
+
+    auto *submission = static_cast<char *>(submissionRing);
+    submissionTail = reinterpret_cast<unsigned *>(submission + params.sq_off.tail);
+    submissionMask = *reinterpret_cast<unsigned *>(submission + params.sq_off.ring_mask);
+    submissionArray = reinterpret_cast<unsigned *>(submission + params.sq_off.array);
+
+    auto *completion = static_cast<char *>(completionRing);
+    completionHead = reinterpret_cast<unsigned *>(completion + params.cq_off.head);
+    completionTail = reinterpret_cast<unsigned *>(completion + params.cq_off.tail);
+    completionMask = *reinterpret_cast<unsigned *>(completion + params.cq_off.ring_mask);
+    completions = reinterpret_cast<io_uring_cqe *>(completion + params.cq_off.cqes);
+
+    reaper = std::thread(&UringIo::reapLoop, this);
+}
+
+UringIo::~UringIo() {
+    try {
+        submit(new Request(Request::Kind::STOP));
+    } catch (const std::exception &) {
+        // The ring is broken, the completion thread has ended already
+    }
+    reaper.join();
+    unmap();
+    ::close(ringFd);
+}
+
+void UringIo::unmap() {
+    if (entries) {
+        ::munmap(entries, entriesSize);
+    }
+    if (completionRing && completionRing != submissionRing) {
+        ::munmap(completionRing, completionRingSize);
+    }
+    if (submissionRing) {
+        ::munmap(submissionRing, submissionRingSize);
+    }
+    entries = nullptr;
+    completionRing = submissionRing = nullptr;
+}
+
+std::future<void> UringIo::submitWrite(int fd, std::string_view data, uint64_t offset) {
+    auto *request = new Request(Request::Kind::WRITE, fd, data.data(), data.size(), offset);
+    auto future = request->done.get_future();
+    if (data.empty()) {
+        request->done.set_value();
+        delete request;
+        return future;
+    }
+    submit(request);
+    return future;
+}
+
+std::future<void> UringIo::submitSync(int fd) {
+    auto *request = new Request(Request::Kind::SYNC, fd);
+    auto future = request->done.get_future();
+    submit(request);
+    return future;
+}
+
+void UringIo::submit(Request *request) {
+    std::unique_lock lock(mutex);
+    slotFreed.wait(lock, [&] { return inFlight < QUEUE_DEPTH || broken; });
+    try {
+        if (broken) {
+            throw std::runtime_error("io_uring stopped working, no more writes are possible");
+        }
+        submitLocked(request);
+    } catch (...) {
+        delete request;
+        throw;
+    }
+    pending.insert(request);
+    ++inFlight;
+}
+
+void UringIo::submitLocked(Request *request) {
+    // Only submitters move the tail, and each one hands its entry to the kernel right away
+    unsigned tail = *submissionTail;
+    unsigned index = tail & submissionMask;
+    io_uring_sqe &entry = entries[index];
+    std::memset(&entry, 0, sizeof(entry));
+    entry.fd = request->fd;
+    entry.user_data = reinterpret_cast<uint64_t>(request);
+    switch (request->kind) {
+        case Request::Kind::WRITE:
+            entry.opcode = IORING_OP_WRITE;
+            entry.addr = reinterpret_cast<uint64_t>(request->data);
+            entry.len = static_cast<uint32_t>(std::min<size_t>(request->length, UINT32_MAX));
+            entry.off = request->offset;
+            break;
+        case Request::Kind::SYNC:
+            entry.opcode = IORING_OP_FSYNC;
+            entry.fsync_flags = IORING_FSYNC_DATASYNC;
+            break;
+        case Request::Kind::STOP:
+            entry.opcode = IORING_OP_NOP;
+            break;
+    }
+    submissionArray[index] = index;
+    std::atomic_ref(*submissionTail).store(tail + 1, std::memory_order_release);
+
+    int result;
+    do {
+        result = enter(ringFd, 1, 0, 0);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+        int error = errno;
+        std::atomic_ref(*submissionTail).store(tail, std::memory_order_release); // The kernel did not take it
+        throw std::runtime_error("Cannot submit to io_uring: " + errorText(error));
+    }
+}
+
+void UringIo::reapLoop() {
+    while (true) {
+        if (enter(ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN
+            && errno != EBUSY) {
+            std::string error = "Waiting for io_uring completions failed: " + errorText(errno);
+            Logger::error(error);
+            fail(error);
+            return;
+        }
+
+        unsigned head = *completionHead;
+        unsigned tail = std::atomic_ref(*completionTail).load(std::memory_order_acquire);
+        bool stopping = false;
+        for (; head != tail; ++head) {
+            const io_uring_cqe &completion = completions[head & completionMask];
+            auto *request = reinterpret_cast<Request *>(completion.user_data);
+            int result = completion.res;
+            std::atomic_ref(*completionHead).store(head + 1, std::memory_order_release);
+
+            if (request->kind == Request::Kind::STOP) {
+                delete request;
+                stopping = true;
+            } else {
+                complete(request, result);
+            }
+        }
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void UringIo::complete(Request *request, int result) {
+    if (result < 0) {
+        std::string operation = request->kind == Request::Kind::SYNC ? "sync" : "write";
+        request->done.set_exception(std::make_exception_ptr(
+                std::runtime_error("Cannot " + operation + " file: " + errorText(-result))));
+    } else if (request->kind == Request::Kind::WRITE && static_cast<size_t>(result) < request->length) {
+        if (result == 0) {
+            request->done.set_exception(std::make_exception_ptr(
+                    std::runtime_error("Cannot write file: the write made no progress")));
+        } else {
+            // Short write, the rest goes in again and keeps its slot
+            request->data += result;
+            request->length -= static_cast<size_t>(result);
+            request->offset += static_cast<uint64_t>(result);
+            try {
+                std::lock_guard lock(mutex);
+                submitLocked(request);
+                return;
+            } catch (...) {
+                request->done.set_exception(std::current_exception());
+            }
+        }
+    } else {
+        request->done.set_value();
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        pending.erase(request);
+        --inFlight;
+    }
+    delete request;
+    slotFreed.notify_one();
+}
+
+void UringIo::fail(const std::string &error) {
+    {
+        std::lock_guard lock(mutex);
+        broken = true;
+        for (auto *request: pending) {
+            request->done.set_exception(std::make_exception_ptr(std::runtime_error(error)));
+            delete request;
+        }
+        pending.clear();
+        inFlight = 0;
+    }
+    slotFreed.notify_all(); // Waiting submitters throw now
+}
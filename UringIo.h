@@ -0,0 +1,60 @@
+#pragma once
+
+#include "AsyncIo.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// Writes through an io_uring instance, set up with raw system calls.
+// Requests are submitted by the callers, a completion thread reaps them and fulfils their futures;
+// a short write is resubmitted for the rest of its data.
+class UringIo : public AsyncIo {
+    static constexpr unsigned QUEUE_DEPTH = 64; // Requests in flight at once, further submitters wait
+
+    struct Request;
+
+    int ringFd = -1;
+    void *submissionRing = nullptr;
+    size_t submissionRingSize = 0;
+    void *completionRing = nullptr; // Same mapping as the submission ring on kernels that allow it
+    size_t completionRingSize = 0;
+    io_uring_sqe *entries = nullptr;
+    size_t entriesSize = 0;
+
+    // Fields of the rings shared with the kernel
+    unsigned *submissionTail = nullptr;
+    unsigned submissionMask = 0;
+    unsigned *submissionArray = nullptr;
+    unsigned *completionHead = nullptr;
+    unsigned *completionTail = nullptr;
+    unsigned completionMask = 0;
+    io_uring_cqe *completions = nullptr;
+
+    std::mutex mutex; // Guards the submission ring, pending, inFlight and broken
+    std::condition_variable slotFreed;
+    size_t inFlight = 0;
+    std::unordered_set<Request *> pending; // Submitted and not completed, failed all at once if the ring breaks
+    bool broken = false; // Completions cannot be reaped any more, submitting throws
+    std::thread reaper;
+
+    virtual void submit(Request *request); // Takes ownership of the request
+    virtual void submitLocked(Request *request);
+    virtual void reapLoop();
+    virtual void complete(Request *request, int result);
+    virtual void fail(const std::string &error); // Fails every pending request and breaks the ring
+    virtual void unmap();
+public:
+    UringIo(); // Throws when the kernel does not support io_uring
+    UringIo(const UringIo &) = delete;
+    UringIo &operator=(const UringIo &) = delete;
+    ~UringIo() override; // Callers have to wait for their requests first
+
+    std::future<void> submitWrite(int fd, std::string_view data, uint64_t offset) override;
+    std::future<void> submitSync(int fd) override;
+};
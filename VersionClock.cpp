@@ -0,0 +1,51 @@
+#include "VersionClock.h"
+
+#include <utility>
+
+ReadSnapshot::ReadSnapshot(VersionClock *clock, uint64_t version) : clock(clock), version(version) {}
+
+ReadSnapshot::ReadSnapshot(ReadSnapshot &&other) noexcept
+        : clock(std::exchange(other.clock, nullptr)), version(other.version) {}
+
+ReadSnapshot::~ReadSnapshot() {
+    if (clock) {
+        clock->endRead(version);
+    }
+}
+
+uint64_t ReadSnapshot::getVersion() const {
+    return version;
+}
+
+uint64_t VersionClock::commit(const std::function<void(uint64_t)> &publish) {
+    std::lock_guard lock(commitMutex);
+    uint64_t version = committed.load(std::memory_order_relaxed) + 1;
+    publish(version);
+    committed.store(version, std::memory_order_release);
+    return version;
+}
+
+ReadSnapshot VersionClock::beginRead() {
+    std::lock_guard lock(readersMutex);
+    // Read under the lock, so getOldestReader never misses a reader that is just starting
+    uint64_t version = committed.load(std::memory_order_acquire);
+    ++readers[version];
+    return {this, version};
+}
+
+void VersionClock::endRead(uint64_t version) {
+    std::lock_guard lock(readersMutex);
+    auto it = readers.find(version);
+    if (--it->second == 0) {
+        readers.erase(it);
+    }
+}
+
+uint64_t VersionClock::getOldestReader() {
+    std::lock_guard lock(readersMutex);
+    return readers.empty() ? committed.load(std::memory_order_acquire) : readers.begin()->first;
+}
+
+uint64_t VersionClock::getCommitted() const {
+    return committed.load(std::memory_order_acquire);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+
+class VersionClock; // Forward declaration
+
+// Version a reader started with, registered with the clock while the guard lives
+class ReadSnapshot {
+    VersionClock *clock = nullptr;
+    uint64_t version = 0;
+public:
+    ReadSnapshot(VersionClock *clock, uint64_t version);
+    ReadSnapshot(ReadSnapshot &&other) noexcept;
+    ReadSnapshot(const ReadSnapshot &) = delete;
+    ReadSnapshot &operator=(const ReadSnapshot &) = delete;
+    virtual ~ReadSnapshot(); // Lets the clock forget the version
+
+    [[nodiscard]] virtual uint64_t getVersion() const;
+};
+
+// Versions for multi-version reads. Every commit gets the next version and becomes visible to readers starting
+// after it, a reader sees only rows committed up to the version it started with.
+// Rows loaded from disk have version 0 and are visible to everyone.
+class VersionClock {
+    std::mutex commitMutex; // Commits are published in version order
+    std::atomic<uint64_t> committed = 0; // Newest version visible to new readers
+    std::mutex readersMutex;
+    std::map<uint64_t, size_t> readers; // Versions in use and the number of readers of each
+
+public:
+    // Runs publish with the version of the new commit, readers see the version only after publish returns
+    virtual uint64_t commit(const std::function<void(uint64_t version)> &publish);
+    [[nodiscard]] virtual ReadSnapshot beginRead();
+    virtual void endRead(uint64_t version);
+    // No reader needs to tell apart versions up to this one any more
+    [[nodiscard]] virtual uint64_t getOldestReader();
+    [[nodiscard]] virtual uint64_t getCommitted() const;
+};
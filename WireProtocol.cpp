@@ -0,0 +1,183 @@
+#include "WireProtocol.h"
+
+#include "BinaryFormat.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static bool isPort(const std::string &address) {
+    return !address.empty() && std::ranges::all_of(address, [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// Fills the socket address for the given address string, returns its length
+static socklen_t socketAddress(const std::string &address, sockaddr_storage &storage) {
+    std::memset(&storage, 0, sizeof(storage));
+    if (isPort(address)) {
+        auto &inet = reinterpret_cast<sockaddr_in &>(storage);
+        inet.sin_family = AF_INET;
+        unsigned long port = 0;
+        auto [end, error] = std::from_chars(address.data(), address.data() + address.size(), port);
+        if (error != std::errc() || port < 1 || port > 65535) {
+            throw std::runtime_error("Port " + address + " is not between 1 and 65535");
+        }
+        inet.sin_port = htons(static_cast<uint16_t>(port));
+        inet.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Local clients only
+        return sizeof(sockaddr_in);
+    }
+    auto &local = reinterpret_cast<sockaddr_un &>(storage);
+    if (address.size() >= sizeof(local.sun_path)) {
+        throw std::runtime_error("Socket path " + address + " is too long");
+    }
+    local.sun_family = AF_UNIX;
+    std::memcpy(local.sun_path, address.c_str(), address.size() + 1);
+    return sizeof(sockaddr_un);
+}
+
+int WireProtocol::listen(const std::string &address) {
+    sockaddr_storage storage{};
+    socklen_t length = socketAddress(address, storage);
+    int fd = ::socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create a socket for " + address);
+    }
+    if (isPort(address)) {
+        int reuse = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    } else {
+        ::unlink(address.c_str()); // A socket file left behind by a server that did not shut down cleanly
+    }
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&storage), length) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot listen on " + address);
+    }
+    return fd;
+}
+
+int WireProtocol::connect(const std::string &address) {
+    sockaddr_storage storage{};
+    socklen_t length = socketAddress(address, storage);
+    int fd = ::socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create a socket for " + address);
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&storage), length) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot connect to " + address);
+    }
+    return fd;
+}
+
+void WireProtocol::writeFrame(int fd, std::string_view payload) {
+    if (payload.size() > MAX_FRAME_SIZE) {
+        // The length would not fit its prefix or the peer would refuse the frame, nothing is sent
+        throw std::runtime_error("Frame of " + std::to_string(payload.size()) + " bytes is too large");
+    }
+    ByteWriter writer;
+    writer.writeU32(static_cast<uint32_t>(payload.size()));
+    writer.writeBytes(payload);
+    std::string_view data = writer.data();
+    while (!data.empty()) {
+        // No SIGPIPE when the peer is gone, the error is reported instead
+        ssize_t sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            throw std::runtime_error("Connection lost while sending");
+        }
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+}
+
+// Reads exactly size bytes, false when the connection ends before the first one
+static bool receiveAll(int fd, char *buffer, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        ssize_t count = ::recv(fd, buffer + received, size - received, 0);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count == 0 && received == 0) {
+            return false;
+        }
+        if (count <= 0) {
+            throw std::runtime_error("Connection lost while receiving");
+        }
+        received += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+std::optional<std::string> WireProtocol::readFrame(int fd) {
+    char header[sizeof(uint32_t)];
+    if (!receiveAll(fd, header, sizeof(header))) {
+        return std::nullopt;
+    }
+    uint32_t length = ByteReader(std::string_view(header, sizeof(header))).readU32();
+    if (length > MAX_FRAME_SIZE) {
+        throw std::runtime_error("Frame of " + std::to_string(length) + " bytes is too large");
+    }
+    std::string payload(length, '\0');
+    if (length > 0 && !receiveAll(fd, payload.data(), length)) {
+        throw std::runtime_error("Connection lost while receiving");
+    }
+    return payload;
+}
+
+std::string WireProtocol::encodeResult(const QueryResult &result) {
+    ByteWriter writer;
+    writer.writeU8(static_cast<uint8_t>(Status::OK));
+    writer.writeU8(result.hasRows);
+    writer.writeU32(static_cast<uint32_t>(result.columns.size()));
+    for (const auto &column: result.columns) {
+        writer.writeString(column);
+    }
+    writer.writeU32(static_cast<uint32_t>(result.rows.size()));
+    for (const auto &row: result.rows) {
+        for (const auto &value: row) {
+            writer.writeString(value);
+        }
+        if (writer.size() > MAX_FRAME_SIZE) {
+            throw std::runtime_error("Result is larger than " + std::to_string(MAX_FRAME_SIZE >> 20)
+                                     + " MiB, narrow it down with WHERE or LIMIT");
+        }
+    }
+    return writer.release();
+}
+
+std::string WireProtocol::encodeError(std::string_view message) {
+    ByteWriter writer;
+    writer.writeU8(static_cast<uint8_t>(Status::ERROR));
+    writer.writeString(message);
+    return writer.release();
+}
+
+QueryResult WireProtocol::decodeResponse(std::string_view response) {
+    ByteReader reader(response);
+    if (static_cast<Status>(reader.readU8()) == Status::ERROR) {
+        throw std::runtime_error(std::string(reader.readString()));
+    }
+
+    QueryResult result;
+    result.hasRows = reader.readU8() != 0;
+    uint32_t columnCount = reader.readU32();
+    for (uint32_t i = 0; i < columnCount; ++i) {
+        result.columns.emplace_back(reader.readString());
+    }
+    uint32_t rowCount = reader.readU32();
+    result.rows.reserve(rowCount);
+    for (uint32_t i = 0; i < rowCount; ++i) {
+        auto &row = result.rows.emplace_back();
+        for (uint32_t j = 0; j < columnCount; ++j) {
+            row.emplace_back(reader.readString());
+        }
+    }
+    return result;
+}
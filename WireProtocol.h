@@ -0,0 +1,33 @@
+#pragma once
+
+#include "QueryResult.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Messages between the query server and its clients. Every message is a frame: a u32 little-endian length
+// followed by that many bytes. A request is the text of one query, a response is a status byte followed by
+// the result of the query or the error message.
+class WireProtocol {
+public:
+    enum class Status : uint8_t {
+        OK = 0,
+        ERROR = 1,
+    };
+
+    static constexpr uint32_t MAX_FRAME_SIZE = 256 << 20; // Larger frames are refused as garbage
+
+    // A Unix socket path, or a port number for a TCP socket on the loopback interface
+    static int listen(const std::string &address);
+    static int connect(const std::string &address);
+
+    static void writeFrame(int fd, std::string_view payload); // Throws for a payload over MAX_FRAME_SIZE
+    static std::optional<std::string> readFrame(int fd); // Empty when the peer closed the connection between frames
+
+    // Throws when the result does not fit a frame, the server sends that as an error instead
+    static std::string encodeResult(const QueryResult &result);
+    static std::string encodeError(std::string_view message);
+    // Throws the error message sent by the server
+    static QueryResult decodeResponse(std::string_view response);
+};
@@ -0,0 +1,310 @@
+#include "WriteAheadLog.h"
+
+#include "BinaryFormat.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+// File layout: magic, sequence number of the last record dropped from the front, then the records
+static constexpr std::string_view LOG_MAGIC = "FQLWAL02";
+static constexpr size_t HEADER_SIZE = 8 + sizeof(uint64_t);
+static constexpr size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t); // Length and checksum
+static constexpr size_t FLUSH_THRESHOLD = 1 << 20; // Flush early once this many bytes are buffered
+
+static void encodeRecord(std::string &output, std::string_view statement) {
+    char recordHeader[RECORD_HEADER_SIZE];
+    auto length = static_cast<uint32_t>(statement.size());
+    uint32_t checksum = Crc32::compute(statement);
+    std::memcpy(recordHeader, &length, sizeof(length));
+    std::memcpy(recordHeader + sizeof(length), &checksum, sizeof(checksum));
+    output.append(recordHeader, RECORD_HEADER_SIZE);
+    output.append(statement);
+}
+
+WriteAheadLog::WriteAheadLog(std::string filenameArg, Options options, std::shared_ptr<AsyncIo> io)
+        : filename(std::move(filenameArg)), options(options), io(std::move(io)) {
+    // The flusher waits this long between syncs, without a wait it would spin on an idle log
+    if (options.groupCommitInterval.count() < 1) {
+        throw std::invalid_argument("The group commit interval has to be at least 1 ms");
+    }
+    if (std::filesystem::exists(filename) && std::filesystem::file_size(filename) > 0) {
+        if (!isLog(filename)) {
+            throw std::runtime_error("File " + filename + " is not a write-ahead log");
+        }
+        MappedFile file(filename);
+        fileSize = scan(file.view(), nullptr, &appendedSequence);
+        durableSequence = appendedSequence;
+    }
+
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open write-ahead log " + filename);
+    }
+
+    try {
+        if (fileSize == 0) {
+            auto newHeader = header(0);
+            truncate(0);
+            BinaryFile::writeAt(fd, newHeader, 0);
+            fileSize = newHeader.size();
+        } else {
+            truncate(fileSize); // Drop a record torn by a crash
+        }
+    } catch (...) {
+        ::close(fd); // The destructor does not run for a log that failed to open
+        throw;
+    }
+
+    flusher = std::thread(&WriteAheadLog::flushLoop, this);
+}
+
+void WriteAheadLog::truncate(size_t size) const {
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        throw std::runtime_error("Cannot truncate write-ahead log " + filename);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    flushRequested.notify_one();
+    flusher.join(); // The flusher writes whatever is still buffered before it exits
+    ::close(fd);
+}
+
+uint64_t WriteAheadLog::append(std::string_view statement) {
+    std::lock_guard lock(mutex);
+    if (!failure.empty()) {
+        throw std::runtime_error(failure);
+    }
+    encodeRecord(buffer, statement);
+    if (buffer.size() >= FLUSH_THRESHOLD) {
+        flushRequested.notify_one();
+    }
+    return ++appendedSequence;
+}
+
+void WriteAheadLog::commit(uint64_t sequenceNumber) {
+    if (options.durability == Durability::ASYNC) {
+        return;
+    }
+
+    std::unique_lock lock(mutex);
+    if (options.durability == Durability::PER_STATEMENT) {
+        urgent = true;
+        flushRequested.notify_one();
+    }
+    waitDurable(lock, sequenceNumber);
+}
+
+void WriteAheadLog::commitAsync(uint64_t sequenceNumber, std::function<void(const std::string &)> done) {
+    if (options.durability == Durability::ASYNC) {
+        done("");
+        return;
+    }
+
+    std::unique_lock lock(mutex);
+    if (durableSequence >= sequenceNumber || !failure.empty()) {
+        std::string error = durableSequence >= sequenceNumber ? "" : failure;
+        lock.unlock();
+        done(error);
+        return;
+    }
+    durableCallbacks.emplace(sequenceNumber, std::move(done));
+    if (options.durability == Durability::PER_STATEMENT) {
+        urgent = true;
+        flushRequested.notify_one();
+    }
+}
+
+uint64_t WriteAheadLog::sync() {
+    std::unique_lock lock(mutex);
+    uint64_t sequenceNumber = appendedSequence;
+    urgent = true;
+    flushRequested.notify_one();
+    waitDurable(lock, sequenceNumber);
+    return sequenceNumber;
+}
+
+void WriteAheadLog::discardThrough(uint64_t sequenceNumber) {
+    {
+        std::lock_guard lock(mutex);
+        if (sequenceNumber > durableSequence) {
+            throw std::runtime_error("Cannot discard records of the write-ahead log that are not synced yet");
+        }
+    }
+
+    // The flusher waits while the file is swapped, appenders keep buffering
+    std::lock_guard ioLock(ioMutex);
+    std::vector<LogRecord> records;
+    {
+        MappedFile file(filename);
+        scan(file.view().substr(0, fileSize), &records, nullptr);
+    }
+
+    std::string contents = header(sequenceNumber);
+    for (const auto &record: records) {
+        if (record.sequenceNumber > sequenceNumber) {
+            encodeRecord(contents, record.statement);
+        }
+    }
+    BinaryFile::writeAtomically(filename, contents);
+
+    int newFd = ::open(filename.c_str(), O_WRONLY);
+    if (newFd < 0) {
+        std::lock_guard lock(mutex);
+        failure = "Cannot reopen write-ahead log " + filename;
+        throw std::runtime_error(failure);
+    }
+    ::close(fd);
+    fd = newFd;
+    fileSize = contents.size();
+}
+
+uint64_t WriteAheadLog::size() {
+    std::lock_guard ioLock(ioMutex);
+    return fileSize;
+}
+
+uint64_t WriteAheadLog::getAppendedSequence() {
+    std::lock_guard lock(mutex);
+    return appendedSequence;
+}
+
+void WriteAheadLog::waitDurable(std::unique_lock<std::mutex> &lock, uint64_t sequenceNumber) {
+    flushed.wait(lock, [&] { return durableSequence >= sequenceNumber || !failure.empty(); });
+    if (durableSequence < sequenceNumber) {
+        throw std::runtime_error(failure);
+    }
+}
+
+void WriteAheadLog::flushLoop() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        flushRequested.wait_for(lock, options.groupCommitInterval, [&] {
+            return stopping || urgent || buffer.size() >= FLUSH_THRESHOLD;
+        });
+        urgent = false;
+
+        if (!buffer.empty() && failure.empty()) {
+            // Take the whole group and write it without blocking appenders
+            std::string group = std::move(buffer);
+            buffer.clear();
+            uint64_t groupEnd = appendedSequence;
+            lock.unlock();
+
+            std::string error;
+            try {
+                std::lock_guard ioLock(ioMutex);
+                if (io) {
+                    io->write(fd, group, fileSize);
+                    fileSize += group.size();
+                    io->sync(fd);
+                } else {
+                    BinaryFile::writeAt(fd, group, fileSize);
+                    fileSize += group.size();
+                    if (::fdatasync(fd) != 0) {
+                        error = "Cannot sync write-ahead log " + filename;
+                    }
+                }
+            } catch (const std::exception &e) {
+                error = e.what();
+            }
+
+            lock.lock();
+            if (error.empty()) {
+                durableSequence = groupEnd;
+            } else {
+                failure = error;
+            }
+            flushed.notify_all();
+
+            // Every callback up to the group is done, all of them when the log failed
+            auto end = failure.empty() ? durableCallbacks.upper_bound(durableSequence) : durableCallbacks.end();
+            std::vector<std::function<void(const std::string &)>> done;
+            for (auto it = durableCallbacks.begin(); it != end; ++it) {
+                done.push_back(std::move(it->second));
+            }
+            durableCallbacks.erase(durableCallbacks.begin(), end);
+            if (!done.empty()) {
+                std::string callbackFailure = failure;
+                lock.unlock();
+                for (auto &callback: done) {
+                    callback(callbackFailure);
+                }
+                lock.lock();
+            }
+        }
+
+        if (stopping && (buffer.empty() || !failure.empty())) {
+            break;
+        }
+    }
+}
+
+bool WriteAheadLog::isLog(const std::string &filename) {
+    MappedFile file(filename);
+    return file.view().starts_with(LOG_MAGIC) && file.view().size() >= HEADER_SIZE;
+}
+
+std::vector<LogRecord> WriteAheadLog::readRecords(const std::string &filename) {
+    if (!isLog(filename)) {
+        throw std::runtime_error("File " + filename + " is not a write-ahead log");
+    }
+    MappedFile file(filename);
+    std::vector<LogRecord> records;
+    scan(file.view(), &records, nullptr);
+    return records;
+}
+
+size_t WriteAheadLog::scan(std::string_view contents, std::vector<LogRecord> *records, uint64_t *lastSequence) {
+    ByteReader reader(contents);
+    reader.readBytes(LOG_MAGIC.size());
+    uint64_t sequenceNumber = reader.readU64();
+    size_t intactLength = reader.getPosition();
+    try {
+        while (!reader.isEnd()) {
+            uint32_t length = reader.readU32();
+            uint32_t checksum = reader.readU32();
+            auto statement = reader.readBytes(length);
+            if (Crc32::compute(statement) != checksum) {
+                break; // A torn write, nothing after it can be trusted
+            }
+            ++sequenceNumber;
+            if (records) {
+                records->push_back({sequenceNumber, std::string(statement)});
+            }
+            intactLength = reader.getPosition();
+        }
+    } catch (const std::runtime_error &) {
+        // The last record was cut short by a crash
+    }
+    if (lastSequence) {
+        *lastSequence = sequenceNumber;
+    }
+    return intactLength;
+}
+
+std::string WriteAheadLog::header(uint64_t baseSequence) {
+    ByteWriter writer;
+    writer.writeBytes(LOG_MAGIC);
+    writer.writeU64(baseSequence);
+    return writer.release();
+}
+
+WriteAheadLog::Durability WriteAheadLog::durabilityFromString(const std::string &value) {
+    if (value == "statement") {
+        return Durability::PER_STATEMENT;
+    } else if (value == "group") {
+        return Durability::GROUP_COMMIT;
+    } else if (value == "async") {
+        return Durability::ASYNC;
+    } else {
+        throw std::invalid_argument("Unknown durability mode: " + value);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "AsyncIo.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Record read back from the log
+struct LogRecord {
+    uint64_t sequenceNumber; // Position in the history of the database, never reused
+    std::string statement;
+};
+
+// Binary log of the statements that changed the database, replayed after a crash.
+// Records are buffered in memory and written by a background flusher in large sequential writes,
+// with one fsync per group of records. With asynchronous I/O a large group goes out as several writes in flight.
+class WriteAheadLog {
+public:
+    enum class Durability {
+        PER_STATEMENT, // Every commit waits for a sync of its own record
+        GROUP_COMMIT, // Commits wait for the next group sync, issued every groupCommitInterval
+        ASYNC, // Commits return at once, the log is synced every groupCommitInterval
+    };
+
+    struct Options {
+        Durability durability = Durability::GROUP_COMMIT;
+        std::chrono::milliseconds groupCommitInterval{5}; // At least 1 ms
+    };
+
+    // Opens the log for appending, drops a torn tail. Without io the flusher writes with blocking calls.
+    // Throws std::invalid_argument when the group commit interval is below 1 ms.
+    WriteAheadLog(std::string filename, Options options, std::shared_ptr<AsyncIo> io = nullptr);
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+    virtual ~WriteAheadLog(); // Syncs every appended record and stops the flusher
+
+    virtual uint64_t append(std::string_view statement); // Buffers a record and returns its sequence number
+    virtual void commit(uint64_t sequenceNumber); // Waits until the record is as durable as the mode requires
+    // Calls done once the record is as durable as the mode requires, without waiting for it. done gets the failure
+    // of the log, empty when the record is durable, and runs on the flusher or right away on the calling thread,
+    // so it must not block.
+    virtual void commitAsync(uint64_t sequenceNumber, std::function<void(const std::string &failure)> done);
+    virtual uint64_t sync(); // Writes and syncs every record appended so far, returns the last sequence number
+    virtual void discardThrough(uint64_t sequenceNumber); // Atomically drops synced records folded into a snapshot
+    [[nodiscard]] virtual uint64_t size(); // Bytes in the log file
+    [[nodiscard]] virtual uint64_t getAppendedSequence(); // Sequence number of the last record, synced or not
+
+    static bool isLog(const std::string &filename); // Checks the file header
+    static std::vector<LogRecord> readRecords(const std::string &filename); // Every intact record
+    static Durability durabilityFromString(const std::string &value);
+
+private:
+    std::string filename;
+    Options options;
+    std::shared_ptr<AsyncIo> io;
+    int fd = -1;
+    uint64_t fileSize = 0; // Where the next group is written
+
+    std::mutex mutex;
+    std::condition_variable flushRequested; // Wakes the flusher
+    std::condition_variable flushed; // Wakes committers waiting for their records
+    std::string buffer; // Encoded records not written yet
+    uint64_t appendedSequence = 0; // Sequence number of the last appended record
+    uint64_t durableSequence = 0; // Sequence number of the last synced record
+    bool urgent = false; // Someone waits for a sync right now
+    bool stopping = false;
+    std::string failure; // Set when a write or sync failed, the log cannot be trusted afterwards
+    // Callbacks of commitAsync by the sequence number they wait for, called by the flusher
+    std::multimap<uint64_t, std::function<void(const std::string &)>> durableCallbacks;
+    std::mutex ioMutex; // Serialises file writes with rewrites of the file
+    std::thread flusher;
+
+    virtual void truncate(size_t size) const; // Cuts the file to size bytes, throws when it cannot
+    virtual void flushLoop();
+    virtual void waitDurable(std::unique_lock<std::mutex> &lock, uint64_t sequenceNumber);
+    // Reads records and returns the length of the intact prefix of the file
+    static size_t scan(std::string_view contents, std::vector<LogRecord> *records, uint64_t *lastSequence);
+    static std::string header(uint64_t baseSequence);
+};
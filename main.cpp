@@ -1,14 +1,99 @@
 #include "Database.h"
 #include "QueryExecutor.h"
 #include "CommandLineInterface.h"
-#include <fmt/core.h>
+#include "QueryClient.h"
+#include <algorithm>
+#include <charconv>
+#include <fmt/color.h>
+#include <stdexcept>
+#include <thread>
 
+// Value of a --flag=value argument as a whole number, throws unless it is one from min to max
+static uint64_t flagNumber(const std::string &argument, uint64_t min, uint64_t max) {
+    std::string_view value = std::string_view(argument).substr(argument.find('=') + 1);
+    uint64_t number = 0;
+    auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), number);
+    if (value.empty() || error != std::errc() || end != value.data() + value.size() || number < min || number > max) {
+        throw std::invalid_argument(fmt::format("expected a whole number from {} to {}", min, max));
+    }
+    return number;
+}
+
+
+int main(int argc, char *argv[]) {
+    WriteAheadLog::Options logOptions;
+    TableStorage::Options storageOptions;
+    std::vector<std::string> scripts;
+    std::string listenAddress;
+    std::string connectAddress;
+    size_t workerCount = std::max(1u, std::thread::hardware_concurrency());
+    size_t schedulerThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        try {
+            if (argument.starts_with("--durability=")) {
+                // statement, group or async
+                logOptions.durability = WriteAheadLog::durabilityFromString(argument.substr(argument.find('=') + 1));
+            } else if (argument.starts_with("--group-commit-ms=")) {
+                logOptions.groupCommitInterval = std::chrono::milliseconds(flagNumber(argument, 1, 60'000));
+            } else if (argument.starts_with("--data-dir=")) {
+                // Directory for the segment files of large tables
+                storageOptions.directory = argument.substr(argument.find('=') + 1);
+            } else if (argument.starts_with("--buffer-pool-mb=")) {
+                // Budget for table pages cached in memory
+                storageOptions.bufferPoolBytes = flagNumber(argument, 1, SIZE_MAX >> 20) << 20;
+            } else if (argument.starts_with("--listen=")) {
+                // Server mode: a Unix socket path or a TCP port on localhost
+                listenAddress = argument.substr(argument.find('=') + 1);
+            } else if (argument.starts_with("--workers=")) {
+                // Threads running the queries of the server
+                workerCount = flagNumber(argument, 1, 1024);
+            } else if (argument.starts_with("--scheduler-threads=")) {
+                // Threads running parallel scans, loading, recovery and submitted queries
+                schedulerThreads = flagNumber(argument, 1, 1024);
+            } else if (argument.starts_with("--connect=")) {
+                // Client mode: console talking to a running server
+                connectAddress = argument.substr(argument.find('=') + 1);
+            } else {
+                scripts.push_back(argument);
+            }
+        } catch (const std::exception &e) {
+            fmt::print(fg(fmt::color::red), "Invalid argument {}: {}\n", argument, e.what());
+            return 1;
+        }
+    }
+
+    if (!connectAddress.empty()) {
+        try {
+            QueryClient client(connectAddress);
+            client.run();
+        } catch (const std::exception &e) {
+            fmt::print(fg(fmt::color::red), "{}\n", e.what());
+            return 1;
+        }
+        return 0;
+    }
+    if (!listenAddress.empty()) {
+        CommandLineInterface::blockStopSignals(); // Before the storage starts its threads
+    }
 
-int main() {
-    auto db = std::make_shared<Database>();
+    auto db = std::make_shared<Database>(std::make_shared<TableStorage>(storageOptions),
+                                         std::make_shared<TaskScheduler>(schedulerThreads));
     auto qe = std::make_shared<QueryExecutor>(db);
-    CommandLineInterface cli(qe);
-    cli.run();
-    return 0;
+    CommandLineInterface cli(qe, db, logOptions);
+
+    if (!listenAddress.empty()) {
+        return cli.serve(listenAddress, workerCount) ? 0 : 1;
+    }
+
+    // Script mode: run the given files one after another and exit
+    if (!scripts.empty()) {
+        for (const auto &script: scripts) {
+            cli.loadQueries(script);
+        }
+        return 0;
+    }
+
+    return cli.run() ? 0 : 1;
 }
 
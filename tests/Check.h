@@ -0,0 +1,25 @@
+#pragma once
+
+#include <fmt/color.h>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+// Fails the running check with the message unless the condition holds
+inline void check(bool condition, const std::string &message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+// Runs one named check of a test program, returns whether it passed
+inline bool runCheck(const std::string &name, const std::function<void()> &body) {
+    try {
+        body();
+    } catch (const std::exception &e) {
+        fmt::print(fg(fmt::color::red), "{} failed: {}\n", name, e.what());
+        return false;
+    }
+    fmt::print(fg(fmt::color::green), "{} passed\n", name);
+    return true;
+}
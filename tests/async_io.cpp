@@ -0,0 +1,115 @@
+#include "Check.h"
+#include "PwriteIo.h"
+#include "UringIo.h"
+#include <fcntl.h>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+static constexpr auto FILENAME = "async_io.data";
+
+static std::string readFile() {
+    std::ifstream file(FILENAME, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Bytes that differ from chunk to chunk, so a chunk written at the wrong offset shows
+static std::string pattern(size_t size, char seed) {
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<char>(seed + i / 4093 + i);
+    }
+    return data;
+}
+
+// A write of many chunks, more than are kept in flight, and one shorter than a chunk land at their offsets
+static void chunkedWriteLands(AsyncIo &io) {
+    int fd = ::open(FILENAME, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    check(fd >= 0, "Cannot open the data file");
+    std::string large = pattern(AsyncIo::CHUNK_SIZE * (AsyncIo::MAX_IN_FLIGHT * 2 + 1) + 123, 'a');
+    std::string small = pattern(1000, 'z');
+    io.write(fd, small, 0);
+    io.write(fd, large, small.size());
+    io.sync(fd);
+    ::close(fd);
+    check(readFile() == small + large, "The file holds other bytes than were written");
+}
+
+// Threads submitting at once all get their writes done, none of them is lost or written over
+static void concurrentSubmitsLand(AsyncIo &io) {
+    constexpr size_t THREADS = 8;
+    constexpr size_t WRITES = 100;
+    constexpr size_t SIZE = 4096;
+    int fd = ::open(FILENAME, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    check(fd >= 0, "Cannot open the data file");
+    std::vector<std::string> blocks;
+    for (size_t i = 0; i < THREADS * WRITES; ++i) {
+        blocks.push_back(pattern(SIZE, static_cast<char>(i)));
+    }
+    std::vector<std::thread> threads;
+    for (size_t thread = 0; thread < THREADS; ++thread) {
+        threads.emplace_back([&, thread] {
+            std::vector<std::future<void>> writes;
+            for (size_t i = thread; i < blocks.size(); i += THREADS) {
+                writes.push_back(io.submitWrite(fd, blocks[i], i * SIZE));
+            }
+            for (auto &write: writes) {
+                write.get();
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    io.sync(fd);
+    ::close(fd);
+
+    std::string contents = readFile();
+    check(contents.size() == blocks.size() * SIZE, fmt::format("The file has {} bytes", contents.size()));
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        check(contents.compare(i * SIZE, SIZE, blocks[i]) == 0, fmt::format("Block {} changed", i));
+    }
+}
+
+// A write the system refuses fails its future instead of being reported as done
+static void failedWriteThrows(AsyncIo &io) {
+    int fd = ::open(FILENAME, O_RDONLY | O_CREAT, 0644);
+    check(fd >= 0, "Cannot open the data file");
+    bool failed = false;
+    try {
+        io.write(fd, pattern(AsyncIo::CHUNK_SIZE * 3, 'a'), 0);
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    ::close(fd);
+    check(failed, "A write to a read-only descriptor succeeded");
+}
+
+// Runs the checks against one backend
+static bool checkBackend(const std::string &name, AsyncIo &io) {
+    bool passed = runCheck(name + ": chunked write lands", [&] { chunkedWriteLands(io); });
+    passed &= runCheck(name + ": concurrent submits land", [&] { concurrentSubmitsLand(io); });
+    passed &= runCheck(name + ": failed write throws", [&] { failedWriteThrows(io); });
+    std::filesystem::remove(FILENAME);
+    return passed;
+}
+
+int main() {
+    PwriteIo pwriteIo;
+    bool passed = checkBackend("pwrite", pwriteIo);
+    std::unique_ptr<UringIo> uringIo;
+    try {
+        uringIo = std::make_unique<UringIo>();
+    } catch (const std::runtime_error &e) {
+        fmt::print(fg(fmt::color::yellow), "io_uring skipped: {}\n", e.what());
+    }
+    if (uringIo) {
+        passed &= checkBackend("io_uring", *uringIo);
+    }
+    return passed ? 0 : 1;
+}
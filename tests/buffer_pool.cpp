@@ -0,0 +1,95 @@
+#include "Check.h"
+#include "BufferPool.h"
+#include <atomic>
+#include <fmt/format.h>
+#include <future>
+#include <thread>
+
+static constexpr size_t PAGE_ROWS = 100;
+
+// Decoded page of empty rows, every page takes the same memory
+static std::shared_ptr<std::vector<Row>> page() {
+    return std::make_shared<std::vector<Row>>(PAGE_ROWS);
+}
+
+static const size_t PAGE_BYTES = BufferPool::estimateBytes(*page());
+
+// A copy decoded for a newer schema while the cached page is pinned takes memory of its own, given back with its pin
+static void privateCopyIsCharged() {
+    BufferPool pool(10 * PAGE_BYTES);
+    auto id = std::make_shared<Column>("ID", DataType::INTEGER);
+    auto name = std::make_shared<Column>("NAME", DataType::TEXT);
+    std::vector<std::shared_ptr<Column>> oldColumns{id};
+    std::vector<std::shared_ptr<Column>> newColumns{id, name};
+
+    auto cached = pool.pin(1, oldColumns, page, PAGE_BYTES);
+    {
+        auto copy = pool.pin(1, newColumns, page, PAGE_BYTES);
+        check(pool.getUsedBytes() == 2 * PAGE_BYTES,
+              fmt::format("The pool counts {} bytes for two pages of {}", pool.getUsedBytes(), PAGE_BYTES));
+    }
+    check(pool.getUsedBytes() == PAGE_BYTES, "The copy was not given back with its pin");
+}
+
+// Room for a page is reserved before it is decoded, so a second reader of a full pool waits instead of decoding
+// next to it, and goes on once the first page is unpinned
+static void decodeReservesRoom() {
+    BufferPool pool(PAGE_BYTES);
+    std::promise<void> decoding;
+    std::promise<void> release;
+    std::thread first([&, gate = release.get_future().share()] {
+        auto pinned = pool.pin(1, {}, [&] {
+            decoding.set_value();
+            gate.wait();
+            return page();
+        }, PAGE_BYTES);
+    });
+    decoding.get_future().wait();
+    check(pool.getUsedBytes() == PAGE_BYTES, "The decode in flight is not counted");
+
+    std::atomic<bool> secondDecoded = false;
+    auto second = std::async(std::launch::async, [&] {
+        auto pinned = pool.pin(2, {}, [&] {
+            secondDecoded = true;
+            return page();
+        }, PAGE_BYTES);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    bool decodedMeanwhile = secondDecoded;
+    release.set_value();
+    first.join();
+    second.get();
+    check(!decodedMeanwhile, "The second page was decoded while the first one took the whole budget");
+    check(secondDecoded, "The second page was never decoded");
+    check(pool.getOverdraftCount() == 0, "The budget was exceeded");
+    check(pool.getUsedBytes() <= pool.getBudget(), "The pool holds more than its budget");
+}
+
+// A reader that finds only pinned pages waits for an unpin instead of failing
+static void readerWaitsForUnpin() {
+    BufferPool pool(PAGE_BYTES);
+    std::optional<PinnedRows> held = pool.pin(1, {}, page, PAGE_BYTES);
+    auto reader = std::async(std::launch::async, [&] { (void) pool.pin(2, {}, page, PAGE_BYTES); });
+    bool waited = reader.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout;
+    held.reset();
+    reader.get();
+    check(waited, "The reader did not wait for the pinned page");
+    check(pool.getOverdraftCount() == 0, "The budget was exceeded");
+}
+
+// A reader holding the only pinned page cannot wait for itself, after a while its page is let in over the budget
+static void waitingReaderOverdraws() {
+    BufferPool pool(PAGE_BYTES);
+    auto held = pool.pin(1, {}, page, PAGE_BYTES);
+    auto second = pool.pin(2, {}, page, PAGE_BYTES);
+    check(pool.getOverdraftCount() == 1, fmt::format("{} overdrafts instead of 1", pool.getOverdraftCount()));
+    check((*second).size() == PAGE_ROWS, "The page let in over the budget lost rows");
+}
+
+int main() {
+    bool passed = runCheck("Private copy is charged", privateCopyIsCharged);
+    passed &= runCheck("Decode reserves room", decodeReservesRoom);
+    passed &= runCheck("Reader waits for unpin", readerWaitsForUnpin);
+    passed &= runCheck("Waiting reader overdraws", waitingReaderOverdraws);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,4 @@
+CREATE TABLE small (ID INTEGER PRIMARY_KEY, N TEXT);
+INSERT INTO small (ID, N) VALUES (1, 'a');
+INSERT INTO small (ID, N) VALUES (2, 'b');
+INSERT INTO small (ID, N) VALUES (3, 'c');
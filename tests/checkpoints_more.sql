@@ -0,0 +1,2 @@
+INSERT INTO s (ID, V) VALUES (5001, '7');
+INSERT INTO s (ID, V) VALUES (5002, '8');
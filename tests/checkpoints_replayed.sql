@@ -0,0 +1,2 @@
+SELECT COUNT(*), MAX(ID) FROM s;
+SELECT COUNT(*), MAX(ID) FROM small;
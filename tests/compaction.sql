@@ -0,0 +1,3 @@
+CREATE TABLE kept (ID INTEGER PRIMARY_KEY, N TEXT);
+INSERT INTO kept (ID, N) VALUES (1, 'a');
+INSERT INTO kept (ID, N) VALUES (2, 'b');
@@ -0,0 +1,262 @@
+#include "Check.h"
+#include "QueryExecutor.h"
+#include "Recovery.h"
+#include <atomic>
+#include <filesystem>
+#include <fmt/format.h>
+#include <thread>
+
+static constexpr auto LOG_FILENAME = "concurrency.franekql";
+
+// Log that counts the waits for durability, blocking or not
+class CountingLog : public WriteAheadLog {
+public:
+    std::atomic<size_t> commits = 0;
+
+    using WriteAheadLog::WriteAheadLog;
+
+    void commit(uint64_t sequenceNumber) override {
+        ++commits;
+        WriteAheadLog::commit(sequenceNumber);
+    }
+
+    void commitAsync(uint64_t sequenceNumber, std::function<void(const std::string &)> done) override {
+        ++commits;
+        WriteAheadLog::commitAsync(sequenceNumber, std::move(done));
+    }
+};
+
+// Log that refuses every statement containing the given text
+class RefusingLog : public WriteAheadLog {
+public:
+    std::string refused;
+
+    using WriteAheadLog::WriteAheadLog;
+
+    uint64_t append(std::string_view statement) override {
+        if (!refused.empty() && statement.find(refused) != std::string_view::npos) {
+            throw std::runtime_error("The log refused " + std::string(statement));
+        }
+        return WriteAheadLog::append(statement);
+    }
+};
+
+// Number in the only cell of the result
+static size_t count(QueryExecutor &executor, const std::string &query) {
+    QueryResult result = executor.executeQuery(query);
+    check(result.rows.size() == 1 && result.rows[0].size() == 1, "Expected one value from " + query);
+    return std::stoul(result.rows[0][0]);
+}
+
+// Inserts queued while the blocking pool is busy run as one batch that waits for the log once. Every outcome is ready
+// only when its record is durable, and duplicate keys fail on their own without holding back the others.
+static void submittedInsertsShareOneCommit() {
+    std::filesystem::remove(LOG_FILENAME);
+    auto scheduler = std::make_shared<TaskScheduler>(1);
+    auto database = std::make_shared<Database>(nullptr, scheduler);
+    auto log = std::make_shared<CountingLog>(LOG_FILENAME, WriteAheadLog::Options{});
+    QueryExecutor executor(database);
+    executor.setWriteAheadLog(log);
+    executor.executeQuery("CREATE TABLE t (ID INTEGER PRIMARY_KEY, N INTEGER);");
+    log->commits = 0;
+
+    // The only thread of the blocking pool waits until every query is queued
+    std::promise<void> started;
+    std::promise<void> release;
+    auto blocked = database->getBlockingPool().submit([&started, gate = release.get_future().share()] {
+        started.set_value();
+        gate.wait();
+    });
+    started.get_future().wait();
+    constexpr size_t QUERIES = 1000;
+    constexpr size_t KEYS = 800;
+    std::vector<std::future<QueryOutcome>> outcomes;
+    for (size_t i = 0; i < QUERIES; ++i) {
+        outcomes.push_back(executor.submit(fmt::format("INSERT INTO t (ID, N) VALUES ({}, {});", i % KEYS, i)));
+    }
+    release.set_value();
+    blocked.get();
+
+    size_t inserted = 0;
+    size_t duplicates = 0;
+    for (auto &outcome: outcomes) {
+        auto value = outcome.get();
+        if (std::holds_alternative<QueryResult>(value)) {
+            ++inserted;
+        } else if (std::get<QueryError>(value).stage == QueryError::Stage::EXECUTION) {
+            ++duplicates;
+        }
+    }
+    check(inserted == KEYS && duplicates == QUERIES - KEYS,
+          fmt::format("{} inserts and {} duplicates instead of {} and {}", inserted, duplicates, KEYS, QUERIES - KEYS));
+    check(log->commits == 1, fmt::format("The batch waited for the log {} times", log->commits.load()));
+    // The CREATE TABLE and every insert that succeeded
+    check(WriteAheadLog::readRecords(LOG_FILENAME).size() == KEYS + 1, "Records are missing from the log");
+    check(count(executor, "SELECT COUNT(*) FROM t;") == KEYS, "Rows are missing from the table");
+    // Queries of one executor run in the order they were submitted, the first of each key wins
+    check(count(executor, "SELECT MAX(N) FROM t;") == KEYS - 1, "A later duplicate replaced an earlier row");
+    std::filesystem::remove(LOG_FILENAME);
+}
+
+// Submitted queries hold no worker of the scheduler, so they finish while every worker is busy
+static void submittedQueriesLeaveSchedulerFree() {
+    auto scheduler = std::make_shared<TaskScheduler>(1);
+    auto database = std::make_shared<Database>(nullptr, scheduler);
+    QueryExecutor executor(database);
+    executor.executeQuery("CREATE TABLE t (ID INTEGER PRIMARY_KEY);");
+
+    std::promise<void> started;
+    std::promise<void> release;
+    auto blocked = scheduler->submit([&started, gate = release.get_future().share()] {
+        started.set_value();
+        gate.wait();
+    });
+    started.get_future().wait();
+    auto outcome = executor.submit("INSERT INTO t (ID) VALUES (1);");
+    bool finished = outcome.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    release.set_value();
+    blocked.get();
+    check(finished, "The submitted insert waited for the scheduler");
+    check(std::holds_alternative<QueryResult>(outcome.get()), "The submitted insert failed");
+}
+
+// Sessions on their own threads insert into one table at once, the ranges of neighbouring ones overlap.
+// Every key goes in exactly once, and the log replays into the same rows.
+static void concurrentInsertsKeepKeysUnique() {
+    std::filesystem::remove(LOG_FILENAME);
+    constexpr size_t SESSIONS = 4;
+    constexpr size_t STRIDE = 250;
+    constexpr size_t PER_SESSION = 300;
+    auto database = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(SESSIONS));
+    QueryExecutor executor(database);
+    executor.setWriteAheadLog(std::make_shared<WriteAheadLog>(LOG_FILENAME, WriteAheadLog::Options{}));
+    executor.executeQuery("CREATE TABLE t (ID INTEGER PRIMARY_KEY, SESSION INTEGER);");
+
+    std::atomic<size_t> inserted = 0;
+    std::atomic<size_t> duplicates = 0;
+    std::vector<std::thread> threads;
+    for (size_t session = 0; session < SESSIONS; ++session) {
+        threads.emplace_back([&, session, executor = executor.newSession()] {
+            for (size_t id = session * STRIDE; id < session * STRIDE + PER_SESSION; ++id) {
+                try {
+                    executor->executeQuery(fmt::format("INSERT INTO t (ID, SESSION) VALUES ({}, {});", id, session));
+                    ++inserted;
+                } catch (const std::exception &) {
+                    ++duplicates;
+                }
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    constexpr size_t KEYS = (SESSIONS - 1) * STRIDE + PER_SESSION;
+    check(inserted == KEYS && duplicates == SESSIONS * PER_SESSION - KEYS,
+          fmt::format("{} inserts and {} duplicates instead of {} and {}", inserted.load(), duplicates.load(), KEYS,
+                      SESSIONS * PER_SESSION - KEYS));
+    check(count(executor, "SELECT COUNT(*) FROM t;") == KEYS, "Rows are missing from the table");
+
+    auto recovered = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(SESSIONS));
+    RecoveryResult result = Recovery::restore(recovered, "", LOG_FILENAME);
+    check(result.replayed == KEYS + 1 && result.failed == 0,
+          fmt::format("{} records replayed and {} failed", result.replayed, result.failed));
+    QueryExecutor replayed(recovered);
+    check(count(replayed, "SELECT COUNT(*) FROM t;") == KEYS, "Rows are missing after the replay");
+    // The session that won a key is the same after the replay
+    check(count(replayed, "SELECT SUM(SESSION) FROM t;") == count(executor, "SELECT SUM(SESSION) FROM t;"),
+          "The replay kept other rows of the overlapping keys");
+    std::filesystem::remove(LOG_FILENAME);
+}
+
+// A unique index is built while another session keeps inserting. Rows added before the build and rows added while
+// it ran are both in the index, so a second row with any of their values is refused.
+static void indexBuildSeesConcurrentInserts() {
+    constexpr size_t PRELOADED = 10000;
+    auto database = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(4));
+    QueryExecutor executor(database);
+    executor.executeQuery("CREATE TABLE t (ID INTEGER PRIMARY_KEY, EMAIL TEXT);");
+    for (size_t id = 0; id < PRELOADED; ++id) {
+        executor.executeQuery(fmt::format("INSERT INTO t (ID, EMAIL) VALUES ({}, 'user{}');", id, id));
+    }
+
+    std::atomic<bool> built = false;
+    std::atomic<size_t> insertedBeforeBuilt = 0;
+    size_t inserted = 0;
+    std::string failure;
+    std::thread inserter([&, session = executor.newSession()] {
+        try {
+            // Keeps going for a while after the build so the last inserts check against the index
+            size_t afterBuilt = 0;
+            for (size_t id = PRELOADED; afterBuilt < 100; ++id, ++inserted) {
+                session->executeQuery(fmt::format("INSERT INTO t (ID, EMAIL) VALUES ({}, 'user{}');", id, id));
+                if (built) {
+                    ++afterBuilt;
+                } else {
+                    insertedBeforeBuilt = inserted + 1;
+                }
+            }
+        } catch (const std::exception &e) {
+            failure = e.what();
+        }
+    });
+    executor.executeQuery("CREATE UNIQUE INDEX ON t (EMAIL);");
+    built = true;
+    inserter.join();
+    check(failure.empty(), "An insert failed during the build: " + failure);
+    check(count(executor, "SELECT COUNT(*) FROM t;") == PRELOADED + inserted, "Rows are missing from the table");
+
+    // Every tenth row, the last one added before the build finished and the first one after it
+    std::vector<size_t> taken;
+    for (size_t id = 0; id < PRELOADED + inserted; id += 10) {
+        taken.push_back(id);
+    }
+    taken.push_back(PRELOADED + insertedBeforeBuilt - 1);
+    taken.push_back(PRELOADED + insertedBeforeBuilt);
+    size_t nextId = PRELOADED + inserted;
+    for (size_t id: taken) {
+        bool refused = false;
+        try {
+            executor.executeQuery(fmt::format("INSERT INTO t (ID, EMAIL) VALUES ({}, 'user{}');", nextId, id));
+        } catch (const std::exception &) {
+            refused = true;
+        }
+        check(refused, fmt::format("A second row with EMAIL user{} was accepted", id));
+    }
+}
+
+// An index build whose statement cannot be logged leaves the column without the index and without UNIQUE,
+// so the table stays the same as the log replays it. The statement can be run again.
+static void unloggedIndexBuildIsDropped() {
+    std::filesystem::remove(LOG_FILENAME);
+    auto database = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(2));
+    auto log = std::make_shared<RefusingLog>(LOG_FILENAME, WriteAheadLog::Options{});
+    QueryExecutor executor(database);
+    executor.setWriteAheadLog(log);
+    executor.executeQuery("CREATE TABLE t (ID INTEGER PRIMARY_KEY, EMAIL TEXT);");
+    executor.executeQuery("INSERT INTO t (ID, EMAIL) VALUES (1, 'a');");
+
+    log->refused = "INDEX";
+    bool failed = false;
+    try {
+        executor.executeQuery("CREATE UNIQUE INDEX ON t (EMAIL);");
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    check(failed, "The index was created without its log record");
+
+    // Neither the index nor the build is left behind, so the statement runs again once the log takes it
+    log->refused.clear();
+    executor.executeQuery("CREATE UNIQUE INDEX ON t (EMAIL);");
+    check(WriteAheadLog::readRecords(LOG_FILENAME).size() == 3, "The index is missing from the log");
+    std::filesystem::remove(LOG_FILENAME);
+}
+
+int main() {
+    bool passed = runCheck("Submitted inserts share one commit", submittedInsertsShareOneCommit);
+    passed &= runCheck("Submitted queries leave the scheduler free", submittedQueriesLeaveSchedulerFree);
+    passed &= runCheck("Concurrent inserts keep keys unique", concurrentInsertsKeepKeysUnique);
+    passed &= runCheck("Index build sees concurrent inserts", indexBuildSeesConcurrentInserts);
+    passed &= runCheck("Unlogged index build is dropped", unloggedIndexBuildIsDropped);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1 @@
+SELECT COUNT(*), MAX(ID) FROM kept;
@@ -0,0 +1,14 @@
+CREATE TABLE d (ID INTEGER PRIMARY_KEY, CITY TEXT, AGE INTEGER);
+INSERT INTO d (ID, CITY, AGE) VALUES (1, 'a', 20);
+INSERT INTO d (ID, CITY, AGE) VALUES (2, 'b', 30);
+INSERT INTO d (ID, CITY, AGE) VALUES (3, 'a', 20);
+INSERT INTO d (ID, AGE) VALUES (4, 20);
+INSERT INTO d (ID) VALUES (5);
+INSERT INTO d (ID, CITY) VALUES (6, 'a');
+INSERT INTO d (ID) VALUES (7);
+INSERT INTO d (ID, CITY, AGE) VALUES (8, 'b', 30);
+SELECT DISTINCT CITY, AGE FROM d ORDER BY CITY, AGE;
+SELECT DISTINCT CITY FROM d ORDER BY CITY DESC LIMIT 2;
+SELECT DISTINCT AGE FROM d ORDER BY AGE LIMIT 2 OFFSET 1;
+SELECT APPROX_COUNT_DISTINCT(CITY), APPROX_COUNT_DISTINCT(AGE) FROM d;
+SELECT APPROX_COUNT_DISTINCT(T), APPROX_COUNT_DISTINCT(V), APPROX_COUNT_DISTINCT(ID) FROM s;
@@ -0,0 +1,16 @@
+CREATE TABLE t (ID INTEGER PRIMARY_KEY, N TEXT UNIQUE);
+INSERT INTO t (ID, N) VALUES (1, 'a');
+INSERT INTO t (ID, N) VALUES (1, 'b');
+INSERT INTO t (ID, N) VALUES (2, 'a');
+INSERT INTO t (ID, N) VALUES (2, 'b');
+BEGIN;
+INSERT INTO t (ID, N) VALUES (3, 'c');
+INSERT INTO t (ID, N) VALUES (3, 'd');
+COMMIT;
+BEGIN;
+INSERT INTO t (ID, N) VALUES (3, 'c');
+INSERT INTO t (ID, N) VALUES (4, 'a');
+COMMIT;
+INSERT INTO t (ID, N) VALUES (3, 'c');
+INSERT INTO t (ID, N) VALUES (4, 'c');
+SELECT COUNT(*), MAX(ID) FROM t;
@@ -0,0 +1,22 @@
+CREATE TABLE parent (ID INTEGER PRIMARY_KEY, NAME TEXT);
+CREATE TABLE child (ID INTEGER PRIMARY_KEY, PARENT INTEGER, FOREIGN_KEY PARENT REFERENCES parent ID);
+CREATE TABLE node (ID INTEGER PRIMARY_KEY, UP INTEGER);
+ALTER TABLE node ADD FOREIGN_KEY UP REFERENCES node ID;
+INSERT INTO child (ID, PARENT) VALUES (10, 1);
+INSERT INTO parent (ID, NAME) VALUES (1, 'p1');
+INSERT INTO child (ID, PARENT) VALUES (10, 1);
+INSERT INTO node (ID, UP) VALUES (1, NULL);
+INSERT INTO parent (ID, NAME) VALUES (2, 'p2');
+INSERT INTO node (ID, UP) VALUES (2, 1);
+INSERT INTO child (ID, PARENT) VALUES (11, 2);
+INSERT INTO node (ID, UP) VALUES (3, 2);
+INSERT INTO child (ID, PARENT) VALUES (12, 2);
+INSERT INTO node (ID, UP) VALUES (4, 5);
+CREATE TABLE a (ID INTEGER PRIMARY_KEY, B INTEGER);
+CREATE TABLE b (ID INTEGER PRIMARY_KEY, A INTEGER, FOREIGN_KEY A REFERENCES a ID);
+ALTER TABLE a ADD FOREIGN_KEY B REFERENCES b ID;
+INSERT INTO a (ID, B) VALUES (1, NULL);
+INSERT INTO b (ID, A) VALUES (1, 1);
+INSERT INTO a (ID, B) VALUES (2, 1);
+INSERT INTO b (ID, A) VALUES (2, 2);
+INSERT INTO a (ID, B) VALUES (3, 3);
@@ -0,0 +1,6 @@
+SELECT COUNT(*), SUM(PARENT) FROM child;
+SELECT COUNT(*), SUM(UP) FROM node;
+SELECT COUNT(*), SUM(B) FROM a;
+SELECT COUNT(*), SUM(A) FROM b;
+INSERT INTO child (ID, PARENT) VALUES (13, 9);
+INSERT INTO a (ID, B) VALUES (4, 9);
@@ -0,0 +1,9 @@
+CREATE TABLE g (ID INTEGER PRIMARY_KEY, K TEXT, V INTEGER);
+INSERT INTO g (ID, K, V) VALUES (1, 'a', 10);
+INSERT INTO g (ID, K, V) VALUES (2, 'a', 20);
+INSERT INTO g (ID, V) VALUES (3, 5);
+INSERT INTO g (ID, V) VALUES (4, 7);
+INSERT INTO g (ID, K) VALUES (5, 'b');
+SELECT K, COUNT(*), COUNT(V), SUM(V) FROM g GROUP BY K ORDER BY K;
+SELECT COUNT(*), COUNT(V), SUM(V), MAX(V) FROM g WHERE ID > 5;
+SELECT K, SUM(V) FROM g GROUP BY K ORDER BY SUM(V) DESC;
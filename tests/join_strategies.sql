@@ -0,0 +1,21 @@
+CREATE TABLE a (ID INTEGER PRIMARY_KEY, X INTEGER);
+CREATE TABLE b (ID INTEGER PRIMARY_KEY, Y INTEGER);
+INSERT INTO a (ID, X) VALUES (1, 1);
+INSERT INTO a (ID, X) VALUES (2, 2);
+INSERT INTO a (ID, X) VALUES (3, 3);
+INSERT INTO a (ID, X) VALUES (4, 4);
+INSERT INTO a (ID, X) VALUES (5, 5);
+INSERT INTO a (ID, X) VALUES (6, 6);
+INSERT INTO b (ID, Y) VALUES (2, 2);
+INSERT INTO b (ID, Y) VALUES (3, 3);
+INSERT INTO b (ID, Y) VALUES (4, 4);
+INSERT INTO b (ID, Y) VALUES (5, 5);
+INSERT INTO b (ID, Y) VALUES (6, 6);
+INSERT INTO b (ID, Y) VALUES (7, 7);
+INSERT INTO b (ID, Y) VALUES (8, 8);
+INSERT INTO b (ID, Y) VALUES (9, 9);
+SELECT a.ID, b.Y FROM a JOIN b ON a.ID = b.ID WHERE a.X <> 5 ORDER BY a.ID;
+SELECT a.ID, b.Y FROM a JOIN b ON a.X = b.ID WHERE a.X <> 5 ORDER BY a.ID;
+SELECT a.ID, b.Y FROM a JOIN b ON a.X = b.Y WHERE a.X <> 5 ORDER BY a.ID;
+SELECT COUNT(*) FROM a WHERE a.X <> 5;
+SELECT COUNT(*) FROM a WHERE b.Y <> 5;
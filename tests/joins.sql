@@ -0,0 +1,20 @@
+CREATE TABLE dept (ID INTEGER PRIMARY_KEY, NAME TEXT);
+CREATE TABLE emp (ID INTEGER PRIMARY_KEY, NAME TEXT, DEPT INTEGER, FOREIGN_KEY DEPT REFERENCES dept ID);
+CREATE TABLE tag (ID INTEGER PRIMARY_KEY, DEPT INTEGER, LABEL TEXT);
+INSERT INTO dept (ID, NAME) VALUES (1, 'sales');
+INSERT INTO dept (ID, NAME) VALUES (2, 'ops');
+INSERT INTO dept (ID, NAME) VALUES (3, 'empty');
+INSERT INTO emp (ID, NAME, DEPT) VALUES (10, 'ann', 1);
+INSERT INTO emp (ID, NAME, DEPT) VALUES (11, 'bob', 2);
+INSERT INTO emp (ID, NAME, DEPT) VALUES (12, 'cid', 1);
+INSERT INTO emp (ID, NAME) VALUES (13, 'dan');
+INSERT INTO tag (ID, DEPT, LABEL) VALUES (1, 1, 'x');
+INSERT INTO tag (ID, DEPT, LABEL) VALUES (2, 1, 'y');
+INSERT INTO tag (ID, DEPT, LABEL) VALUES (3, 2, 'z');
+INSERT INTO tag (ID, DEPT, LABEL) VALUES (4, 9, 'w');
+SELECT emp.NAME, dept.NAME FROM emp JOIN dept ON emp.DEPT = dept.ID ORDER BY emp.ID;
+SELECT emp.NAME, dept.NAME FROM dept JOIN emp ON dept.ID = emp.DEPT ORDER BY emp.ID;
+SELECT emp.NAME, LABEL FROM emp JOIN tag ON emp.DEPT = tag.DEPT ORDER BY emp.ID, LABEL;
+SELECT * FROM dept JOIN tag ON dept.ID = tag.DEPT WHERE LABEL <> 'x' ORDER BY tag.ID;
+SELECT COUNT(*) FROM emp JOIN dept ON emp.DEPT = dept.ID WHERE dept.NAME = 'sales';
+SELECT NAME FROM emp JOIN dept ON emp.DEPT = dept.ID;
@@ -0,0 +1,4 @@
+CREATE TABLE t (ID INTEGER PRIMARY_KEY);
+INSERT INTO t (ID) VALUES (1);
+BEGIN;
+INSERT INTO t (ID) VALUES (2);
@@ -0,0 +1 @@
+SELECT COUNT(*), SUM(ID) FROM t;
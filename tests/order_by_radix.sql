@@ -0,0 +1,14 @@
+CREATE TABLE n (ID INTEGER PRIMARY_KEY, V INTEGER, D DATE, T DATETIME);
+INSERT INTO n (ID, V, D, T) VALUES (1, '-5', '2024-03-01', '2024-03-01T10:00:00');
+INSERT INTO n (ID, V, D, T) VALUES (2, '-7', '1999-12-31', '1999-12-31T23:59:59');
+INSERT INTO n (ID) VALUES (3);
+INSERT INTO n (ID, V, D, T) VALUES (4, 0, '2024-02-29', '2024-03-01T09:59:59');
+INSERT INTO n (ID, V, D, T) VALUES (5, 12, '1970-01-01', '2000-01-01T00:00:00');
+INSERT INTO n (ID, V, D, T) VALUES (6, '-2147483648', '2024-12-01', '1999-12-31T23:59:58');
+INSERT INTO n (ID, V, D, T) VALUES (7, 2147483647, '1900-01-01', '2024-03-01T10:00:01');
+SELECT ID FROM n ORDER BY V;
+SELECT ID FROM n ORDER BY V DESC;
+SELECT ID FROM n ORDER BY D;
+SELECT ID FROM n ORDER BY T DESC;
+SELECT ID FROM n ORDER BY D DESC;
+SELECT ID FROM n ORDER BY T;
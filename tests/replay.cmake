@@ -0,0 +1,17 @@
+# Runs SCRIPT in the console, which logs what it commits, then starts the console again to recover from the log
+# and run CHECK. Both run in WORK_DIR, emptied first so that no older log is replayed.
+# STEPS, console lines separated by |, run in between, each in a console of its own: it recovers, runs the line
+# and quits, which waits for a checkpoint or compaction the line started.
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+string(REPLACE ";" "\\;" steps "${STEPS}") # Semicolons of the queries stay in their lines
+string(REPLACE "|" ";" steps "${steps}")
+foreach (line IN ITEMS "\\d ${SCRIPT}" ${steps} "\\d ${CHECK}")
+    file(WRITE ${WORK_DIR}/input "${line}\n\\q\n")
+    execute_process(COMMAND ${PJC} WORKING_DIRECTORY ${WORK_DIR} INPUT_FILE ${WORK_DIR}/input
+                    OUTPUT_VARIABLE output ERROR_VARIABLE output RESULT_VARIABLE result)
+    message("${output}")
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "${PJC} exited with ${result} running ${line}")
+    endif ()
+endforeach ()
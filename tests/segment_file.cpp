@@ -0,0 +1,80 @@
+#include "Check.h"
+#include "QueryExecutor.h"
+#include "TableSegment.h"
+#include <fmt/format.h>
+
+// Storage whose segment files cannot be created while failing is set
+class FailingStorage : public TableStorage {
+public:
+    bool failing = true;
+
+    using TableStorage::TableStorage;
+
+    [[nodiscard]] std::unique_ptr<SegmentFile> createFile() const override {
+        if (failing) {
+            throw std::runtime_error("No space left on device");
+        }
+        return TableStorage::createFile();
+    }
+};
+
+// Pages read back as they were written, and all of them share the mapping of one window
+static void pagesShareOneWindow() {
+    SegmentFile file(".");
+    std::vector<PageLocation> locations;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        locations.push_back(file.writePage(i, fmt::format("page {}", i)));
+    }
+    std::vector<std::shared_ptr<SegmentPage>> pages;
+    for (const auto &location: locations) {
+        pages.push_back(file.mapPage(location));
+    }
+    check(file.getMappingCount() == 1, fmt::format("{} pages took {} mappings", pages.size(), file.getMappingCount()));
+
+    for (uint32_t i = 0; i < pages.size(); ++i) {
+        uint32_t rowCount = 0;
+        auto payload = SegmentFile::pagePayload(pages[i]->view(), rowCount);
+        check(rowCount == i && payload == fmt::format("page {}", i), fmt::format("Page {} changed", i));
+    }
+}
+
+// A table whose segments cannot be written keeps them in memory and tries again only once another segment is full,
+// then writes all of them
+static void failedSpillWaitsForNextSegment() {
+    auto storage = std::make_shared<FailingStorage>(TableStorage::Options{});
+    auto database = std::make_shared<Database>(storage, std::make_shared<TaskScheduler>(2));
+    QueryExecutor executor(database);
+    executor.executeQuery("CREATE TABLE t (ID INTEGER PRIMARY_KEY);");
+    auto table = database->getTables().at("t");
+    auto insertSegment = [&](size_t segment) {
+        for (size_t id = segment * TableSegment::CAPACITY; id < (segment + 1) * TableSegment::CAPACITY; ++id) {
+            executor.executeQuery(fmt::format("INSERT INTO t (ID) VALUES ({});", id));
+        }
+    };
+
+    insertSegment(0);
+    insertSegment(1);
+    check(table->getUnspilledSegmentCount() == 2,
+          fmt::format("{} segments wait for a spill instead of 2", table->getUnspilledSegmentCount()));
+
+    storage->failing = false;
+    table->sealFullSegments();
+    check(table->getUnspilledSegmentCount() == 2, "The spill was tried again before another segment filled up");
+
+    insertSegment(2);
+    check(table->getUnspilledSegmentCount() == 0,
+          fmt::format("{} segments are still not written", table->getUnspilledSegmentCount()));
+    for (const auto &segment: table->getSegments()) {
+        check(segment->isSpilled() || !segment->isFull(), "A full segment was not written");
+    }
+    QueryResult result = executor.executeQuery("SELECT COUNT(*), MAX(ID) FROM t;");
+    check(result.rows == std::vector<std::vector<std::string>>{{fmt::format("{}", 3 * TableSegment::CAPACITY),
+                                                                fmt::format("{}", 3 * TableSegment::CAPACITY - 1)}},
+          "Rows are missing after the spill");
+}
+
+int main() {
+    bool passed = runCheck("Pages share one window", pagesShareOneWindow);
+    passed &= runCheck("Failed spill waits for the next segment", failedSpillWaitsForNextSegment);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+SELECT ID FROM s LIMIT 3;
+SELECT ID, V FROM s WHERE V IS_NULL LIMIT 2 OFFSET 15;
+SELECT ID FROM s LIMIT 4 OFFSET 4094;
+SELECT ID FROM s LIMIT 3 OFFSET 5000;
+SELECT ID FROM s LIMIT 10 OFFSET 4998;
+CREATE TABLE k (ID INTEGER PRIMARY_KEY, V INTEGER);
+INSERT INTO k (ID, V) VALUES (4097, '-357');
+INSERT INTO k (ID, V) VALUES (3, 1000);
+INSERT INTO k (ID, V) VALUES (9999, '-1000');
+INSERT INTO k (ID) VALUES (4096);
+SELECT s.ID, k.ID FROM s JOIN k ON s.ID = k.ID LIMIT 2 OFFSET 1;
+SELECT s.ID, s.V FROM s JOIN k ON s.V = k.V LIMIT 3 OFFSET 3;
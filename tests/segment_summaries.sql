@@ -0,0 +1,7 @@
+SELECT COUNT(*), MIN(V), MAX(V), MIN(T), MAX(T), APPROX_COUNT_DISTINCT(V) FROM s;
+SELECT COUNT(*), MIN(V), MAX(V), MIN(T), MAX(T), APPROX_COUNT_DISTINCT(V) FROM s WHERE ID > 0;
+ALTER TABLE s ADD COLUMN W INTEGER;
+INSERT INTO s (ID, V, T, W) VALUES (5001, '-1500', 'a', 3);
+INSERT INTO s (ID, W) VALUES (5002, '-4');
+SELECT COUNT(*), MIN(V), MAX(V), MIN(T), MIN(W), MAX(W), APPROX_COUNT_DISTINCT(W) FROM s;
+SELECT COUNT(*), MIN(V), MAX(V), MIN(T), MIN(W), MAX(W), APPROX_COUNT_DISTINCT(W) FROM s WHERE ID > 0;
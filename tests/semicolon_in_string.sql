@@ -0,0 +1,6 @@
+CREATE TABLE t (ID INTEGER PRIMARY_KEY, N TEXT);
+INSERT INTO t (ID, N) VALUES (1, 'a; b');
+INSERT INTO t (ID, N) VALUES (1, 'x; DROP TABLE t');
+INSERT INTO t (ID, N) VALUES (2, "y;
+z");
+SELECT * FROM t WHERE N = 'a; b';
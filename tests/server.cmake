@@ -0,0 +1,98 @@
+# Starts PJC as a server on a Unix socket in WORK_DIR, emptied first, and talks to it through PJC --connect.
+# FIRST runs in a client that keeps its connection and the transaction it leaves open while OTHER runs in a second
+# client. Then the first client sends COMMIT and CHECK runs in a third one. Every output is printed after a
+# "Client n:" or "Server:" line, the server is stopped with SIGTERM at the end.
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+set(socket ${WORK_DIR}/socket)
+
+execute_process(COMMAND sh -c "\"$0\" --listen=\"$1\" > server.log 2>&1 < /dev/null & echo $!" ${PJC} ${socket}
+                WORKING_DIRECTORY ${WORK_DIR} OUTPUT_VARIABLE server OUTPUT_STRIP_TRAILING_WHITESPACE)
+
+# Stops the server and fails the test
+macro(fail reason)
+    execute_process(COMMAND kill -TERM ${server})
+    message(FATAL_ERROR "${reason}")
+endmacro()
+
+# Number of prompts the client printed to log so far, one before the first query and one after every query
+function(count_prompts log variable)
+    set(prompts 0)
+    if (EXISTS ${log})
+        file(READ ${log} output)
+        string(REGEX MATCHALL "db > " matches "${output}")
+        list(LENGTH matches prompts)
+    endif ()
+    set(${variable} ${prompts} PARENT_SCOPE)
+endfunction()
+
+# Waits up to ten seconds until the given check holds, check is a command that sets done
+macro(wait_for check description)
+    set(done FALSE)
+    foreach (attempt RANGE 100)
+        cmake_language(CALL ${check})
+        if (done)
+            break()
+        endif ()
+        execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 0.1)
+    endforeach ()
+    if (NOT done)
+        fail("Timed out waiting for ${description}")
+    endif ()
+endmacro()
+
+macro(server_listening)
+    if (EXISTS ${socket})
+        set(done TRUE)
+    endif ()
+endmacro()
+wait_for(server_listening "the server to listen on ${socket}")
+
+# The first client reads FIRST, waits for the second client to finish and commits. It runs in the background with
+# its output line buffered, so the prompts tell which of its queries were answered.
+execute_process(COMMAND sh -c "({ cat \"$1\"; while [ ! -e other.done ]; do sleep 0.1; done; echo 'COMMIT;'; } \
+                               | stdbuf -oL \"$0\" --connect=\"$2\" > first.log 2>&1; touch first.done) \
+                               < /dev/null > /dev/null 2>&1 &" ${PJC} ${FIRST} ${socket}
+                WORKING_DIRECTORY ${WORK_DIR})
+file(STRINGS ${FIRST} first_queries REGEX ";$")
+list(LENGTH first_queries first_count)
+macro(first_answered)
+    count_prompts(${WORK_DIR}/first.log prompts)
+    if (prompts GREATER first_count)
+        set(done TRUE)
+    endif ()
+endmacro()
+wait_for(first_answered "the first client to run ${FIRST}")
+
+execute_process(COMMAND ${PJC} --connect=${socket} WORKING_DIRECTORY ${WORK_DIR} INPUT_FILE ${OTHER}
+                OUTPUT_VARIABLE other_output ERROR_VARIABLE other_output RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    fail("The second client exited with ${result}")
+endif ()
+file(TOUCH ${WORK_DIR}/other.done)
+
+macro(first_finished)
+    if (EXISTS ${WORK_DIR}/first.done)
+        set(done TRUE)
+    endif ()
+endmacro()
+wait_for(first_finished "the first client to commit")
+
+execute_process(COMMAND ${PJC} --connect=${socket} WORKING_DIRECTORY ${WORK_DIR} INPUT_FILE ${CHECK}
+                OUTPUT_VARIABLE check_output ERROR_VARIABLE check_output RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    fail("The third client exited with ${result}")
+endif ()
+
+# The server saves the log and exits on SIGTERM, its output is flushed then
+execute_process(COMMAND kill -TERM ${server})
+macro(server_stopped)
+    file(READ ${WORK_DIR}/server.log server_output)
+    if (server_output MATCHES "Queries saved to")
+        set(done TRUE)
+    endif ()
+endmacro()
+wait_for(server_stopped "the server to stop")
+
+file(READ ${WORK_DIR}/first.log first_output)
+message("Client 1:\n${first_output}\nClient 2:\n${other_output}\nClient 3:\n${check_output}\nServer:\n${server_output}")
@@ -0,0 +1,5 @@
+CREATE TABLE accounts (ID INTEGER PRIMARY_KEY, OWNER TEXT);
+INSERT INTO accounts (ID, OWNER) VALUES (1, 'a');
+BEGIN;
+INSERT INTO accounts (ID, OWNER) VALUES (2, 'b');
+INSERT INTO accounts (ID, OWNER) VALUES (3, 'c');
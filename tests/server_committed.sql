@@ -0,0 +1 @@
+SELECT ID, OWNER FROM accounts;
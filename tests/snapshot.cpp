@@ -0,0 +1,130 @@
+#include "Check.h"
+#include "QueryExecutor.h"
+#include "Snapshot.h"
+#include "TableSegment.h"
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+
+static constexpr auto SNAPSHOT_FILENAME = "snapshot_test.franekql";
+
+// The manifest and the data files written next to it
+static void removeSnapshot() {
+    for (const auto &entry: std::filesystem::directory_iterator(".")) {
+        if (entry.path().filename().string().starts_with(SNAPSHOT_FILENAME)) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+}
+
+static std::vector<std::string> dataFiles() {
+    std::vector<std::string> files;
+    for (const auto &entry: std::filesystem::directory_iterator(".")) {
+        std::string name = entry.path().filename().string();
+        if (name.starts_with(std::string(SNAPSHOT_FILENAME) + ".")) {
+            files.push_back(name);
+        }
+    }
+    return files;
+}
+
+static bool refused(QueryExecutor &executor, const std::string &query) {
+    try {
+        executor.executeQuery(query);
+    } catch (const std::exception &) {
+        return true;
+    }
+    return false;
+}
+
+// Parent p has a row of every type, NULLs included, and child c spans more than one segment and references p
+static std::shared_ptr<Database> sampleDatabase() {
+    auto database = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(2));
+    QueryExecutor executor(database);
+    executor.executeQuery("CREATE TABLE p (ID INTEGER PRIMARY_KEY, NAME TEXT UNIQUE, OK BOOLEAN, F FLOAT, D DOUBLE, "
+                          "C CHAR NOT_NULL, DAY DATE, AT TIME, STAMP DATETIME);");
+    executor.executeQuery("INSERT INTO p (ID, NAME, OK, F, D, C, DAY, AT, STAMP) VALUES (1, 'one', true, 1.5, 2.25, "
+                          "'x', '2024-02-29', '12:30:00', '2024-02-29T12:30:00');");
+    executor.executeQuery("INSERT INTO p (ID, C) VALUES (2, 'y');");
+    executor.executeQuery("CREATE TABLE c (ID INTEGER PRIMARY_KEY, P INTEGER, FOREIGN_KEY P REFERENCES p ID);");
+    for (size_t id = 0; id < TableSegment::CAPACITY + 100; ++id) {
+        executor.executeQuery(fmt::format("INSERT INTO c (ID, P) VALUES ({}, {});", id, id % 2 + 1));
+    }
+    return database;
+}
+
+// A loaded snapshot gives the rows, the log sequence and the constraints of the database that wrote it
+static void tablesRoundTrip() {
+    removeSnapshot();
+    auto written = sampleDatabase();
+    CheckpointStats stats = Snapshot::write(*written, SNAPSHOT_FILENAME, 42);
+    check(stats.segmentsWritten == 3 && stats.segmentsReused == 0,
+          fmt::format("{} segments written and {} reused instead of 3 and 0", stats.segmentsWritten,
+                      stats.segmentsReused));
+
+    auto loaded = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(2));
+    check(Snapshot::load(SNAPSHOT_FILENAME, *loaded) == 42, "The log sequence changed");
+    QueryExecutor before(written);
+    QueryExecutor after(loaded);
+    for (const auto &query: {"SELECT * FROM p ORDER BY ID;", "SELECT * FROM c ORDER BY ID;"}) {
+        check(after.executeQuery(query).rows == before.executeQuery(query).rows,
+              std::string("Rows of ") + query + " changed");
+    }
+
+    check(refused(after, "INSERT INTO p (ID, C) VALUES (1, 'z');"), "A duplicate primary key was accepted");
+    check(refused(after, "INSERT INTO p (ID, NAME, C) VALUES (3, 'one', 'z');"),
+          "A duplicate unique value was accepted");
+    check(refused(after, "INSERT INTO p (ID) VALUES (3);"), "A missing NOT_NULL value was accepted");
+    check(refused(after, "INSERT INTO c (ID, P) VALUES (9000, 3);"), "A row without its parent was accepted");
+    after.executeQuery("INSERT INTO c (ID, P) VALUES (9000, 2);");
+    removeSnapshot();
+}
+
+// A block whose bytes changed after the checkpoint is refused instead of loading wrong rows
+static void corruptedBlockRefused() {
+    removeSnapshot();
+    Snapshot::write(*sampleDatabase(), SNAPSHOT_FILENAME, 0);
+    auto files = dataFiles();
+    check(files.size() == 1, fmt::format("{} data files instead of 1", files.size()));
+    {
+        std::fstream data(files[0], std::ios::in | std::ios::out | std::ios::binary);
+        data.seekg(100);
+        char byte = 0;
+        data.read(&byte, 1);
+        data.seekp(100);
+        byte = static_cast<char>(~byte);
+        data.write(&byte, 1);
+    }
+
+    std::string message;
+    try {
+        auto loaded = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(2));
+        Snapshot::load(SNAPSHOT_FILENAME, *loaded);
+    } catch (const std::exception &e) {
+        message = e.what();
+    }
+    check(message.starts_with("Corrupted checkpoint block"), "The corrupted block gave '" + message + "'");
+    removeSnapshot();
+}
+
+// A file that is not a snapshot, e.g. a log given by mistake, is refused
+static void otherFileRefused() {
+    removeSnapshot();
+    std::ofstream(SNAPSHOT_FILENAME) << "CREATE TABLE t (ID INTEGER PRIMARY_KEY);\n";
+    std::string message;
+    try {
+        Database loaded;
+        Snapshot::load(SNAPSHOT_FILENAME, loaded);
+    } catch (const std::exception &e) {
+        message = e.what();
+    }
+    check(message.ends_with("is not a FranekQL snapshot"), "The other file gave '" + message + "'");
+    removeSnapshot();
+}
+
+int main() {
+    bool passed = runCheck("Tables round trip", tablesRoundTrip);
+    passed &= runCheck("Corrupted block refused", corruptedBlockRefused);
+    passed &= runCheck("Other file refused", otherFileRefused);
+    return passed ? 0 : 1;
+}
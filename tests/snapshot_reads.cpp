@@ -0,0 +1,86 @@
+#include "Check.h"
+#include "QueryExecutor.h"
+#include "TableSegment.h"
+#include <fmt/format.h>
+#include <thread>
+
+// The oldest reader holds back the version, commits after it do not, and it moves on once the reader is gone
+static void readersHoldOldestVersion() {
+    VersionClock clock;
+    clock.commit([](uint64_t) {});
+    clock.commit([](uint64_t) {});
+    {
+        ReadSnapshot first = clock.beginRead();
+        clock.commit([](uint64_t) {});
+        ReadSnapshot second = clock.beginRead();
+        check(first.getVersion() == 2 && second.getVersion() == 3,
+              fmt::format("Readers started at versions {} and {}", first.getVersion(), second.getVersion()));
+        check(clock.getOldestReader() == 2, fmt::format("The oldest reader is at {}", clock.getOldestReader()));
+    }
+    check(clock.getOldestReader() == clock.getCommitted(), "A finished reader still holds back its version");
+}
+
+// A copy frozen at a version keeps the rows committed up to it while the table grows, past a full segment too
+static void frozenCopyKeepsItsRows() {
+    auto database = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(2));
+    QueryExecutor executor(database);
+    executor.executeQuery("CREATE TABLE t (ID INTEGER PRIMARY_KEY);");
+    auto table = database->getTables().at("t");
+    constexpr size_t FIRST = 10;
+    for (size_t id = 0; id < FIRST; ++id) {
+        executor.executeQuery(fmt::format("INSERT INTO t (ID) VALUES ({});", id));
+    }
+    auto frozen = table->freeze();
+    for (size_t id = FIRST; id < TableSegment::CAPACITY + FIRST; ++id) {
+        executor.executeQuery(fmt::format("INSERT INTO t (ID) VALUES ({});", id));
+    }
+    check(frozen->getRowCount() == FIRST, fmt::format("The frozen copy has {} rows", frozen->getRowCount()));
+    check(table->getRowCount() == TableSegment::CAPACITY + FIRST, "Rows are missing from the table");
+}
+
+// Selects running while rows are inserted in ID order each see one committed prefix of them: the count, the sum and
+// the greatest ID agree. None of them waits for the inserts to finish.
+static void selectsSeeCommittedPrefix() {
+    constexpr size_t ROWS = TableSegment::CAPACITY + 1000;
+    auto database = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(4));
+    QueryExecutor executor(database);
+    executor.executeQuery("CREATE TABLE t (ID INTEGER PRIMARY_KEY);");
+
+    std::atomic<bool> done = false;
+    std::string failure;
+    std::thread inserter([&, session = executor.newSession()] {
+        for (size_t id = 1; id <= ROWS; ++id) {
+            session->executeQuery(fmt::format("INSERT INTO t (ID) VALUES ({});", id));
+        }
+        done = true;
+    });
+    size_t selects = 0;
+    size_t selectsDuringInserts = 0;
+    try {
+        while (!done || selects == 0) {
+            bool inserting = !done;
+            auto row = executor.executeQuery("SELECT COUNT(*), SUM(ID), MAX(ID) FROM t;").rows.at(0);
+            size_t count = std::stoul(row.at(0));
+            if (count > 0) {
+                check(row.at(1) == std::to_string(count * (count + 1) / 2) && row.at(2) == std::to_string(count),
+                      fmt::format("A select saw {} rows with sum {} and greatest ID {}", count, row.at(1), row.at(2)));
+            }
+            ++selects;
+            if (inserting && !done) {
+                ++selectsDuringInserts;
+            }
+        }
+    } catch (const std::exception &e) {
+        failure = e.what();
+    }
+    inserter.join();
+    check(failure.empty(), failure);
+    check(selectsDuringInserts > 0, "No select ran while the rows were inserted");
+}
+
+int main() {
+    bool passed = runCheck("Readers hold the oldest version", readersHoldOldestVersion);
+    passed &= runCheck("Frozen copy keeps its rows", frozenCopyKeepsItsRows);
+    passed &= runCheck("Selects see a committed prefix", selectsSeeCommittedPrefix);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include "Check.h"
+#include "TaskScheduler.h"
+#include <fmt/format.h>
+
+static constexpr auto WAIT = std::chrono::seconds(10);
+
+// Every index is visited once, in chunks no larger than the grain, and an empty range runs nothing
+static void parallelForCoversEveryIndex() {
+    TaskScheduler scheduler(4);
+    constexpr size_t END = 100000;
+    constexpr size_t GRAIN = 37;
+    std::vector<std::atomic<int>> visits(END);
+    std::atomic<bool> oversized = false;
+    scheduler.parallelFor(10, END, GRAIN, [&](size_t begin, size_t end) {
+        oversized = oversized || end - begin > GRAIN;
+        for (size_t i = begin; i < end; ++i) {
+            ++visits[i];
+        }
+    });
+    check(!oversized, "A chunk was larger than the grain");
+    for (size_t i = 0; i < END; ++i) {
+        check(visits[i] == (i < 10 ? 0 : 1), fmt::format("Index {} was visited {} times", i, visits[i].load()));
+    }
+
+    bool called = false;
+    scheduler.parallelFor(5, 5, GRAIN, [&](size_t, size_t) { called = true; });
+    check(!called, "An empty range ran a chunk");
+}
+
+// Tasks that run a parallelFor of their own finish even when every worker runs one of them
+static void nestedParallelForFinishes() {
+    TaskScheduler scheduler(2);
+    std::atomic<size_t> inner = 0;
+    auto outer = std::async(std::launch::async, [&] {
+        scheduler.parallelFor(0, 8, 1, [&](size_t, size_t) {
+            scheduler.parallelFor(0, 1000, 10, [&](size_t begin, size_t end) { inner += end - begin; });
+        });
+    });
+    check(outer.wait_for(WAIT) == std::future_status::ready, "The nested loops did not finish");
+    outer.get();
+    check(inner == 8 * 1000, fmt::format("{} inner indexes ran instead of 8000", inner.load()));
+}
+
+// An exception of one chunk comes out of parallelFor, and of a submitted task out of its future
+static void exceptionsReachTheCaller() {
+    TaskScheduler scheduler(2);
+    std::string message;
+    try {
+        scheduler.parallelFor(0, 100, 1, [](size_t begin, size_t) {
+            if (begin == 42) {
+                throw std::runtime_error("chunk 42");
+            }
+        });
+    } catch (const std::exception &e) {
+        message = e.what();
+    }
+    check(message == "chunk 42", "parallelFor gave '" + message + "'");
+
+    auto task = scheduler.submit([]() -> int { throw std::runtime_error("task"); });
+    message.clear();
+    try {
+        (void) task.get();
+    } catch (const std::exception &e) {
+        message = e.what();
+    }
+    check(message == "task", "The future gave '" + message + "'");
+}
+
+// Subtasks queued by one task go to its own deque, idle workers steal them. The statistics count every task.
+static void idleWorkersSteal() {
+    constexpr size_t SUBTASKS = 64;
+    TaskScheduler scheduler(4);
+    std::atomic<size_t> done = 0;
+    scheduler.submit([&] {
+        std::vector<std::future<void>> subtasks;
+        for (size_t i = 0; i < SUBTASKS; ++i) {
+            subtasks.push_back(scheduler.submit([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                ++done;
+            }));
+        }
+    }).get();
+    // A task is counted once it returned
+    auto deadline = std::chrono::steady_clock::now() + WAIT;
+    while (scheduler.getStats().tasksRun < SUBTASKS + 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    check(done == SUBTASKS, fmt::format("{} of {} subtasks ran", done.load(), SUBTASKS));
+
+    auto stats = scheduler.getStats();
+    check(stats.workerCount == 4, fmt::format("{} workers instead of 4", stats.workerCount));
+    check(stats.tasksRun == SUBTASKS + 1, fmt::format("{} tasks counted instead of {}", stats.tasksRun, SUBTASKS + 1));
+    check(stats.tasksStolen > 0, "No subtask was stolen");
+    check(stats.utilisation > 0 && stats.utilisation <= 1, fmt::format("Utilisation of {}", stats.utilisation));
+}
+
+// A scan that is done after its first wave stops there instead of running the whole range
+static void parallelForUntilStopsEarly() {
+    TaskScheduler scheduler(4);
+    std::atomic<size_t> visited = 0;
+    scheduler.parallelForUntil(0, 1000, 4, [&](size_t begin, size_t end) { visited += end - begin; },
+                               [&] { return visited > 0; });
+    check(visited == 1, fmt::format("{} indexes ran instead of the first wave of 1", visited.load()));
+}
+
+int main() {
+    bool passed = runCheck("parallelFor covers every index", parallelForCoversEveryIndex);
+    passed &= runCheck("Nested parallelFor finishes", nestedParallelForFinishes);
+    passed &= runCheck("Exceptions reach the caller", exceptionsReachTheCaller);
+    passed &= runCheck("Idle workers steal", idleWorkersSteal);
+    passed &= runCheck("parallelForUntil stops early", parallelForUntilStopsEarly);
+    return passed ? 0 : 1;
+}
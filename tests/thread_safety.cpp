@@ -0,0 +1,114 @@
+#include "Check.h"
+#include "Parser.h"
+#include "QueryExecutor.h"
+#include <fmt/format.h>
+#include <thread>
+
+static constexpr auto WAIT = std::chrono::seconds(10);
+
+// Locks the database takes for the query
+static Database::Lock lockFor(const Database &database, const std::string &text) {
+    Lexer lexer(text);
+    Parser parser(lexer);
+    return database.lock(*parser.parseQuery());
+}
+
+// Runs the query on a session of its own thread, the future is ready once it finished
+static std::future<void> runAside(QueryExecutor &executor, const std::string &query) {
+    return std::async(std::launch::async, [session = executor.newSession(), query] {
+        session->executeQuery(query);
+    });
+}
+
+// While an insert holds its locks, other inserts into the same table and selects go ahead, a schema change waits
+// until the insert is done
+static void insertsShareTables() {
+    auto database = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(2));
+    QueryExecutor executor(database);
+    executor.executeQuery("CREATE TABLE t (ID INTEGER PRIMARY_KEY);");
+    executor.executeQuery("CREATE TABLE other (ID INTEGER PRIMARY_KEY);");
+
+    auto held = lockFor(*database, "INSERT INTO t (ID) VALUES (1);");
+    auto insert = runAside(executor, "INSERT INTO t (ID) VALUES (2);");
+    auto select = runAside(executor, "SELECT COUNT(*) FROM t;");
+    check(insert.wait_for(WAIT) == std::future_status::ready, "An insert waited for another insert");
+    check(select.wait_for(WAIT) == std::future_status::ready, "A select waited for an insert");
+    auto drop = runAside(executor, "DROP TABLE other;");
+    check(drop.wait_for(std::chrono::milliseconds(200)) == std::future_status::timeout,
+          "A schema change ran beside an insert");
+    held = {};
+    check(drop.wait_for(WAIT) == std::future_status::ready, "The schema change still waits");
+    insert.get();
+    select.get();
+    drop.get();
+    check(!database->getTables().contains("other"), "The table was not dropped");
+}
+
+// Tables are created, altered and dropped while other sessions insert into and read another table.
+// Every query succeeds and readers never see the row count go down.
+static void schemaChangesBesideQueries() {
+    constexpr size_t INSERTERS = 2;
+    constexpr size_t PER_INSERTER = 500;
+    constexpr size_t SCHEMA_ROUNDS = 50;
+    auto database = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(4));
+    QueryExecutor executor(database);
+    executor.executeQuery("CREATE TABLE t (ID INTEGER PRIMARY_KEY);");
+
+    std::atomic<bool> done = false;
+    std::mutex failuresMutex;
+    std::vector<std::string> failures;
+    auto guarded = [&](const std::function<void()> &body) {
+        try {
+            body();
+        } catch (const std::exception &e) {
+            std::lock_guard guard(failuresMutex);
+            failures.emplace_back(e.what());
+        }
+    };
+    std::vector<std::thread> writers;
+    for (size_t inserter = 0; inserter < INSERTERS; ++inserter) {
+        writers.emplace_back([&, inserter, session = executor.newSession()] {
+            guarded([&] {
+                for (size_t id = inserter * PER_INSERTER; id < (inserter + 1) * PER_INSERTER; ++id) {
+                    session->executeQuery(fmt::format("INSERT INTO t (ID) VALUES ({});", id));
+                }
+            });
+        });
+    }
+    writers.emplace_back([&, session = executor.newSession()] {
+        guarded([&] {
+            for (size_t round = 0; round < SCHEMA_ROUNDS; ++round) {
+                session->executeQuery(fmt::format("CREATE TABLE x{} (ID INTEGER PRIMARY_KEY);", round));
+                session->executeQuery(fmt::format("ALTER TABLE x{} ADD COLUMN N INTEGER;", round));
+                session->executeQuery(fmt::format("INSERT INTO x{} (ID, N) VALUES (1, {});", round, round));
+                session->executeQuery(fmt::format("DROP TABLE x{};", round));
+            }
+        });
+    });
+    std::thread reader([&, session = executor.newSession()] {
+        guarded([&] {
+            size_t last = 0;
+            while (!done) {
+                size_t rows = std::stoul(session->executeQuery("SELECT COUNT(*) FROM t;").rows.at(0).at(0));
+                check(rows >= last, fmt::format("The row count went from {} down to {}", last, rows));
+                last = rows;
+            }
+        });
+    });
+    for (auto &writer: writers) {
+        writer.join();
+    }
+    done = true;
+    reader.join();
+
+    check(failures.empty(), failures.empty() ? "" : "A query failed: " + failures.front());
+    check(executor.executeQuery("SELECT COUNT(*) FROM t;").rows.at(0).at(0) == std::to_string(INSERTERS * PER_INSERTER),
+          "Rows are missing from the table");
+    check(database->getTables().size() == 1, fmt::format("{} tables are left", database->getTables().size()));
+}
+
+int main() {
+    bool passed = runCheck("Inserts share tables", insertsShareTables);
+    passed &= runCheck("Schema changes beside queries", schemaChangesBesideQueries);
+    return passed ? 0 : 1;
+}
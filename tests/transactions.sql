@@ -0,0 +1,15 @@
+CREATE TABLE t (ID INTEGER PRIMARY_KEY, N TEXT);
+INSERT INTO t (ID, N) VALUES (1, 'a');
+BEGIN;
+INSERT INTO t (ID, N) VALUES (2, 'b');
+INSERT INTO t (ID, N) VALUES (3, 'c');
+COMMIT;
+BEGIN;
+INSERT INTO t (ID, N) VALUES (4, 'd');
+ROLLBACK;
+BEGIN;
+INSERT INTO t (ID, N) VALUES (5, 'e');
+INSERT INTO t (ID, N) VALUES (2, 'x');
+COMMIT;
+INSERT INTO t (ID, N) VALUES (6, 'f');
+SELECT COUNT(*), SUM(ID), MAX(ID) FROM t;
@@ -0,0 +1,2 @@
+SELECT COUNT(*), SUM(ID), MAX(ID) FROM t;
+SELECT ID, N FROM t WHERE ID > 3 ORDER BY ID;
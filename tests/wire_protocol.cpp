@@ -0,0 +1,101 @@
+#include "Check.h"
+#include "QueryClient.h"
+#include "QueryServer.h"
+#include "WireProtocol.h"
+#include "BinaryFormat.h"
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr auto SOCKET_PATH = "wire_protocol.socket";
+
+// Frames survive the trip whole, an empty payload included, and a connection closed between frames reads as none
+static void framesRoundTrip() {
+    int fds[2];
+    check(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0, "Cannot create a socket pair");
+    WireProtocol::writeFrame(fds[0], "SELECT * FROM t;");
+    WireProtocol::writeFrame(fds[0], "");
+    ::close(fds[0]);
+    check(WireProtocol::readFrame(fds[1]) == "SELECT * FROM t;", "The first frame changed on the way");
+    check(WireProtocol::readFrame(fds[1]) == "", "The empty frame changed on the way");
+    check(!WireProtocol::readFrame(fds[1]).has_value(), "A closed connection gave a frame");
+    ::close(fds[1]);
+}
+
+// A length over MAX_FRAME_SIZE is refused before anything is allocated for it
+static void oversizedFrameRefused() {
+    int fds[2];
+    check(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0, "Cannot create a socket pair");
+    ByteWriter header;
+    header.writeU32(WireProtocol::MAX_FRAME_SIZE + 1);
+    check(::write(fds[0], header.data().data(), header.size()) == static_cast<ssize_t>(header.size()),
+          "Cannot write the frame header");
+    bool refused = false;
+    try {
+        (void) WireProtocol::readFrame(fds[1]);
+    } catch (const std::runtime_error &) {
+        refused = true;
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+    check(refused, "A frame over the limit was accepted");
+}
+
+// Rows and errors decode to what was encoded
+static void responsesRoundTrip() {
+    QueryResult result;
+    result.hasRows = true;
+    result.columns = {"ID", "NAME"};
+    result.rows = {{"1", "a"}, {"2", "NULL"}};
+    QueryResult decoded = WireProtocol::decodeResponse(WireProtocol::encodeResult(result));
+    check(decoded.hasRows && decoded.columns == result.columns && decoded.rows == result.rows,
+          "The result changed on the way");
+
+    std::string message;
+    try {
+        (void) WireProtocol::decodeResponse(WireProtocol::encodeError("Table t not found"));
+    } catch (const std::runtime_error &e) {
+        message = e.what();
+    }
+    check(message == "Table t not found", "The error came back as '" + message + "'");
+}
+
+// A client sending an oversized frame is dropped, the others are still served
+static void serverDropsOversizedFrames() {
+    auto database = std::make_shared<Database>(nullptr, std::make_shared<TaskScheduler>(2));
+    QueryServer server(std::make_shared<QueryExecutor>(database), 2);
+    server.listen(SOCKET_PATH);
+    std::thread serving([&] { server.run(); });
+
+    std::string failure;
+    try {
+        QueryClient client(SOCKET_PATH);
+        client.execute("CREATE TABLE t (ID INTEGER PRIMARY_KEY);");
+
+        int fd = WireProtocol::connect(SOCKET_PATH);
+        ByteWriter header;
+        header.writeU32(WireProtocol::MAX_FRAME_SIZE + 1);
+        (void) ::write(fd, header.data().data(), header.size());
+        bool dropped = !WireProtocol::readFrame(fd).has_value();
+        ::close(fd);
+        check(dropped, "The server answered an oversized frame");
+
+        client.execute("INSERT INTO t (ID) VALUES (1);");
+        QueryResult result = client.execute("SELECT ID FROM t;");
+        check(result.rows == std::vector<std::vector<std::string>>{{"1"}}, "The other client lost its session");
+    } catch (const std::exception &e) {
+        failure = e.what();
+    }
+    server.stop();
+    serving.join();
+    ::unlink(SOCKET_PATH);
+    check(failure.empty(), failure);
+}
+
+int main() {
+    bool passed = runCheck("Frames round trip", framesRoundTrip);
+    passed &= runCheck("Oversized frame refused", oversizedFrameRefused);
+    passed &= runCheck("Responses round trip", responsesRoundTrip);
+    passed &= runCheck("Server drops oversized frames", serverDropsOversizedFrames);
+    return passed ? 0 : 1;
+}